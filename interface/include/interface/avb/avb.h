@@ -42,6 +42,9 @@ enum avb_command {
     READ_LOCK_STATE = (5 << AVB_REQ_SHIFT),
     WRITE_LOCK_STATE = (6 << AVB_REQ_SHIFT),
     LOCK_BOOT_STATE = (7 << AVB_REQ_SHIFT),
+    READ_ROLLBACK_INDEX_MULTI = (8 << AVB_REQ_SHIFT),
+    WRITE_ROLLBACK_INDEX_MULTI = (9 << AVB_REQ_SHIFT),
+    AVB_GET_SNAPSHOT = (10 << AVB_REQ_SHIFT),
 };
 
 /**
@@ -87,6 +90,56 @@ struct avb_rollback_resp {
     uint64_t value;
 };
 
+/**
+ * avb_rollback_multi_req - request format for
+ *                          [READ|WRITE]_ROLLBACK_INDEX_MULTI
+ * @count:    number of entries, at most AVB_ROLLBACK_MULTI_MAX
+ * @reserved: must be 0
+ * @entries:  rollback indexes to read or write. Writes are committed in one
+ *            storage transaction; either all of them are applied or none.
+ *
+ * The response payload is @entries with each value replaced by the value of
+ * the rollback index after the request.
+ */
+struct avb_rollback_multi_req {
+    uint32_t count;
+    uint32_t reserved;
+    struct avb_rollback_req entries[0];
+} TRUSTY_ATTR_PACKED;
+
+#define AVB_ROLLBACK_MULTI_MAX                                 \
+    ((AVB_MAX_BUFFER_LENGTH - sizeof(struct avb_message) -     \
+      sizeof(struct avb_rollback_multi_req)) /                 \
+     sizeof(struct avb_rollback_req))
+
+#define AVB_PERM_ATTR_DIGEST_SIZE 32
+
+/**
+ * avb_snapshot_resp - response format for AVB_GET_SNAPSHOT, which takes no
+ *                     request payload
+ * @lock_state:       device lock state, as returned by READ_LOCK_STATE
+ * @boot_locked:      1 if LOCK_BOOT_STATE was received this boot, else 0
+ * @reserved:         0
+ * @perm_attr_size:   size of the permanent attributes, 0 if there are none
+ * @perm_attr_digest: SHA-256 digest of the permanent attributes
+ * @rollback_count:   number of entries in @rollback
+ * @reserved2:        0
+ * @rollback:         value of every rollback index, indexed by slot
+ *
+ * The header is a multiple of 8 bytes, so @rollback is aligned in a receive
+ * buffer that is.
+ */
+struct avb_snapshot_resp {
+    uint8_t lock_state;
+    uint8_t boot_locked;
+    uint16_t reserved;
+    uint32_t perm_attr_size;
+    uint8_t perm_attr_digest[AVB_PERM_ATTR_DIGEST_SIZE];
+    uint32_t rollback_count;
+    uint32_t reserved2;
+    uint64_t rollback[0];
+} TRUSTY_ATTR_PACKED;
+
 /**
  * avb_get_version_resp - response format for AVB_GET_VERSION.
  * @version: version of AVB message format
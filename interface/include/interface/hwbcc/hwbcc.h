@@ -29,14 +29,23 @@
  * child node of Trusty in the DICE chain in non-secure world (e.g. ABL).
  * @HWBCC_CMD_NS_DEPRIVILEGE: Deprivilege hwbcc from serving calls
  * to non-secure clients.
+ * @HWBCC_CMD_GET_DICE_ARTIFACTS_MULTI: Like HWBCC_CMD_GET_DICE_ARTIFACTS, but
+ * the response may be split into several messages, each starting with a
+ * struct hwbcc_resp_hdr that gives the size of its part of the payload. The
+ * cmd of the last one has HWBCC_CMD_STOP_BIT set. An error is reported in a
+ * single message.
  */
 enum hwbcc_cmd {
     HWBCC_CMD_REQ_SHIFT = 1,
     HWBCC_CMD_RESP_BIT = 1,
     HWBCC_CMD_GET_DICE_ARTIFACTS = 3 << HWBCC_CMD_REQ_SHIFT,
     HWBCC_CMD_NS_DEPRIVILEGE = 4 << HWBCC_CMD_REQ_SHIFT,
+    HWBCC_CMD_GET_DICE_ARTIFACTS_MULTI = 5 << HWBCC_CMD_REQ_SHIFT,
 };
 
+/* Bit of hwbcc_resp_hdr.cmd marking the last message of a response */
+#define HWBCC_CMD_STOP_BIT (1U << 31)
+
 /**
  * struct hwbcc_req_hdr - Generic header for all hwbcc requests.
  * @cmd:       The command to be run. Commands are described in hwbcc_cmd.
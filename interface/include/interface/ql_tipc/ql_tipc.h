@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TRUSTY_INTERFACE_QL_TIPC_H_
+#define TRUSTY_INTERFACE_QL_TIPC_H_
+
+/*
+ * Command format of the queueless Trusty IPC device. Commands are written to
+ * the start of the buffer shared with the secure side, and the secure side
+ * overwrites them with the response.
+ */
+
+#include <trusty/sysdeps.h>
+
+#define QL_TIPC_DEV_RESP 0x8000
+#define QL_TIPC_DEV_CONNECT 0x1
+#define QL_TIPC_DEV_GET_EVENT 0x2
+#define QL_TIPC_DEV_SEND 0x3
+#define QL_TIPC_DEV_RECV 0x4
+#define QL_TIPC_DEV_DISCONNECT 0x5
+#define QL_TIPC_DEV_RECV_PARTIAL 0x6
+#define QL_TIPC_DEV_CONNECT_WITH_MSG 0x7
+
+#define QL_TIPC_DEV_FC_HAS_EVENT 0x100
+
+/* Status of commands the secure side does not implement (ERR_NOT_SUPPORTED) */
+#define QL_TIPC_DEV_ERR_NOT_SUPPORTED ((uint32_t)-24)
+
+/*
+ * Status of QL_TIPC_DEV_SEND if the queue of the peer is full
+ * (ERR_NOT_ENOUGH_BUFFER)
+ */
+#define QL_TIPC_DEV_ERR_NOT_ENOUGH_BUFFER ((uint32_t)-9)
+
+/* Flags of QL_TIPC_DEV_RECV_PARTIAL: leave the message queued */
+#define QL_TIPC_DEV_RECV_PEEK 0x1
+
+/**
+ * struct trusty_ipc_cmd_hdr - header of every command and response
+ * @opcode:      one of QL_TIPC_DEV_*, or'ed with QL_TIPC_DEV_RESP in responses
+ * @flags:       command specific flags
+ * @status:      zero on success, secure side error code otherwise
+ * @handle:      channel the command applies to
+ * @payload_len: number of bytes in @payload
+ * @payload:     command specific payload
+ */
+struct trusty_ipc_cmd_hdr {
+    uint16_t opcode;
+    uint16_t flags;
+    uint32_t status;
+    uint32_t handle;
+    uint32_t payload_len;
+    uint8_t payload[0];
+};
+
+/**
+ * struct trusty_ipc_wait_req - payload of QL_TIPC_DEV_GET_EVENT
+ * @reserved: must be 0
+ */
+struct trusty_ipc_wait_req {
+    uint64_t reserved;
+};
+
+/**
+ * struct trusty_ipc_connect_req - payload of QL_TIPC_DEV_CONNECT
+ * @cookie:   value reported back in events for the new channel
+ * @reserved: must be 0
+ * @name:     zero terminated name of the port to connect to
+ */
+struct trusty_ipc_connect_req {
+    uint64_t cookie;
+    uint64_t reserved;
+    uint8_t name[0];
+};
+
+/**
+ * struct trusty_ipc_connect_msg_req - payload of QL_TIPC_DEV_CONNECT_WITH_MSG
+ * @cookie:   value reported back in events for the new channel
+ * @name_len: length of the port name, including the terminating zero
+ * @msg_len:  length of the first message
+ * @data:     zero terminated name of the port followed by the first message
+ *
+ * Connects like QL_TIPC_DEV_CONNECT and sends the first message as soon as
+ * the connection is accepted.
+ */
+struct trusty_ipc_connect_msg_req {
+    uint64_t cookie;
+    uint32_t name_len;
+    uint32_t msg_len;
+    uint8_t data[0];
+};
+
+/**
+ * struct trusty_ipc_connect_msg_resp - response payload of
+ *                                      QL_TIPC_DEV_CONNECT_WITH_MSG
+ * @event:    events (IPC_HANDLE_POLL_*) of the new channel at the time of the
+ *            response. If the connection was accepted this includes
+ *            IPC_HANDLE_POLL_READY, which QL_TIPC_DEV_GET_EVENT then does not
+ *            report again, and IPC_HANDLE_POLL_MSG if a reply is readable.
+ * @reserved: must be 0
+ */
+struct trusty_ipc_connect_msg_resp {
+    uint32_t event;
+    uint32_t reserved;
+};
+
+/**
+ * struct trusty_ipc_recv_req - payload of QL_TIPC_DEV_RECV_PARTIAL
+ * @offset:  offset into the first queued message to copy from
+ * @max_len: maximum number of bytes to copy
+ *
+ * Unlike QL_TIPC_DEV_RECV, which always consumes the whole message, this
+ * copies part of it. The message is retired once a copy reaches its end,
+ * unless QL_TIPC_DEV_RECV_PEEK is set in the command flags. An @offset past
+ * the end of the message is an error.
+ */
+struct trusty_ipc_recv_req {
+    uint32_t offset;
+    uint32_t max_len;
+};
+
+/**
+ * struct trusty_ipc_recv_resp - response payload of QL_TIPC_DEV_RECV_PARTIAL
+ * @msg_len:  total length of the message
+ * @reserved: must be 0
+ * @data:     the bytes copied, the rest of the response payload
+ */
+struct trusty_ipc_recv_resp {
+    uint32_t msg_len;
+    uint32_t reserved;
+    uint8_t data[0];
+};
+
+#endif /* TRUSTY_INTERFACE_QL_TIPC_H_ */
@@ -29,10 +29,177 @@
 
 #define LOCAL_LOG 0
 
+#ifndef NELEMS
+#define NELEMS(x) (sizeof(x) / sizeof((x)[0]))
+#endif
+
 static bool initialized;
-static int avb_tipc_version = 1;
+static uint32_t avb_tipc_version = 1;
 static struct trusty_ipc_chan avb_chan;
 
+static const struct trusty_ipc_schema_field avb_rollback_multi_fields[] = {
+        TRUSTY_IPC_SCHEMA_FIELD_U32(struct avb_rollback_multi, count),
+        TRUSTY_IPC_SCHEMA_FIELD_U32(struct avb_rollback_multi, reserved),
+        TRUSTY_IPC_SCHEMA_FIELD_TAIL(struct avb_rollback_multi, entries,
+                                     entries_size),
+};
+
+static const struct trusty_ipc_schema_field avb_snapshot_fields[] = {
+        TRUSTY_IPC_SCHEMA_FIELD_BYTES(struct avb_snapshot, lock_state),
+        TRUSTY_IPC_SCHEMA_FIELD_BYTES(struct avb_snapshot, boot_locked),
+        TRUSTY_IPC_SCHEMA_FIELD_BYTES(struct avb_snapshot, reserved),
+        TRUSTY_IPC_SCHEMA_FIELD_U32(struct avb_snapshot, perm_attr_size),
+        TRUSTY_IPC_SCHEMA_FIELD_BYTES(struct avb_snapshot, perm_attr_digest),
+        TRUSTY_IPC_SCHEMA_FIELD_U32(struct avb_snapshot, rollback_count),
+        TRUSTY_IPC_SCHEMA_FIELD_U32(struct avb_snapshot, reserved2),
+        TRUSTY_IPC_SCHEMA_FIELD_TAIL(struct avb_snapshot, rollback,
+                                     rollback_size),
+};
+
+const struct trusty_ipc_schema avb_rollback_multi_schema =
+        TRUSTY_IPC_SCHEMA(avb_rollback_multi_fields);
+const struct trusty_ipc_schema avb_snapshot_schema =
+        TRUSTY_IPC_SCHEMA(avb_snapshot_fields);
+
+/* Whether the service handles the *_ROLLBACK_INDEX_MULTI commands */
+static enum {
+    AVB_MULTI_UNKNOWN,
+    AVB_MULTI_SUPPORTED,
+    AVB_MULTI_UNSUPPORTED,
+} avb_multi;
+
+#ifdef TIPC_ENABLE_AVB_CACHE
+#ifndef AVB_CACHE_ROLLBACK_SLOTS
+#define AVB_CACHE_ROLLBACK_SLOTS 32
+#endif
+
+/*
+ * Write-through cache of the AVB data, see trusty_avb_cache_enable. Holds the
+ * values last read from or successfully written to the secure side.
+ */
+static struct {
+    bool enabled;
+    bool lock_state_valid;
+    uint8_t lock_state;
+    uint32_t perm_attr_size; /* 0 if not cached */
+    uint8_t perm_attr[AVB_MAX_BUFFER_LENGTH];
+    bool rollback_valid[AVB_CACHE_ROLLBACK_SLOTS];
+    uint64_t rollback[AVB_CACHE_ROLLBACK_SLOTS];
+    struct trusty_avb_cache_stats stats;
+} avb_cache;
+
+static bool avb_cache_enabled(void) {
+    return avb_cache.enabled;
+}
+
+static void avb_cache_rollback_drop_all(void) {
+    size_t i;
+
+    for (i = 0; i < AVB_CACHE_ROLLBACK_SLOTS; i++) {
+        avb_cache.rollback_valid[i] = false;
+    }
+}
+
+static void avb_cache_invalidate(void) {
+    avb_cache.lock_state_valid = false;
+    avb_cache.perm_attr_size = 0;
+    avb_cache_rollback_drop_all();
+}
+
+/* Counts a read as a hit if it was answered from the cache, returns @hit */
+static bool avb_cache_account(bool hit) {
+    if (avb_cache.enabled) {
+        if (hit) {
+            avb_cache.stats.hits++;
+        } else {
+            avb_cache.stats.misses++;
+        }
+    }
+    return hit;
+}
+
+static bool avb_cache_rollback_lookup(uint32_t slot, uint64_t* value) {
+    if (!avb_cache.enabled || slot >= AVB_CACHE_ROLLBACK_SLOTS ||
+        !avb_cache.rollback_valid[slot]) {
+        return false;
+    }
+    *value = avb_cache.rollback[slot];
+    return true;
+}
+
+static void avb_cache_rollback_store(uint32_t slot, uint64_t value) {
+    if (avb_cache.enabled && slot < AVB_CACHE_ROLLBACK_SLOTS) {
+        avb_cache.rollback[slot] = value;
+        avb_cache.rollback_valid[slot] = true;
+    }
+}
+
+/* Forgets @slot after a failed write, which may or may not have happened */
+static void avb_cache_rollback_drop(uint32_t slot) {
+    if (slot < AVB_CACHE_ROLLBACK_SLOTS) {
+        avb_cache.rollback_valid[slot] = false;
+    }
+}
+
+static bool avb_cache_lock_state_lookup(uint8_t* lock_state) {
+    if (!avb_cache.enabled || !avb_cache.lock_state_valid) {
+        return false;
+    }
+    *lock_state = avb_cache.lock_state;
+    return true;
+}
+
+/* Stores the lock state, or forgets it if @lock_state is NULL */
+static void avb_cache_lock_state_store(const uint8_t* lock_state) {
+    avb_cache.lock_state_valid = lock_state && avb_cache.enabled;
+    if (avb_cache.lock_state_valid) {
+        avb_cache.lock_state = *lock_state;
+    }
+}
+
+/* Returns the cached permanent attributes and their size, NULL if none */
+static const uint8_t* avb_cache_perm_attr_lookup(uint32_t* size) {
+    if (!avb_cache.enabled || !avb_cache.perm_attr_size) {
+        return NULL;
+    }
+    *size = avb_cache.perm_attr_size;
+    return avb_cache.perm_attr;
+}
+
+/* Stores the permanent attributes, or forgets them if @attributes is NULL */
+static void avb_cache_perm_attr_store(const uint8_t* attributes,
+                                      uint32_t size) {
+    avb_cache.perm_attr_size = 0;
+    if (attributes && avb_cache.enabled && size <= AVB_MAX_BUFFER_LENGTH) {
+        trusty_memcpy(avb_cache.perm_attr, attributes, size);
+        avb_cache.perm_attr_size = size;
+    }
+}
+#else
+static bool avb_cache_enabled(void) {
+    return false;
+}
+static void avb_cache_rollback_drop_all(void) {}
+static void avb_cache_invalidate(void) {}
+static bool avb_cache_account(bool hit) {
+    return hit;
+}
+static bool avb_cache_rollback_lookup(uint32_t slot, uint64_t* value) {
+    return false;
+}
+static void avb_cache_rollback_store(uint32_t slot, uint64_t value) {}
+static void avb_cache_rollback_drop(uint32_t slot) {}
+static bool avb_cache_lock_state_lookup(uint8_t* lock_state) {
+    return false;
+}
+static void avb_cache_lock_state_store(const uint8_t* lock_state) {}
+static const uint8_t* avb_cache_perm_attr_lookup(uint32_t* size) {
+    return NULL;
+}
+static void avb_cache_perm_attr_store(const uint8_t* attributes,
+                                      uint32_t size) {}
+#endif
+
 static int avb_send_request(struct avb_message* msg,
                             void* req,
                             size_t req_len) {
@@ -115,29 +282,66 @@ static int avb_do_tipc(uint32_t cmd,
     return TRUSTY_ERR_NONE;
 }
 
+/* Reads the response to the AVB_GET_VERSION request sent on connect */
 static int avb_get_version(uint32_t* version) {
     int rc;
+    struct avb_message msg;
     struct avb_get_version_resp resp;
-    uint32_t resp_size = sizeof(resp);
 
-    rc = avb_do_tipc(AVB_GET_VERSION, NULL, 0, &resp, &resp_size);
+    rc = avb_read_response(&msg, AVB_GET_VERSION, &resp, sizeof(resp));
+    if (rc < 0) {
+        trusty_error("%s: failed (%d) to read AVB response\n", __func__, rc);
+        return rc;
+    }
+    if (msg.result != AVB_ERROR_NONE || (size_t)rc < sizeof(resp)) {
+        trusty_error("%s: AVB service returned error (%d)\n", __func__,
+                     msg.result);
+        return TRUSTY_ERR_GENERIC;
+    }
 
     *version = resp.version;
-    return rc;
+    return TRUSTY_ERR_NONE;
 }
 
 int avb_tipc_init(struct trusty_ipc_dev* dev) {
+    return avb_tipc_init_handoff(dev, 0, NULL);
+}
+
+int avb_tipc_init_handoff(struct trusty_ipc_dev* dev,
+                          uint64_t instance_id,
+                          struct trusty_version_handoff* handoff) {
     int rc;
     uint32_t version = 0;
+    struct avb_message version_req = {.cmd = AVB_GET_VERSION};
+    struct trusty_ipc_iovec version_iov = {
+            .base = &version_req,
+            .len = sizeof(version_req),
+    };
 
     trusty_assert(dev);
     trusty_assert(!initialized);
 
     trusty_ipc_chan_init(&avb_chan, dev);
+    avb_multi = AVB_MULTI_UNKNOWN;
+
+    /* an earlier stage already checked the version of this instance */
+    if (handoff && instance_id && handoff->instance_id == instance_id &&
+        handoff->version == avb_tipc_version) {
+        trusty_debug("Connecting to AVB service, version %u known\n",
+                     handoff->version);
+        rc = trusty_ipc_connect(&avb_chan, AVB_PORT, true);
+        if (rc < 0) {
+            trusty_error("failed (%d) to connect to '%s'\n", rc, AVB_PORT);
+            return rc;
+        }
+        initialized = true;
+        return TRUSTY_ERR_NONE;
+    }
+
     trusty_debug("Connecting to AVB service\n");
 
-    /* connect to AVB service and wait for connect to complete */
-    rc = trusty_ipc_connect(&avb_chan, AVB_PORT, true);
+    /* connect to AVB service, asking for its version */
+    rc = trusty_ipc_connect_with_msg(&avb_chan, AVB_PORT, &version_iov, 1);
     if (rc < 0) {
         trusty_error("failed (%d) to connect to '%s'\n", rc, AVB_PORT);
         return rc;
@@ -158,6 +362,10 @@ int avb_tipc_init(struct trusty_ipc_dev* dev) {
     /* mark as initialized */
     initialized = true;
 
+    if (handoff) {
+        handoff->instance_id = instance_id;
+        handoff->version = version;
+    }
     return TRUSTY_ERR_NONE;
 }
 
@@ -168,10 +376,28 @@ void avb_tipc_shutdown(struct trusty_ipc_dev* dev) {
     /* close channel */
     trusty_ipc_close(&avb_chan);
 
+#ifdef TIPC_ENABLE_AVB_CACHE
+    /* the next connection may be to another Trusty instance */
+    trusty_avb_cache_enable(false);
+#endif
+
     initialized = false;
 }
 
-int trusty_read_rollback_index(uint32_t slot, uint64_t* value) {
+#ifdef TIPC_ENABLE_AVB_CACHE
+void trusty_avb_cache_enable(bool enable) {
+    if (!enable) {
+        avb_cache_invalidate();
+    }
+    avb_cache.enabled = enable;
+}
+
+struct trusty_avb_cache_stats* trusty_avb_cache_stats(void) {
+    return &avb_cache.stats;
+}
+#endif
+
+static int avb_read_rollback(uint32_t slot, uint64_t* value) {
     int rc;
     struct avb_rollback_req req = {.slot = slot, .value = 0};
     struct avb_rollback_resp resp;
@@ -183,7 +409,7 @@ int trusty_read_rollback_index(uint32_t slot, uint64_t* value) {
     return rc;
 }
 
-int trusty_write_rollback_index(uint32_t slot, uint64_t value) {
+static int avb_write_rollback(uint32_t slot, uint64_t value) {
     int rc;
     struct avb_rollback_req req = {.slot = slot, .value = value};
     struct avb_rollback_resp resp;
@@ -194,11 +420,248 @@ int trusty_write_rollback_index(uint32_t slot, uint64_t value) {
     return rc;
 }
 
+int trusty_read_rollback_index(uint32_t slot, uint64_t* value) {
+    int rc;
+
+    if (avb_cache_account(avb_cache_rollback_lookup(slot, value))) {
+        return TRUSTY_ERR_NONE;
+    }
+    rc = avb_read_rollback(slot, value);
+    if (rc == 0) {
+        avb_cache_rollback_store(slot, *value);
+    }
+    return rc;
+}
+
+int trusty_write_rollback_index(uint32_t slot, uint64_t value) {
+    int rc = avb_write_rollback(slot, value);
+
+    if (rc == 0) {
+        avb_cache_rollback_store(slot, value);
+    } else {
+        avb_cache_rollback_drop(slot);
+    }
+    return rc;
+}
+
+/*
+ * Sends a READ_ROLLBACK_INDEX_MULTI or WRITE_ROLLBACK_INDEX_MULTI request
+ * for @count entries straight from @entries and receives the values of the
+ * response back into it. Returns a trusty_err, TRUSTY_ERR_NOT_SUPPORTED if the
+ * service rejected the request.
+ */
+static int avb_rollback_multi(uint32_t cmd,
+                              struct avb_rollback_req* entries,
+                              size_t count) {
+    int rc;
+    struct avb_message msg = {.cmd = cmd};
+    size_t entries_len = count * sizeof(*entries);
+    struct avb_rollback_multi req = {
+            .count = count,
+            .entries = (const uint8_t*)entries,
+            .entries_size = entries_len,
+    };
+    struct trusty_ipc_iovec req_iovs[3] = {
+            {.base = &msg, .len = sizeof(msg)},
+    };
+
+    if (!initialized) {
+        trusty_error("%s: AVB TIPC client not initialized\n", __func__);
+        return TRUSTY_ERR_GENERIC;
+    }
+
+    rc = trusty_ipc_schema_to_iovecs(&avb_rollback_multi_schema, &req,
+                                     req_iovs + 1, NELEMS(req_iovs) - 1);
+    if (rc < 0) {
+        return rc;
+    }
+    rc = trusty_ipc_send(&avb_chan, req_iovs, rc + 1, true);
+    if (rc < 0) {
+        trusty_error("%s: failed (%d) to send AVB request\n", __func__, rc);
+        return rc;
+    }
+    rc = avb_read_response(&msg, cmd, count ? entries : NULL, entries_len);
+    if (rc < 0) {
+        trusty_error("%s: failed (%d) to read AVB response\n", __func__, rc);
+        return rc;
+    }
+    if (msg.result == AVB_ERROR_INVALID && avb_multi != AVB_MULTI_SUPPORTED) {
+        trusty_debug("%s: multi slot requests not supported\n", __func__);
+        return TRUSTY_ERR_NOT_SUPPORTED;
+    }
+    if (msg.result != AVB_ERROR_NONE) {
+        trusty_error("%s: AVB service returned error (%d)\n", __func__,
+                     msg.result);
+        return TRUSTY_ERR_GENERIC;
+    }
+    if ((size_t)rc != entries_len) {
+        trusty_error("%s: unexpected response size (%d)\n", __func__, rc);
+        return TRUSTY_ERR_GENERIC;
+    }
+    return TRUSTY_ERR_NONE;
+}
+
+/*
+ * Finds out once per connection whether the service handles multi slot
+ * requests, by sending an empty one. An unsupported command is rejected with
+ * AVB_ERROR_INVALID, the same as a request with a bad slot, so a real request
+ * can not be used for this without risking a partial fallback write.
+ */
+static bool avb_multi_supported(void) {
+    int rc;
+
+    if (avb_multi == AVB_MULTI_UNKNOWN) {
+        rc = avb_rollback_multi(READ_ROLLBACK_INDEX_MULTI, NULL, 0);
+        if (rc == TRUSTY_ERR_NONE) {
+            avb_multi = AVB_MULTI_SUPPORTED;
+        } else if (rc == TRUSTY_ERR_NOT_SUPPORTED) {
+            avb_multi = AVB_MULTI_UNSUPPORTED;
+        }
+    }
+    /* on other errors the real request reports them */
+    return avb_multi != AVB_MULTI_UNSUPPORTED;
+}
+
+int trusty_read_rollback_indexes(struct avb_rollback_req* entries,
+                                 size_t count) {
+    int rc;
+    size_t i;
+    uint64_t value;
+
+    if (count > AVB_ROLLBACK_MULTI_MAX || (count && !entries)) {
+        return TRUSTY_ERR_INVALID_ARGS;
+    }
+    for (i = 0; i < count; i++) {
+        if (!avb_cache_rollback_lookup(entries[i].slot, &value)) {
+            break;
+        }
+        entries[i].value = value;
+    }
+    if (avb_cache_account(avb_cache_enabled() && i == count)) {
+        return TRUSTY_ERR_NONE;
+    }
+
+    if (avb_multi_supported()) {
+        rc = avb_rollback_multi(READ_ROLLBACK_INDEX_MULTI, entries, count);
+        if (rc != 0) {
+            return rc;
+        }
+    } else {
+        for (i = 0; i < count; i++) {
+            rc = avb_read_rollback(entries[i].slot, &value);
+            if (rc != 0) {
+                return rc;
+            }
+            entries[i].value = value;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        avb_cache_rollback_store(entries[i].slot, entries[i].value);
+    }
+    return TRUSTY_ERR_NONE;
+}
+
+int trusty_write_rollback_indexes(struct avb_rollback_req* entries,
+                                  size_t count) {
+    int rc = TRUSTY_ERR_NONE;
+    size_t i;
+
+    if (count > AVB_ROLLBACK_MULTI_MAX || (count && !entries)) {
+        return TRUSTY_ERR_INVALID_ARGS;
+    }
+
+    if (avb_multi_supported()) {
+        rc = avb_rollback_multi(WRITE_ROLLBACK_INDEX_MULTI, entries, count);
+    } else {
+        for (i = 0; i < count && rc == 0; i++) {
+            rc = avb_write_rollback(entries[i].slot, entries[i].value);
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (rc == 0) {
+            avb_cache_rollback_store(entries[i].slot, entries[i].value);
+        } else {
+            avb_cache_rollback_drop(entries[i].slot);
+        }
+    }
+    return rc;
+}
+
+int trusty_read_avb_snapshot(void* buf,
+                             uint32_t size,
+                             const struct avb_snapshot_resp** snapshot) {
+    int rc;
+    uint32_t i;
+    struct avb_message msg = {.cmd = AVB_GET_SNAPSHOT};
+    const struct avb_snapshot_resp* resp = buf;
+    struct avb_snapshot fields;
+
+    if (!buf || size < sizeof(*resp) || !snapshot) {
+        return TRUSTY_ERR_INVALID_ARGS;
+    }
+    if (!initialized) {
+        trusty_error("%s: AVB TIPC client not initialized\n", __func__);
+        return TRUSTY_ERR_GENERIC;
+    }
+
+    rc = avb_send_request(&msg, NULL, 0);
+    if (rc < 0) {
+        trusty_error("%s: failed (%d) to send AVB request\n", __func__, rc);
+        return rc;
+    }
+    rc = avb_read_response(&msg, AVB_GET_SNAPSHOT, buf, size);
+    if (rc < 0) {
+        trusty_error("%s: failed (%d) to read AVB response\n", __func__, rc);
+        return rc;
+    }
+    /* the request has no payload that could be invalid */
+    if (msg.result == AVB_ERROR_INVALID) {
+        trusty_debug("%s: snapshot not supported\n", __func__);
+        return TRUSTY_ERR_NOT_SUPPORTED;
+    }
+    if (msg.result != AVB_ERROR_NONE) {
+        trusty_error("%s: AVB service returned error (%d)\n", __func__,
+                     msg.result);
+        return TRUSTY_ERR_GENERIC;
+    }
+    if (trusty_ipc_schema_decode(&avb_snapshot_schema, &fields, buf, rc) ||
+        fields.rollback_size % sizeof(uint64_t) ||
+        fields.rollback_size / sizeof(uint64_t) != fields.rollback_count) {
+        trusty_error("%s: malformed snapshot (%d bytes)\n", __func__, rc);
+        return TRUSTY_ERR_GENERIC;
+    }
+
+    avb_cache_lock_state_store(&resp->lock_state);
+    for (i = 0; i < resp->rollback_count; i++) {
+        avb_cache_rollback_store(i, resp->rollback[i]);
+    }
+    *snapshot = resp;
+    return TRUSTY_ERR_NONE;
+}
+
 int trusty_read_permanent_attributes(uint8_t* attributes, uint32_t size) {
-    uint8_t resp_buf[AVB_MAX_BUFFER_LENGTH];
-    uint32_t resp_size = AVB_MAX_BUFFER_LENGTH;
-    int rc = avb_do_tipc(READ_PERMANENT_ATTRIBUTES, NULL, 0, resp_buf,
-                         &resp_size);
+    uint32_t resp_size = size;
+    const uint8_t* cached;
+    uint32_t cached_size;
+    int rc;
+
+    cached = avb_cache_perm_attr_lookup(&cached_size);
+    if (avb_cache_account(cached)) {
+        if (size != cached_size) {
+            return TRUSTY_ERR_INVALID_ARGS;
+        }
+        trusty_memcpy(attributes, cached, size);
+        return TRUSTY_ERR_NONE;
+    }
+
+    /* receive straight into the caller buffer */
+    rc = avb_do_tipc(READ_PERMANENT_ATTRIBUTES, NULL, 0, attributes,
+                     &resp_size);
+    if (rc == TRUSTY_ERR_MSG_TOO_BIG) {
+        return TRUSTY_ERR_INVALID_ARGS;
+    }
     if (rc != 0) {
         return rc;
     }
@@ -206,25 +669,143 @@ int trusty_read_permanent_attributes(uint8_t* attributes, uint32_t size) {
     if (size != resp_size) {
         return TRUSTY_ERR_INVALID_ARGS;
     }
-    trusty_memcpy(attributes, resp_buf, resp_size);
+    avb_cache_perm_attr_store(attributes, size);
+    return rc;
+}
+
+#ifdef TIPC_ENABLE_AVB_CACHE
+/*
+ * Receives the READ_PERMANENT_ATTRIBUTES response of a secure OS that cannot
+ * peek at it into the cache, which keeps the attributes if it is enabled.
+ */
+static int avb_recv_perm_attr(struct avb_message* msg, uint32_t* attr_size) {
+    int rc = avb_read_response(msg, READ_PERMANENT_ATTRIBUTES,
+                               avb_cache.perm_attr,
+                               sizeof(avb_cache.perm_attr));
+
+    avb_cache.perm_attr_size = 0;
+    if (rc >= 0 && msg->result == AVB_ERROR_NONE) {
+        *attr_size = rc;
+        avb_cache.perm_attr_size = avb_cache.enabled ? *attr_size : 0;
+    }
     return rc;
 }
+#else
+/*
+ * Drops the READ_PERMANENT_ATTRIBUTES response of a secure OS that has just
+ * rejected the peek at it. There is no buffer to receive the attributes into.
+ */
+static int avb_recv_perm_attr(struct avb_message* msg, uint32_t* attr_size) {
+    void* resp;
+    int rc = trusty_ipc_recv_borrow(&avb_chan, &resp, true);
+
+    return rc < 0 ? rc : TRUSTY_ERR_NOT_SUPPORTED;
+}
+#endif
+
+int trusty_read_permanent_attributes_size(uint32_t* size) {
+    struct avb_message msg = {.cmd = READ_PERMANENT_ATTRIBUTES};
+    struct trusty_ipc_iovec head = {.base = &msg, .len = sizeof(msg)};
+    uint8_t last;
+    struct trusty_ipc_iovec tail = {.base = &last, .len = sizeof(last)};
+    size_t msg_len;
+    uint32_t attr_size = 0;
+    int rc;
+
+    if (!size) {
+        return TRUSTY_ERR_INVALID_ARGS;
+    }
+    if (avb_cache_account(avb_cache_perm_attr_lookup(size))) {
+        return TRUSTY_ERR_NONE;
+    }
+    if (!initialized) {
+        trusty_error("%s: AVB TIPC client not initialized\n", __func__);
+        return TRUSTY_ERR_GENERIC;
+    }
+#ifndef TIPC_ENABLE_AVB_CACHE
+    /* the whole response would have to be received, with nowhere to go */
+    if (!trusty_ipc_dev_has_recv_partial(avb_chan.dev)) {
+        return TRUSTY_ERR_NOT_SUPPORTED;
+    }
+#endif
+
+    rc = avb_send_request(&msg, NULL, 0);
+    if (rc < 0) {
+        trusty_error("%s: failed (%d) to send AVB request\n", __func__, rc);
+        return rc;
+    }
+
+    rc = trusty_ipc_peek_msg_size(&avb_chan, true);
+    if (rc == TRUSTY_ERR_NOT_SUPPORTED) {
+        rc = avb_recv_perm_attr(&msg, &attr_size);
+        if (rc == TRUSTY_ERR_NOT_SUPPORTED) {
+            return rc;
+        }
+    } else if (rc >= 0 && (size_t)rc <= sizeof(msg)) {
+        rc = avb_read_response(&msg, READ_PERMANENT_ATTRIBUTES, NULL, 0);
+    } else if (rc >= 0) {
+        /* read the header, then the last byte to drop the response */
+        msg_len = rc;
+        rc = trusty_ipc_recv_at(&avb_chan, 0, &head, 1, NULL);
+        if (rc >= 0) {
+            rc = trusty_ipc_recv_at(&avb_chan, msg_len - 1, &tail, 1, NULL);
+        }
+        if (rc >= 0 && msg.cmd != (READ_PERMANENT_ATTRIBUTES | AVB_RESP_BIT)) {
+            trusty_error("malformed response\n");
+            rc = TRUSTY_ERR_GENERIC;
+        }
+        attr_size = msg_len - sizeof(msg);
+    }
+    if (rc < 0) {
+        trusty_error("%s: failed (%d) to read AVB response\n", __func__, rc);
+        return rc;
+    }
+    if (msg.result != AVB_ERROR_NONE) {
+        trusty_error("%s: AVB service returned error (%d)\n", __func__,
+                     msg.result);
+        return TRUSTY_ERR_GENERIC;
+    }
+    *size = attr_size;
+    return TRUSTY_ERR_NONE;
+}
 
 int trusty_write_permanent_attributes(uint8_t* attributes, uint32_t size) {
-    return avb_do_tipc(WRITE_PERMANENT_ATTRIBUTES, attributes, size, NULL,
-                       NULL);
+    int rc = avb_do_tipc(WRITE_PERMANENT_ATTRIBUTES, attributes, size, NULL,
+                         NULL);
+
+    avb_cache_perm_attr_store(rc == 0 ? attributes : NULL, size);
+    return rc;
 }
 
 int trusty_read_lock_state(uint8_t* lock_state) {
     uint32_t resp_size = sizeof(*lock_state);
-    return avb_do_tipc(READ_LOCK_STATE, NULL, 0, lock_state, &resp_size);
+    int rc;
+
+    if (avb_cache_account(avb_cache_lock_state_lookup(lock_state))) {
+        return TRUSTY_ERR_NONE;
+    }
+    rc = avb_do_tipc(READ_LOCK_STATE, NULL, 0, lock_state, &resp_size);
+    if (rc == 0) {
+        avb_cache_lock_state_store(lock_state);
+    }
+    return rc;
 }
 
 int trusty_write_lock_state(uint8_t lock_state) {
-    return avb_do_tipc(WRITE_LOCK_STATE, &lock_state, sizeof(lock_state), NULL,
-                       NULL);
+    uint8_t cached;
+    int rc = avb_do_tipc(WRITE_LOCK_STATE, &lock_state, sizeof(lock_state),
+                         NULL, NULL);
+
+    /* changing the lock state clears the rollback indexes */
+    if (rc != 0 || !avb_cache_lock_state_lookup(&cached) ||
+        cached != lock_state) {
+        avb_cache_rollback_drop_all();
+    }
+    avb_cache_lock_state_store(rc == 0 ? &lock_state : NULL);
+    return rc;
 }
 
 int trusty_lock_boot_state(void) {
+    avb_cache_invalidate();
     return avb_do_tipc(LOCK_BOOT_STATE, NULL, 0, NULL, NULL);
 }
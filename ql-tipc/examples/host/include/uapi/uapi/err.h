@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef QL_TIPC_HOST_UAPI_ERR_H_
+#define QL_TIPC_HOST_UAPI_ERR_H_
+
+/* Host stand-in for the Trusty error codes used by hwbcc.c */
+
+#define NO_ERROR (0)
+#define ERR_GENERIC (-1)
+#define ERR_NOT_FOUND (-2)
+#define ERR_NOT_READY (-3)
+#define ERR_NO_MSG (-4)
+#define ERR_NO_MEMORY (-5)
+#define ERR_INVALID_ARGS (-8)
+#define ERR_NOT_ENOUGH_BUFFER (-9)
+#define ERR_NOT_SUPPORTED (-24)
+#define ERR_ACCESS_DENIED (-30)
+
+#endif /* QL_TIPC_HOST_UAPI_ERR_H_ */
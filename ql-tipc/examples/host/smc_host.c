@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Simulated secure monitor for host builds. Implements the subset of the
+ * Trusty SMC and FF-A ABI used by ql-tipc and forwards queueless IPC device
+ * calls to the simulated secure side in trusty_sim.c.
+ */
+
+#include <trusty/arm_ffa.h>
+#include <trusty/sm_err.h>
+#include <trusty/smc.h>
+#include <trusty/smcall.h>
+#include <trusty/trusty_mem.h>
+#include <uapi/uapi/err.h>
+
+#include <stddef.h>
+
+#include "trusty_sim.h"
+
+#define SIM_MAX_SHARED_MEM 8
+#define SIM_FFA_LOCAL_ID 0x1
+#define SIM_VERSION_STR "Trusty host simulator"
+
+struct sim_shared_mem {
+    uint64_t id;
+    void* va;
+    size_t size;
+};
+
+static struct {
+    struct sim_shared_mem mem[SIM_MAX_SHARED_MEM];
+    uint64_t next_id;
+    void* ffa_tx;
+} monitor = {.next_id = 1};
+
+static struct smc_ret8 ffa_error(long error) {
+    return (struct smc_ret8){.r0 = SMC_FC_FFA_ERROR, .r2 = error};
+}
+
+static struct smc_ret8 ffa_success(unsigned long r2) {
+    return (struct smc_ret8){.r0 = SMC_FC_FFA_SUCCESS, .r2 = r2};
+}
+
+static struct sim_shared_mem* lookup_mem(unsigned long lo, unsigned long hi) {
+    size_t i;
+    uint64_t id = (uint64_t)(uint32_t)lo | ((uint64_t)hi << 32);
+
+    for (i = 0; i < SIM_MAX_SHARED_MEM; i++) {
+        if (monitor.mem[i].va && monitor.mem[i].id == id)
+            return &monitor.mem[i];
+    }
+    return NULL;
+}
+
+/*
+ * Parses the memory transaction descriptor in the TX buffer. Only a single
+ * receiver and a single address range are supported, which is all
+ * trusty_dev_share_memory produces.
+ */
+static struct smc_ret8 ffa_mem_share(unsigned long total_len) {
+    size_t i;
+    const struct ffa_mtd* mtd = monitor.ffa_tx;
+    const struct ffa_comp_mrd* comp_mrd;
+    const struct ffa_cons_mrd* cons_mrd;
+
+    if (!mtd || total_len > FFA_PAGE_SIZE || mtd->emad_count != 1 ||
+        mtd->emad[0].comp_mrd_offset + sizeof(*comp_mrd) +
+                        sizeof(*cons_mrd) > total_len) {
+        return ffa_error(FFA_ERROR_INVALID_PARAMETERS);
+    }
+    comp_mrd = (const void*)((const uint8_t*)mtd +
+                             mtd->emad[0].comp_mrd_offset);
+    if (comp_mrd->address_range_count != 1)
+        return ffa_error(FFA_ERROR_INVALID_PARAMETERS);
+    cons_mrd = comp_mrd->address_range_array;
+
+    for (i = 0; i < SIM_MAX_SHARED_MEM; i++) {
+        if (!monitor.mem[i].va) {
+            monitor.mem[i].id = monitor.next_id++;
+            monitor.mem[i].va = (void*)(uintptr_t)cons_mrd->address;
+            monitor.mem[i].size = (size_t)cons_mrd->page_count * FFA_PAGE_SIZE;
+            return ffa_success(monitor.mem[i].id);
+        }
+    }
+    return ffa_error(FFA_ERROR_NO_MEMORY);
+}
+
+static struct smc_ret8 ffa_mem_reclaim(unsigned long lo, unsigned long hi) {
+    struct sim_shared_mem* mem = lookup_mem(lo, hi);
+
+    if (!mem)
+        return ffa_error(FFA_ERROR_INVALID_PARAMETERS);
+    mem->va = NULL;
+    return ffa_success(0);
+}
+
+/*
+ * Forwards queueless IPC device call @smcnr to the simulated secure side. The
+ * shared buffer is named by the FF-A memory handle in @lo and @hi.
+ */
+static unsigned long ql_dev_call(unsigned long smcnr,
+                                 unsigned long lo,
+                                 unsigned long hi,
+                                 unsigned long size) {
+    int rc;
+    struct sim_shared_mem* mem = lookup_mem(lo, hi);
+
+    if (!mem || size > mem->size)
+        return (uint32_t)ERR_INVALID_ARGS;
+
+    switch (smcnr) {
+    case SMC_SC_TRUSTY_IPC_CREATE_QL_DEV:
+        rc = trusty_sim_dev_create(mem->va, size);
+        break;
+    case SMC_SC_TRUSTY_IPC_HANDLE_QL_DEV_CMD:
+        rc = trusty_sim_dev_exec(mem->va, mem->size, size, false);
+        break;
+    case SMC_FC_HANDLE_QL_TIPC_DEV_CMD:
+        rc = trusty_sim_dev_exec(mem->va, mem->size, size, true);
+        break;
+    default:
+        trusty_sim_dev_shutdown(mem->va);
+        rc = NO_ERROR;
+    }
+    return (uint32_t)rc;
+}
+
+struct smc_ret8 smc8(unsigned long r0,
+                     unsigned long r1,
+                     unsigned long r2,
+                     unsigned long r3,
+                     unsigned long r4,
+                     unsigned long r5,
+                     unsigned long r6,
+                     unsigned long r7) {
+    struct smc_ret8 ret = {0};
+
+    switch ((uint32_t)r0) {
+    case SMC_FC_API_VERSION:
+        ret.r0 = trusty_sim_api_version();
+        if (r1 < ret.r0)
+            ret.r0 = r1;
+        return ret;
+
+    case SMC_SC_NOP:
+        ret.r0 = SM_ERR_NOP_DONE;
+        return ret;
+
+    case SMC_FC_GET_VERSION_STR:
+        /* index -1 asks for the length, any other index for a character */
+        trusty_sim_stats()->fast_calls++;
+        if ((int32_t)r1 == -1)
+            ret.r0 = sizeof(SIM_VERSION_STR) - 1;
+        else if (r1 < sizeof(SIM_VERSION_STR) - 1)
+            ret.r0 = (unsigned char)SIM_VERSION_STR[r1];
+        else
+            ret.r0 = (unsigned long)SM_ERR_INVALID_PARAMETERS;
+        return ret;
+
+    case SMC_FC_FFA_VERSION:
+        ret.r0 = FFA_CURRENT_VERSION;
+        return ret;
+
+    case SMC_FC_FFA_FEATURES:
+        if (r1 == SMC_FC_FFA_MEM_SHARE)
+            return ffa_success(0);
+        return ffa_error(FFA_ERROR_NOT_SUPPORTED);
+
+    case SMC_FC_FFA_ID_GET:
+        return ffa_success(SIM_FFA_LOCAL_ID);
+
+    case SMC_FC_FFA_RXTX_MAP:
+    case SMC_FC64_FFA_RXTX_MAP:
+        monitor.ffa_tx = (void*)(uintptr_t)r1;
+        return ffa_success(0);
+
+    case SMC_FC_FFA_RXTX_UNMAP:
+        monitor.ffa_tx = NULL;
+        return ffa_success(0);
+
+    case SMC_FC_FFA_MEM_SHARE:
+        return ffa_mem_share(r1);
+
+    case SMC_FC_FFA_MEM_RECLAIM:
+        return ffa_mem_reclaim(r1, r2);
+
+    case SMC_SC_TRUSTY_IPC_CREATE_QL_DEV:
+    case SMC_SC_TRUSTY_IPC_HANDLE_QL_DEV_CMD:
+    case SMC_FC_HANDLE_QL_TIPC_DEV_CMD:
+    case SMC_SC_TRUSTY_IPC_SHUTDOWN_QL_DEV:
+        ret.r0 = ql_dev_call(r0, r1, r2, r3);
+        return ret;
+
+    default:
+        ret.r0 = SM_ERR_UNDEFINED_SMC;
+        return ret;
+    }
+}
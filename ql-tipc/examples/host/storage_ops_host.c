@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <trusty/rpmb.h>
+#include <trusty/trusty_ipc.h>
+#include <trusty/util.h>
+
+#include "storage_ops_host.h"
+#include "trusty_sim.h"
+
+/*
+ * Commands started with rpmb_storage_send_async are only executed by
+ * rpmb_storage_wait, so buffers released too early show up as corrupt frames
+ * or, with ASan, as use-after-free.
+ */
+#define HOST_RPMB_PENDING 32
+
+/*
+ * Minimal stand-in for an RPMB partition. Frames are not authenticated,
+ * every read returns copies of the last frame written so the storage proxy
+ * moves realistic amounts of data.
+ */
+struct host_rpmb {
+    uint8_t last_frame[MMC_BLOCK_SIZE];
+    uint64_t frames;
+#ifdef TIPC_ENABLE_RPMB_ASYNC
+    struct rpmb_storage_cmd pending[HOST_RPMB_PENDING];
+    size_t pending_count;
+    int pending_rc;
+#endif
+};
+
+static struct host_rpmb host_rpmb[HOST_RPMB_DEVICES];
+
+void* rpmb_storage_get_ctx(void) {
+    return &host_rpmb[0];
+}
+
+void* host_rpmb_get_dev(unsigned index) {
+    return index < HOST_RPMB_DEVICES ? &host_rpmb[index] : NULL;
+}
+
+uint64_t host_rpmb_frames(void* rpmb_dev) {
+    struct host_rpmb* rpmb = rpmb_dev;
+
+    return rpmb->frames;
+}
+
+void rpmb_storage_put_ctx(void* dev) {}
+
+static int host_rpmb_exec(struct host_rpmb* rpmb,
+                          const struct rpmb_storage_cmd* cmd) {
+    size_t i;
+    size_t frames;
+    struct trusty_sim_stats* stats = trusty_sim_stats();
+
+    if (!rpmb || cmd->reliable_write_size % MMC_BLOCK_SIZE ||
+        cmd->write_size % MMC_BLOCK_SIZE || cmd->read_size % MMC_BLOCK_SIZE) {
+        return TRUSTY_ERR_INVALID_ARGS;
+    }
+
+    if (cmd->reliable_write_size) {
+        trusty_memcpy(rpmb->last_frame,
+                      (const uint8_t*)cmd->reliable_write_data +
+                              cmd->reliable_write_size - MMC_BLOCK_SIZE,
+                      MMC_BLOCK_SIZE);
+    }
+    if (cmd->write_size) {
+        trusty_memcpy(rpmb->last_frame,
+                      (const uint8_t*)cmd->write_data + cmd->write_size -
+                              MMC_BLOCK_SIZE,
+                      MMC_BLOCK_SIZE);
+    }
+    for (i = 0; i < cmd->read_size; i += MMC_BLOCK_SIZE) {
+        trusty_memcpy((uint8_t*)cmd->read_buf + i, rpmb->last_frame,
+                      MMC_BLOCK_SIZE);
+    }
+
+    frames = (cmd->reliable_write_size + cmd->write_size + cmd->read_size) /
+             MMC_BLOCK_SIZE;
+    rpmb->frames += frames;
+    stats->rpmb_frames += frames;
+    return TRUSTY_ERR_NONE;
+}
+
+int rpmb_storage_send(void* rpmb_dev,
+                      const void* rel_write_data,
+                      size_t rel_write_size,
+                      const void* write_data,
+                      size_t write_size,
+                      void* read_buf,
+                      size_t read_size) {
+    struct rpmb_storage_cmd cmd = {
+            .reliable_write_data = rel_write_data,
+            .reliable_write_size = rel_write_size,
+            .write_data = write_data,
+            .write_size = write_size,
+            .read_buf = read_buf,
+            .read_size = read_size,
+    };
+
+    trusty_sim_stats()->rpmb_sends++;
+    return host_rpmb_exec(rpmb_dev, &cmd);
+}
+
+#ifdef TIPC_ENABLE_RPMB_MULTI_CMD
+int rpmb_storage_send_multi(void* rpmb_dev,
+                            const struct rpmb_storage_cmd* cmds,
+                            size_t count) {
+    int rc = TRUSTY_ERR_NONE;
+    size_t i;
+
+    /* like one MMC_IOC_MULTI_CMD */
+    trusty_sim_stats()->rpmb_sends++;
+    for (i = 0; i < count && !rc; i++) {
+        rc = host_rpmb_exec(rpmb_dev, &cmds[i]);
+    }
+    return rc;
+}
+#endif
+
+#ifdef TIPC_ENABLE_RPMB_ASYNC
+int rpmb_storage_wait(void* rpmb_dev) {
+    int rc;
+    size_t i;
+    struct host_rpmb* rpmb = rpmb_dev;
+
+    if (!rpmb)
+        return TRUSTY_ERR_INVALID_ARGS;
+
+    for (i = 0; i < rpmb->pending_count && !rpmb->pending_rc; i++) {
+        rpmb->pending_rc = host_rpmb_exec(rpmb, &rpmb->pending[i]);
+    }
+    rc = rpmb->pending_rc;
+    rpmb->pending_count = 0;
+    rpmb->pending_rc = TRUSTY_ERR_NONE;
+    return rc;
+}
+
+int rpmb_storage_send_async(void* rpmb_dev,
+                            const struct rpmb_storage_cmd* cmds,
+                            size_t count) {
+    size_t i;
+    struct host_rpmb* rpmb = rpmb_dev;
+
+    if (!rpmb)
+        return TRUSTY_ERR_INVALID_ARGS;
+
+    trusty_sim_stats()->rpmb_sends++;
+    for (i = 0; i < count; i++) {
+        if (rpmb->pending_count == HOST_RPMB_PENDING) {
+            /* the queue of the device is full, drain it */
+            rpmb->pending_rc = rpmb_storage_wait(rpmb);
+        }
+        rpmb->pending[rpmb->pending_count++] = cmds[i];
+    }
+    return TRUSTY_ERR_NONE;
+}
+#endif
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef QL_TIPC_HOST_STORAGE_OPS_HOST_H_
+#define QL_TIPC_HOST_STORAGE_OPS_HOST_H_
+
+/*
+ * Stand-in RPMB devices for host builds, see storage_ops_host.c. Device 0 is
+ * the one rpmb_storage_get_ctx returns.
+ */
+
+#include <trusty/sysdeps.h>
+
+#define HOST_RPMB_DEVICES 2
+
+/*
+ * Returns RPMB device @index, to pass as rpmb_dev to the storage proxy, or
+ * NULL if there is no such device.
+ */
+void* host_rpmb_get_dev(unsigned index);
+
+/*
+ * Returns the number of frames device @rpmb_dev has read or written.
+ */
+uint64_t host_rpmb_frames(void* rpmb_dev);
+
+#endif /* QL_TIPC_HOST_STORAGE_OPS_HOST_H_ */
@@ -0,0 +1,1272 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Host benchmark and regression gate for ql-tipc. Runs the client libraries
+ * against the simulated secure side and reports, per operation, wall time,
+ * the number of calls into the secure side and the bytes moved through the
+ * shared buffer.
+ */
+
+#include <interface/storage/storage.h>
+#include <trusty/avb.h>
+#include <trusty/hwbcc.h>
+#include <trusty/hwbcc_handover.h>
+#include <trusty/keymaster.h>
+#include <trusty/keymaster_serializable.h>
+#include <trusty/libtipc.h>
+#include <trusty/rpmb.h>
+#include <trusty/trusty_dev.h>
+#include <trusty/trusty_ipc.h>
+#include <trusty/trusty_ipc_framer.h>
+#include <trusty/trusty_ipc_loopback.h>
+#include <trusty/trusty_ipc_record.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "storage_ops_host.h"
+#include "trusty_sim.h"
+
+#define BENCH_MAX_MSG 4000
+#define BENCH_DICE_BUF_SIZE 4096
+#define BENCH_CA_RESPONSE_SIZE 8192
+#define BENCH_CERT_SIZE 1024
+
+extern bool trusty_host_quiet;
+
+enum bench_transport {
+    BENCH_SMC,
+    BENCH_LOOPBACK,
+    BENCH_REPLAY,
+};
+
+/*
+ * A benchmarked operation.
+ *
+ * @suite: group the benchmark belongs to, selectable with -s
+ * @name:  name printed in the report
+ * @size:  message size passed to @run, if relevant
+ * @run:   performs iteration @i of the operation. Returns 0 on success.
+ * @iovs:  iovec lengths, zero terminated, for the copy benchmarks
+ */
+struct bench {
+    const char* suite;
+    const char* name;
+    size_t size;
+    int (*run)(const struct bench* b, unsigned i);
+    const size_t* iovs;
+};
+
+static enum bench_transport transport = BENCH_SMC;
+static size_t shared_buf_size = PAGE_SIZE;
+static struct trusty_sim_config sim_config;
+static struct trusty_dev tdev;
+static struct trusty_ipc_dev* ipc_dev;
+static struct trusty_ipc_replay replay;
+static struct trusty_ipc_chan echo_chan;
+static uint64_t instance_id;
+static struct trusty_version_handoff avb_handoff;
+static struct trusty_version_handoff km_handoff;
+static uint8_t echo_tx[BENCH_MAX_MSG];
+static uint8_t echo_rx[BENCH_MAX_MSG];
+static uint8_t ca_response[BENCH_CA_RESPONSE_SIZE];
+static uint8_t cert[BENCH_CERT_SIZE];
+static uint8_t copy_buf[PAGE_SIZE];
+static uint8_t copy_data[PAGE_SIZE];
+static uint64_t copy_bytes;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Raw Trusty IPC */
+
+static int bench_connect_close(const struct bench* b, unsigned i) {
+    int handle = trusty_ipc_dev_connect(ipc_dev, TRUSTY_SIM_ECHO_PORT, i);
+    struct trusty_ipc_event evt;
+    int rc;
+
+    if (handle < 0)
+        return handle;
+    rc = trusty_ipc_dev_get_event(ipc_dev, handle, &evt);
+    if (rc == 0 && evt.event != IPC_HANDLE_POLL_READY)
+        rc = TRUSTY_ERR_GENERIC;
+    trusty_ipc_dev_close(ipc_dev, handle);
+    return rc;
+}
+
+static int bench_get_event(const struct bench* b, unsigned i) {
+    struct trusty_ipc_event evt;
+
+    return trusty_ipc_dev_get_event(ipc_dev, 0, &evt);
+}
+
+static int bench_has_event(const struct bench* b, unsigned i) {
+    return trusty_ipc_dev_has_event(ipc_dev, 0) ? TRUSTY_ERR_GENERIC : 0;
+}
+
+static int bench_echo(const struct bench* b, unsigned i) {
+    int rc;
+    struct trusty_ipc_iovec tx = {.base = echo_tx, .len = b->size};
+    struct trusty_ipc_iovec rx = {.base = echo_rx, .len = b->size};
+
+    echo_tx[0] = (uint8_t)i;
+    rc = trusty_ipc_send(&echo_chan, &tx, 1, true);
+    if (rc < 0)
+        return rc;
+    rc = trusty_ipc_recv(&echo_chan, &rx, 1, true);
+    if (rc < 0)
+        return rc;
+    if ((size_t)rc != b->size || memcmp(echo_tx, echo_rx, b->size))
+        return TRUSTY_ERR_GENERIC;
+    return 0;
+}
+
+#define BENCH_CHUNK_SIZE 512
+
+/*
+ * Receives a reply of unknown size into an exactly sized buffer. Falls back
+ * to a worst-case buffer if the secure side cannot peek.
+ */
+static int bench_echo_exact(const struct bench* b, unsigned i) {
+    int rc;
+    uint8_t* buf;
+    struct trusty_ipc_iovec tx = {.base = echo_tx, .len = b->size};
+    struct trusty_ipc_iovec rx;
+
+    echo_tx[0] = (uint8_t)i;
+    rc = trusty_ipc_send(&echo_chan, &tx, 1, true);
+    if (rc < 0)
+        return rc;
+    rc = trusty_ipc_peek_msg_size(&echo_chan, true);
+    if (rc == TRUSTY_ERR_NOT_SUPPORTED) {
+        rx.base = echo_rx;
+        rx.len = sizeof(echo_rx);
+        rc = trusty_ipc_recv(&echo_chan, &rx, 1, false);
+        if (rc < 0)
+            return rc;
+        buf = echo_rx;
+    } else {
+        if (rc < 0)
+            return rc;
+        buf = trusty_calloc(1, (size_t)rc);
+        if (!buf)
+            return TRUSTY_ERR_NO_MEMORY;
+        rx.base = buf;
+        rx.len = (size_t)rc;
+        rc = trusty_ipc_recv_at(&echo_chan, 0, &rx, 1, NULL);
+    }
+    if (rc >= 0 && ((size_t)rc != b->size || memcmp(echo_tx, buf, b->size)))
+        rc = TRUSTY_ERR_GENERIC;
+    if (buf != echo_rx)
+        trusty_free(buf);
+    return rc < 0 ? rc : 0;
+}
+
+/*
+ * Streams a reply through a small buffer. Falls back to a worst-case buffer
+ * if the secure side cannot do partial receives.
+ */
+static int bench_echo_stream(const struct bench* b, unsigned i) {
+    int rc;
+    size_t pos;
+    size_t msg_len;
+    uint8_t chunk[BENCH_CHUNK_SIZE];
+    struct trusty_ipc_iovec tx = {.base = echo_tx, .len = b->size};
+    struct trusty_ipc_iovec rx = {.base = chunk, .len = sizeof(chunk)};
+
+    echo_tx[0] = (uint8_t)i;
+    rc = trusty_ipc_send(&echo_chan, &tx, 1, true);
+    if (rc < 0)
+        return rc;
+    rc = trusty_ipc_peek_msg_size(&echo_chan, true);
+    if (rc == TRUSTY_ERR_NOT_SUPPORTED) {
+        rx.base = echo_rx;
+        rx.len = sizeof(echo_rx);
+        rc = trusty_ipc_recv(&echo_chan, &rx, 1, false);
+        if (rc < 0)
+            return rc;
+        if ((size_t)rc != b->size || memcmp(echo_tx, echo_rx, b->size))
+            return TRUSTY_ERR_GENERIC;
+        return 0;
+    }
+    if (rc < 0)
+        return rc;
+
+    msg_len = (size_t)rc;
+    for (pos = 0; pos < msg_len; pos += (size_t)rc) {
+        rc = trusty_ipc_recv_at(&echo_chan, pos, &rx, 1, NULL);
+        if (rc < 0)
+            return rc;
+        if (!rc || memcmp(echo_tx + pos, chunk, rc))
+            return TRUSTY_ERR_GENERIC;
+    }
+    return msg_len == b->size ? 0 : TRUSTY_ERR_GENERIC;
+}
+
+#define BENCH_FRAMED_SIZE 10000
+#define BENCH_FRAME_STOP_BIT 0x2
+
+/* Sends a message larger than the shared buffer as frames and reads it back */
+static int bench_echo_framed(const struct bench* b, unsigned i) {
+    static uint8_t tx[BENCH_FRAMED_SIZE];
+    static uint8_t rx[BENCH_FRAMED_SIZE];
+    uint32_t hdr = 0x100;
+    struct trusty_ipc_framer framer;
+    struct trusty_ipc_iovec tx_iov = {.base = tx, .len = sizeof(tx)};
+    struct trusty_ipc_iovec rx_iovs[2] = {
+            {.base = rx, .len = 100},
+            {.base = rx + 100, .len = sizeof(rx) - 100},
+    };
+    int rc;
+
+    tx[0] = (uint8_t)i;
+    tx[sizeof(tx) - 1] = (uint8_t)~i;
+    trusty_ipc_framer_init(&framer, &echo_chan, &hdr, sizeof(hdr),
+                           BENCH_FRAME_STOP_BIT, 0);
+    rc = trusty_ipc_framer_send(&framer, &tx_iov, 1, true);
+    if (rc < 0)
+        return rc;
+    rc = trusty_ipc_framer_recv(&framer, rx_iovs, 2, true);
+    if (rc < 0)
+        return rc;
+    if ((size_t)rc != sizeof(rx) || memcmp(tx, rx, sizeof(rx)) ||
+        hdr != (0x100 | BENCH_FRAME_STOP_BIT)) {
+        return TRUSTY_ERR_GENERIC;
+    }
+    return 0;
+}
+
+/* Sending to a slow service */
+
+#define BENCH_SINK_MSGS 16
+#define BENCH_SINK_MSG_SIZE 256
+
+static struct trusty_ipc_chan sink_chan;
+static struct trusty_ipc_chan sinkq_chan;
+static struct trusty_ipc_sendq sinkq;
+static uint8_t sinkq_buf[BENCH_SINK_MSGS * (BENCH_SINK_MSG_SIZE + 4)];
+static uint32_t sink_seq[2];
+
+static int sink_check(void) {
+    if (transport == BENCH_REPLAY)
+        return 0;
+    return trusty_sim_stats()->sink_errors ? TRUSTY_ERR_GENERIC : 0;
+}
+
+static int bench_sink_send(struct trusty_ipc_chan* chan, bool wait) {
+    uint32_t* next = &sink_seq[chan == &sinkq_chan];
+    size_t i;
+    int rc;
+    uint8_t msg[BENCH_SINK_MSG_SIZE] = {0};
+    struct trusty_ipc_iovec iov = {.base = msg, .len = sizeof(msg)};
+
+    for (i = 0; i < BENCH_SINK_MSGS; i++) {
+        memcpy(msg, next, sizeof(*next));
+        rc = trusty_ipc_send(chan, &iov, 1, wait);
+        if (rc < 0)
+            return rc;
+        (*next)++;
+    }
+    return 0;
+}
+
+static int bench_sink_blocking(const struct bench* b, unsigned i) {
+    int rc = bench_sink_send(&sink_chan, true);
+
+    return rc ? rc : sink_check();
+}
+
+static int bench_sink_queued(const struct bench* b, unsigned i) {
+    int rc = bench_sink_send(&sinkq_chan, false);
+
+    if (!rc)
+        rc = trusty_ipc_flush(&sinkq_chan, true);
+    return rc ? rc : sink_check();
+}
+
+/* Gather/scatter between iovecs and the shared buffer */
+
+#define BENCH_MAX_IOVS 4
+
+static size_t bench_iovs(const struct bench* b,
+                         struct trusty_ipc_iovec* iovs,
+                         size_t* total) {
+    size_t n;
+    uint8_t* pos = copy_data;
+
+    for (n = 0, *total = 0; b->iovs[n] && n < BENCH_MAX_IOVS; n++) {
+        iovs[n].base = pos;
+        iovs[n].len = b->iovs[n];
+        pos += b->iovs[n];
+        *total += b->iovs[n];
+    }
+    return n;
+}
+
+static int bench_gather(const struct bench* b, unsigned i) {
+    struct trusty_ipc_iovec iovs[BENCH_MAX_IOVS];
+    size_t total;
+    size_t n = bench_iovs(b, iovs, &total);
+
+    /* sizeof(struct trusty_ipc_cmd_hdr) bytes in, like a send */
+    if (trusty_ipc_iovec_to_buf(copy_buf + 16, sizeof(copy_buf) - 16, iovs,
+                                n) != total) {
+        return TRUSTY_ERR_GENERIC;
+    }
+    copy_bytes += total;
+    return 0;
+}
+
+static int bench_scatter(const struct bench* b, unsigned i) {
+    struct trusty_ipc_iovec iovs[BENCH_MAX_IOVS];
+    size_t total;
+    size_t n = bench_iovs(b, iovs, &total);
+
+    if (trusty_ipc_buf_to_iovec(iovs, n, copy_buf + 16, total) != total)
+        return TRUSTY_ERR_GENERIC;
+    copy_bytes += total;
+    return 0;
+}
+
+/* Table driven encode and decode of an attestation cert request */
+
+static int bench_schema_encode(const struct bench* b, unsigned i) {
+    struct km_attestation_data data = {
+            .algorithm = KM_ALGORITHM_EC,
+            .data_size = b->size,
+            .data = cert,
+    };
+    int rc = trusty_ipc_schema_encode(&km_attestation_data_schema, &data,
+                                      copy_buf, sizeof(copy_buf));
+
+    if (rc < 0)
+        return rc;
+    copy_bytes += rc;
+    return 0;
+}
+
+static int bench_schema_decode(const struct bench* b, unsigned i) {
+    struct km_attestation_data data;
+    uint32_t hdr[2] = {KM_ALGORITHM_EC, b->size};
+    int rc;
+
+    memcpy(copy_buf, hdr, sizeof(hdr));
+    rc = trusty_ipc_schema_decode(&km_attestation_data_schema, &data,
+                                  copy_buf, sizeof(hdr) + b->size);
+    if (rc)
+        return rc;
+    return data.data == copy_buf + sizeof(hdr) ? 0 : TRUSTY_ERR_GENERIC;
+}
+
+static const size_t km_boot_params_iovs[] = {4, 88, 0};
+static const size_t km_cert_iovs[] = {4, 1032, 0};
+static const size_t km_data_resp_iovs[] = {4, 4, 4, 4068, 0};
+static const size_t avb_rollback_iovs[] = {8, 8, 0};
+static const size_t avb_version_iovs[] = {8, 4, 0};
+
+/*
+ * Gets the instance id like trusty_ipc_init_handoff does in a new boot stage,
+ * with nothing cached, so that the handoff benches pay for it. Loopback
+ * transports have no Trusty device to identify and keep the fixed id set up
+ * for them.
+ */
+static int bench_instance_id(void) {
+    if (trusty_ipc_dev_has_connect_with_msg(ipc_dev)) {
+        instance_id = 0;
+        return 0;
+    }
+    if (transport != BENCH_SMC) {
+        instance_id = 1;
+        return 0;
+    }
+    tdev.instance_id = 0;
+    return trusty_dev_get_instance_id(&tdev, &instance_id);
+}
+
+/* Keymaster */
+
+static int bench_km_init(const struct bench* b, unsigned i) {
+    km_tipc_shutdown();
+    return km_tipc_init(ipc_dev);
+}
+
+static int bench_km_init_handoff(const struct bench* b, unsigned i) {
+    int rc = bench_instance_id();
+
+    if (rc)
+        return rc;
+    km_tipc_shutdown();
+    return km_tipc_init_handoff(ipc_dev, instance_id, &km_handoff);
+}
+
+static int bench_km_boot_params(const struct bench* b, unsigned i) {
+    static const uint8_t key_hash[32] = {1};
+    static const uint8_t boot_hash[32] = {2};
+
+    return trusty_set_boot_params(0x0a0000, 202601, KM_VERIFIED_BOOT_VERIFIED,
+                                  true, key_hash, sizeof(key_hash), boot_hash,
+                                  sizeof(boot_hash));
+}
+
+static int bench_km_append_cert(const struct bench* b, unsigned i) {
+    return trusty_append_attestation_cert_chain(cert, sizeof(cert),
+                                                KM_ALGORITHM_EC);
+}
+
+/*
+ * RSA and EC keys with two certs each, sent one by one or in one
+ * trusty_provision_attestation call, which pipelines them if the build sets
+ * KM_PIPELINE_DEPTH above 1
+ */
+
+#define BENCH_CHAIN_LEN 2
+
+static int bench_km_provision_serial(const struct bench* b, unsigned i) {
+    static const keymaster_algorithm_t algs[] = {KM_ALGORITHM_RSA,
+                                                 KM_ALGORITHM_EC};
+    size_t a, c;
+    int rc;
+
+    for (a = 0; a < 2; a++) {
+        rc = trusty_set_attestation_key(cert, sizeof(cert), algs[a]);
+        for (c = 0; c < BENCH_CHAIN_LEN && !rc; c++)
+            rc = trusty_append_attestation_cert_chain(cert, sizeof(cert),
+                                                      algs[a]);
+        if (rc)
+            return rc;
+    }
+    return 0;
+}
+
+static int bench_km_provision(const struct bench* b, unsigned i) {
+    static const struct trusty_attestation_cert chain[BENCH_CHAIN_LEN] = {
+            {cert, sizeof(cert)},
+            {cert, sizeof(cert)},
+    };
+    static const struct trusty_attestation_keybox keyboxes[] = {
+            {KM_ALGORITHM_RSA, cert, sizeof(cert), chain, BENCH_CHAIN_LEN},
+            {KM_ALGORITHM_EC, cert, sizeof(cert), chain, BENCH_CHAIN_LEN},
+    };
+
+    return trusty_provision_attestation(keyboxes, 2);
+}
+
+static int bench_km_get_ca_request(const struct bench* b, unsigned i) {
+    static const uint8_t operation_start[64];
+    uint8_t* ca_request;
+    uint32_t ca_request_size;
+    int rc;
+
+    rc = trusty_atap_get_ca_request(operation_start, sizeof(operation_start),
+                                    &ca_request, &ca_request_size);
+    if (rc)
+        return rc;
+    if (ca_request_size != b->size || ca_request[1] != 1)
+        rc = TRUSTY_ERR_GENERIC;
+    trusty_free(ca_request);
+    return rc;
+}
+
+static int bench_km_get_ca_request_buf(const struct bench* b, unsigned i) {
+    static const uint8_t operation_start[64];
+    static uint8_t ca_request[BENCH_CA_RESPONSE_SIZE];
+    uint32_t ca_request_size = sizeof(ca_request);
+    int rc;
+
+    rc = trusty_atap_get_ca_request_buf(operation_start,
+                                        sizeof(operation_start), ca_request,
+                                        &ca_request_size);
+    if (rc)
+        return rc;
+    return ca_request_size == b->size && ca_request[1] == 1
+                   ? 0
+                   : TRUSTY_ERR_GENERIC;
+}
+
+static int bench_km_set_ca_response(const struct bench* b, unsigned i) {
+    return trusty_atap_set_ca_response(ca_response, sizeof(ca_response));
+}
+
+static int bench_km_read_uuid(const struct bench* b, unsigned i) {
+    char* uuid;
+    int rc = trusty_atap_read_uuid_str(&uuid);
+
+    if (rc)
+        return rc;
+    if (strlen(uuid) != 32)
+        rc = TRUSTY_ERR_GENERIC;
+    trusty_free(uuid);
+    return rc;
+}
+
+/* AVB */
+
+static int bench_avb_init(const struct bench* b, unsigned i) {
+    avb_tipc_shutdown(ipc_dev);
+    return avb_tipc_init(ipc_dev);
+}
+
+static int bench_avb_init_handoff(const struct bench* b, unsigned i) {
+    int rc = bench_instance_id();
+
+    if (rc)
+        return rc;
+    avb_tipc_shutdown(ipc_dev);
+    return avb_tipc_init_handoff(ipc_dev, instance_id, &avb_handoff);
+}
+
+static int bench_avb_read_rollback(const struct bench* b, unsigned i) {
+    uint64_t value;
+
+    return trusty_read_rollback_index(i % 32, &value);
+}
+
+static int bench_avb_write_rollback(const struct bench* b, unsigned i) {
+    uint64_t value = i + 1;
+    uint64_t read_back;
+    int rc;
+
+    rc = trusty_write_rollback_index(3, value);
+    if (rc)
+        return rc;
+    rc = trusty_read_rollback_index(3, &read_back);
+    if (rc)
+        return rc;
+    return read_back == value ? 0 : TRUSTY_ERR_GENERIC;
+}
+
+#define BENCH_AVB_SLOTS 4
+
+/* Writes and reads back BENCH_AVB_SLOTS slots starting at b->size */
+static int bench_avb_rollback_multi(const struct bench* b, unsigned i) {
+    struct avb_rollback_req entries[BENCH_AVB_SLOTS];
+    size_t n;
+    int rc;
+
+    for (n = 0; n < BENCH_AVB_SLOTS; n++) {
+        entries[n].slot = b->size + n;
+        entries[n].value = i + 1;
+    }
+    rc = trusty_write_rollback_indexes(entries, BENCH_AVB_SLOTS);
+    if (rc)
+        return rc;
+    for (n = 0; n < BENCH_AVB_SLOTS; n++)
+        entries[n].value = 0;
+    rc = trusty_read_rollback_indexes(entries, BENCH_AVB_SLOTS);
+    if (rc)
+        return rc;
+    for (n = 0; n < BENCH_AVB_SLOTS; n++) {
+        if (entries[n].value != i + 1)
+            return TRUSTY_ERR_GENERIC;
+    }
+    return 0;
+}
+
+static int bench_avb_rollback_per_slot(const struct bench* b, unsigned i) {
+    uint64_t value;
+    size_t n;
+    int rc;
+
+    for (n = 0; n < BENCH_AVB_SLOTS; n++) {
+        rc = trusty_write_rollback_index(b->size + n, i + 1);
+        if (rc)
+            return rc;
+    }
+    for (n = 0; n < BENCH_AVB_SLOTS; n++) {
+        rc = trusty_read_rollback_index(b->size + n, &value);
+        if (rc)
+            return rc;
+        if (value != i + 1)
+            return TRUSTY_ERR_GENERIC;
+    }
+    return 0;
+}
+
+static int bench_avb_read_perm_attr(const struct bench* b, unsigned i) {
+    uint8_t attr[AVB_MAX_BUFFER_LENGTH];
+
+    return trusty_read_permanent_attributes(attr, b->size);
+}
+
+static int bench_avb_read_perm_attr_sized(const struct bench* b, unsigned i) {
+    uint8_t attr[AVB_MAX_BUFFER_LENGTH];
+    uint32_t size;
+    int rc;
+
+    rc = trusty_read_permanent_attributes_size(&size);
+    if (rc == TRUSTY_ERR_NOT_SUPPORTED) {
+        /* what a caller that knows the size does instead */
+        return trusty_read_permanent_attributes(attr, b->size);
+    }
+    if (rc)
+        return rc;
+    if (size != b->size)
+        return TRUSTY_ERR_GENERIC;
+    return trusty_read_permanent_attributes(attr, size);
+}
+
+static int bench_avb_read_lock_state(const struct bench* b, unsigned i) {
+    uint8_t lock_state;
+
+    return trusty_read_lock_state(&lock_state);
+}
+
+/* Reads the lock state, permanent attributes and one rollback index */
+static int bench_avb_boot_reads(const struct bench* b, unsigned i) {
+    uint8_t attr[AVB_MAX_BUFFER_LENGTH];
+    uint8_t lock_state;
+    uint64_t value;
+    int rc;
+
+    rc = trusty_read_lock_state(&lock_state);
+    if (rc)
+        return rc;
+    rc = trusty_read_permanent_attributes(attr, b->size);
+    if (rc)
+        return rc;
+    return trusty_read_rollback_index(3, &value);
+}
+
+#ifdef TIPC_ENABLE_AVB_CACHE
+static int bench_avb_boot_reads_cached(const struct bench* b, unsigned i) {
+    struct trusty_avb_cache_stats* stats = trusty_avb_cache_stats();
+    uint64_t lookups = stats->hits + stats->misses;
+    uint64_t hits = stats->hits;
+    int rc;
+
+    trusty_avb_cache_enable(true);
+    rc = bench_avb_boot_reads(b, i);
+    if (rc)
+        return rc;
+    /* only the first pass after enabling the cache may miss */
+    if (stats->hits + stats->misses != lookups + 3 ||
+        (i && stats->hits != hits + 3)) {
+        return TRUSTY_ERR_GENERIC;
+    }
+    return 0;
+}
+#endif
+
+static int bench_avb_snapshot(const struct bench* b, unsigned i) {
+    uint64_t buf[AVB_MAX_BUFFER_LENGTH / sizeof(uint64_t)];
+    const struct avb_snapshot_resp* snapshot;
+    struct avb_rollback_req entries[32];
+    uint8_t lock_state;
+    size_t n;
+    int rc;
+
+    rc = trusty_read_avb_snapshot(buf, sizeof(buf), &snapshot);
+    if (rc == TRUSTY_ERR_NONE) {
+        return snapshot->rollback_count == 32 &&
+                               snapshot->perm_attr_size == b->size
+                       ? 0
+                       : TRUSTY_ERR_GENERIC;
+    }
+    if (rc != TRUSTY_ERR_NOT_SUPPORTED)
+        return rc;
+
+    /* what a caller does without snapshots, minus the attributes digest */
+    rc = trusty_read_lock_state(&lock_state);
+    if (rc)
+        return rc;
+    for (n = 0; n < 32; n++)
+        entries[n].slot = n;
+    return trusty_read_rollback_indexes(entries, 32);
+}
+
+/* HWBCC */
+
+static int bench_hwbcc_get_dice(const struct bench* b, unsigned i) {
+    static uint8_t dice[BENCH_DICE_BUF_SIZE];
+    size_t dice_size;
+    int rc;
+
+    rc = hwbcc_get_dice_artifacts(0, dice, sizeof(dice), &dice_size);
+    if (rc)
+        return rc;
+    /* BccHandover is a map of 3 entries */
+    return dice_size && dice[0] == 0xa3 ? 0 : TRUSTY_ERR_GENERIC;
+}
+
+/* Parses the artifacts and looks at every BccEntry */
+static int bench_hwbcc_parse(const struct bench* b, unsigned i) {
+    static uint8_t dice[BENCH_DICE_BUF_SIZE];
+    static size_t dice_size;
+    struct hwbcc_handover handover;
+    struct hwbcc_view entry;
+    size_t n;
+    int rc;
+
+    if (!i) {
+        rc = hwbcc_get_dice_artifacts(0, dice, sizeof(dice), &dice_size);
+        if (rc)
+            return rc;
+    }
+    rc = hwbcc_handover_parse(dice, dice_size, &handover);
+    if (rc)
+        return rc;
+    if (handover.cdi_attest.size != 32 || handover.cdi_seal.size != 32 ||
+        handover.num_entries != sim_config.bcc_entries) {
+        return TRUSTY_ERR_GENERIC;
+    }
+    for (n = 0; n < handover.num_entries; n++) {
+        rc = hwbcc_handover_get_entry(&handover, n, &entry);
+        if (rc)
+            return rc;
+    }
+    return 0;
+}
+
+static int bench_hwbcc_get_dice_cached(const struct bench* b, unsigned i) {
+    hwbcc_cache_enable(true);
+    return bench_hwbcc_get_dice(b, i);
+}
+
+/* RPMB storage proxy */
+
+/*
+ * Has the storage service send @count requests writing @size bytes and
+ * reading @read_size bytes each and waits for the responses, one per request
+ * or one for the batch.
+ */
+static int rpmb_requests(unsigned count,
+                         uint32_t size,
+                         uint32_t read_size,
+                         bool batch) {
+    int rc;
+    unsigned polls;
+    struct trusty_sim_stats* stats = trusty_sim_stats();
+    uint64_t target = stats->storage_resps + (batch ? 1 : count);
+
+    /* When replaying, the requests come from the recording */
+    rc = trusty_sim_storage_queue_rpmb(0, count, size, read_size,
+                                       batch ? count - 1 : 0);
+    if (rc && transport != BENCH_REPLAY)
+        return rc;
+    for (polls = 0; rc != TRUSTY_EVENT_NONE; polls++) {
+        if (polls == 16 * count)
+            return TRUSTY_ERR_GENERIC;
+        rc = trusty_ipc_poll_for_event(ipc_dev);
+        if (rc < 0)
+            return rc;
+    }
+    if (transport == BENCH_REPLAY)
+        return 0;
+    return stats->storage_resps == target && !stats->storage_errors
+                   ? 0
+                   : TRUSTY_ERR_GENERIC;
+}
+
+static int bench_rpmb(const struct bench* b, unsigned i) {
+    return rpmb_requests(1, b->size, MMC_BLOCK_SIZE, false);
+}
+
+static int bench_rpmb_4x(const struct bench* b, unsigned i) {
+    return rpmb_requests(4, b->size, MMC_BLOCK_SIZE, false);
+}
+
+static int bench_rpmb_batch(const struct bench* b, unsigned i) {
+    return rpmb_requests(4, b->size, MMC_BLOCK_SIZE, true);
+}
+
+/* One request reading as many frames as the shared buffer holds */
+static int bench_rpmb_read_max(const struct bench* b, unsigned i) {
+    size_t room = trusty_ipc_dev_max_msg_size(ipc_dev) -
+                  sizeof(struct storage_msg);
+
+    return rpmb_requests(1, b->size, room - room % MMC_BLOCK_SIZE, false);
+}
+
+/* Polls until no event is left, at most @max_polls times */
+static int poll_until_idle(unsigned max_polls) {
+    int rc = TRUSTY_EVENT_HANDLED;
+    unsigned polls;
+
+    for (polls = 0; rc != TRUSTY_EVENT_NONE; polls++) {
+        if (polls == max_polls)
+            return TRUSTY_ERR_GENERIC;
+        rc = trusty_ipc_poll_for_event(ipc_dev);
+        if (rc < 0)
+            return rc;
+    }
+    return 0;
+}
+
+/*
+ * Runs the default proxy and a second one, created for the run with its own
+ * port and RPMB device, on one IPC device. Requests to the two are answered
+ * in turns. Then the second proxy gets a batch that never ends and is
+ * destroyed with it, which with TIPC_ENABLE_RPMB_ASYNC it has started on its
+ * device already.
+ */
+static int bench_rpmb_two_proxies(const struct bench* b, unsigned i) {
+    struct rpmb_storage_proxy* proxy;
+    void* devs[2] = {rpmb_storage_get_ctx(), host_rpmb_get_dev(1)};
+    uint64_t frames[2];
+    uint64_t req_frames = (b->size + MMC_BLOCK_SIZE) / MMC_BLOCK_SIZE;
+    uint64_t open_frames = 0;
+    struct trusty_sim_stats* stats = trusty_sim_stats();
+    uint64_t target = stats->storage_resps + 4;
+    unsigned n;
+    int rc;
+
+    rc = rpmb_storage_proxy_create(&proxy, ipc_dev, devs[1],
+                                   TRUSTY_SIM_STORAGE2_PORT);
+    if (rc)
+        return rc;
+    frames[0] = host_rpmb_frames(devs[0]);
+    frames[1] = host_rpmb_frames(devs[1]);
+
+    /* When replaying, the requests come from the recording */
+    for (n = 0; n < 4 && transport != BENCH_REPLAY; n++) {
+        rc = trusty_sim_storage_queue_rpmb(n % 2, 1, b->size, MMC_BLOCK_SIZE,
+                                           0);
+        if (rc)
+            goto err;
+    }
+    if (transport != BENCH_REPLAY) {
+        rc = trusty_sim_storage_queue_rpmb(1, 3, b->size, MMC_BLOCK_SIZE, 3);
+        if (rc)
+            goto err;
+    }
+    rc = poll_until_idle(16 * 7);
+    if (rc)
+        goto err;
+
+    rpmb_storage_proxy_destroy(proxy);
+    if (transport == BENCH_REPLAY)
+        return 0;
+#ifdef TIPC_ENABLE_RPMB_ASYNC
+    /* started requests complete before the proxy goes away */
+    open_frames = 3 * req_frames;
+#endif
+    if (stats->storage_resps != target || stats->storage_errors ||
+        host_rpmb_frames(devs[0]) - frames[0] != 2 * req_frames ||
+        host_rpmb_frames(devs[1]) - frames[1] != 2 * req_frames + open_frames)
+        return TRUSTY_ERR_GENERIC;
+    return 0;
+
+err:
+    rpmb_storage_proxy_destroy(proxy);
+    return rc;
+}
+
+static const struct bench benches[] = {
+        {"copy", "gather km req 4+88", 0, bench_gather, km_boot_params_iovs},
+        {"copy", "gather km req 4+1032", 0, bench_gather, km_cert_iovs},
+        {"copy", "scatter km resp 4+4+4+4068", 0, bench_scatter,
+         km_data_resp_iovs},
+        {"copy", "scatter avb resp 8+8", 0, bench_scatter, avb_rollback_iovs},
+        {"copy", "scatter avb resp 8+4", 0, bench_scatter, avb_version_iovs},
+        {"copy", "schema encode km cert 1KB", BENCH_CERT_SIZE,
+         bench_schema_encode},
+        {"copy", "schema decode km cert 1KB", BENCH_CERT_SIZE,
+         bench_schema_decode},
+        {"raw", "connect+close", 0, bench_connect_close},
+        {"raw", "get_event (idle)", 0, bench_get_event},
+        {"raw", "has_event (fast call)", 0, bench_has_event},
+        {"raw", "echo 16B", 16, bench_echo},
+        {"raw", "echo 256B", 256, bench_echo},
+        {"raw", "echo 1024B", 1024, bench_echo},
+        {"raw", "echo 4000B", 4000, bench_echo},
+        {"raw", "echo 4000B exact alloc", 4000, bench_echo_exact},
+        {"raw", "echo 4000B 512B chunks", 4000, bench_echo_stream},
+        {"raw", "echo 10000B framed", 0, bench_echo_framed},
+        {"sendq", "16x256B to sink, blocking", 0, bench_sink_blocking},
+        {"sendq", "16x256B to sink, queued", 0, bench_sink_queued},
+        {"km", "reconnect", 0, bench_km_init},
+        {"km", "reconnect (version handoff)", 0, bench_km_init_handoff},
+        {"km", "set_boot_params", 0, bench_km_boot_params},
+        {"km", "append_cert 1KB", 0, bench_km_append_cert},
+        {"km", "provision 2x(key+2 certs)", 0, bench_km_provision_serial},
+        {"km", "provision_attestation", 0, bench_km_provision},
+        {"km", "atap_get_ca_request", 6000, bench_km_get_ca_request},
+        {"km", "atap_get_ca_request into buf", 6000,
+         bench_km_get_ca_request_buf},
+        {"km", "atap_set_ca_response 8KB", 0, bench_km_set_ca_response},
+        {"km", "atap_read_uuid", 0, bench_km_read_uuid},
+        {"avb", "reconnect", 0, bench_avb_init},
+        {"avb", "reconnect (version handoff)", 0, bench_avb_init_handoff},
+        {"avb", "read_rollback_index", 0, bench_avb_read_rollback},
+        {"avb", "write+read_rollback_index", 0, bench_avb_write_rollback},
+        {"avb", "write+read 4 indexes", 4, bench_avb_rollback_multi},
+        {"avb", "write+read 4 indexes, 1 by 1", 8, bench_avb_rollback_per_slot},
+        {"avb", "read_permanent_attributes", 1052, bench_avb_read_perm_attr},
+        {"avb", "perm attributes size+read", 1052,
+         bench_avb_read_perm_attr_sized},
+        {"avb", "read_lock_state", 0, bench_avb_read_lock_state},
+        {"avb", "boot reads", 1052, bench_avb_boot_reads},
+        {"avb", "boot state snapshot", 1052, bench_avb_snapshot},
+#ifdef TIPC_ENABLE_AVB_CACHE
+        {"avb", "boot reads (cached)", 1052, bench_avb_boot_reads_cached},
+#endif
+        {"hwbcc", "get_dice_artifacts", 0, bench_hwbcc_get_dice},
+        {"hwbcc", "get_dice_artifacts (cached)", 0,
+         bench_hwbcc_get_dice_cached},
+        {"hwbcc", "parse BccHandover", 0, bench_hwbcc_parse},
+        {"rpmb", "proxy 1 frame", MMC_BLOCK_SIZE, bench_rpmb},
+        {"rpmb", "proxy 4 frames", 4 * MMC_BLOCK_SIZE, bench_rpmb},
+        {"rpmb", "proxy read max frames", MMC_BLOCK_SIZE, bench_rpmb_read_max},
+        {"rpmb", "proxy 4x1 frame", MMC_BLOCK_SIZE, bench_rpmb_4x},
+        {"rpmb", "proxy 4x1 frame, batched", MMC_BLOCK_SIZE, bench_rpmb_batch},
+        {"rpmb", "2 proxies 4x1 frame, destroy 1", MMC_BLOCK_SIZE,
+         bench_rpmb_two_proxies},
+};
+
+static int run_bench(const struct bench* b, unsigned iterations) {
+    unsigned i;
+    int rc = 0;
+    uint64_t start, elapsed;
+    uint64_t calls, bytes;
+    struct trusty_sim_stats* stats = trusty_sim_stats();
+
+    memset(stats, 0, sizeof(*stats));
+    copy_bytes = 0;
+    start = now_ns();
+    for (i = 0; i < iterations && !rc; i++)
+        rc = b->run(b, i);
+    elapsed = now_ns() - start;
+    if (rc) {
+        printf("%-6s %-28s FAILED (%d) at iteration %u\n", b->suite, b->name,
+               rc, i - 1);
+        return rc;
+    }
+    if (!elapsed)
+        elapsed = 1;
+
+    calls = stats->std_calls + stats->fast_calls;
+    bytes = stats->bytes_in + stats->bytes_out + copy_bytes;
+    printf("%-6s %-28s %10.0f %9.1f %8.2f %9.0f %8.1f\n", b->suite, b->name,
+           iterations * 1e9 / elapsed, (double)elapsed / iterations,
+           (double)calls / iterations, (double)bytes / iterations,
+           bytes * 1e3 / elapsed);
+    return 0;
+}
+
+static void record_write(struct trusty_ipc_recorder* rec,
+                         const void* data,
+                         size_t size) {
+    fwrite(data, 1, size, rec->priv);
+}
+
+static uint64_t record_now(struct trusty_ipc_recorder* rec) {
+    return now_ns();
+}
+
+static struct trusty_ipc_recorder recorder = {
+        .write = record_write,
+        .now = record_now,
+};
+
+/*
+ * Creates the Trusty IPC device over the current transport, optionally
+ * recording it to @rec, and connects all clients.
+ */
+static int setup(struct trusty_ipc_recorder* rec) {
+    struct trusty_ipc_handoff handoff = {0};
+    int rc;
+
+    trusty_sim_init(&sim_config);
+    /* loopback transports have no Trusty device to identify */
+    instance_id = 1;
+    switch (transport) {
+    case BENCH_SMC:
+        /* Also run the stock bring-up sequence once */
+        rc = trusty_ipc_init_handoff(&handoff);
+        if (rc)
+            return rc;
+        trusty_ipc_shutdown();
+
+        rc = trusty_dev_init(&tdev, NULL);
+        if (rc)
+            return rc;
+        rc = trusty_dev_get_instance_id(&tdev, &instance_id);
+        if (rc)
+            return rc;
+        rc = trusty_ipc_dev_create(&ipc_dev, &tdev, shared_buf_size);
+        break;
+    case BENCH_LOOPBACK:
+        rc = trusty_ipc_loopback_dev_create(&ipc_dev, &trusty_sim_loopback,
+                                            shared_buf_size);
+        break;
+    default:
+        rc = trusty_ipc_loopback_dev_create(&ipc_dev, &replay.lb,
+                                            shared_buf_size);
+    }
+    if (rc)
+        return rc;
+    if (rec)
+        trusty_ipc_dev_set_recorder(ipc_dev, rec);
+
+    rc = rpmb_storage_proxy_init(ipc_dev, rpmb_storage_get_ctx());
+    if (rc)
+        return rc;
+    memset(&avb_handoff, 0, sizeof(avb_handoff));
+    rc = avb_tipc_init_handoff(ipc_dev, instance_id, &avb_handoff);
+    if (rc)
+        return rc;
+    memset(&km_handoff, 0, sizeof(km_handoff));
+    rc = km_tipc_init_handoff(ipc_dev, instance_id, &km_handoff);
+    if (rc)
+        return rc;
+    rc = hwbcc_tipc_init(ipc_dev);
+    if (rc)
+        return rc;
+
+    trusty_ipc_chan_init(&echo_chan, ipc_dev);
+    rc = trusty_ipc_connect(&echo_chan, TRUSTY_SIM_ECHO_PORT, true);
+    if (rc < 0)
+        return rc;
+
+    memset(sink_seq, 0, sizeof(sink_seq));
+    trusty_ipc_chan_init(&sink_chan, ipc_dev);
+    rc = trusty_ipc_connect(&sink_chan, TRUSTY_SIM_SINK_PORT, true);
+    if (rc < 0)
+        return rc;
+    trusty_ipc_chan_init(&sinkq_chan, ipc_dev);
+    trusty_ipc_chan_set_sendq(&sinkq_chan, &sinkq, sinkq_buf,
+                              sizeof(sinkq_buf));
+    rc = trusty_ipc_connect(&sinkq_chan, TRUSTY_SIM_SINK_PORT, true);
+    return rc < 0 ? rc : 0;
+}
+
+static void teardown(void) {
+    trusty_ipc_close(&sinkq_chan);
+    trusty_ipc_close(&sink_chan);
+    trusty_ipc_close(&echo_chan);
+    hwbcc_tipc_shutdown();
+    km_tipc_shutdown();
+    avb_tipc_shutdown(ipc_dev);
+    rpmb_storage_proxy_shutdown(ipc_dev);
+    trusty_ipc_dev_shutdown(ipc_dev);
+    if (transport == BENCH_SMC)
+        trusty_dev_shutdown(&tdev);
+}
+
+static bool selected(const struct bench* b, const char* suite) {
+    return !suite || !strcmp(suite, b->suite);
+}
+
+/*
+ * A session is a full device lifetime that runs every selected benchmark
+ * once. It is the unit that is recorded and replayed.
+ */
+static int run_session(const char* suite, struct trusty_ipc_recorder* rec) {
+    size_t i;
+    int rc = setup(rec);
+
+    for (i = 0; i < sizeof(benches) / sizeof(benches[0]) && !rc; i++) {
+        if (selected(&benches[i], suite))
+            rc = benches[i].run(&benches[i], 0);
+    }
+    teardown();
+    return rc;
+}
+
+static int record_session(const char* path, const char* suite) {
+    int rc;
+    FILE* f = fopen(path, "wb");
+
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    recorder.priv = f;
+    rc = run_session(suite, &recorder);
+    fclose(f);
+    if (rc) {
+        fprintf(stderr, "recording session failed (%d)\n", rc);
+        return 1;
+    }
+    return 0;
+}
+
+static int replay_sessions(const char* path,
+                           const char* suite,
+                           unsigned iterations) {
+    unsigned i;
+    int rc = 0;
+    long size;
+    void* data;
+    uint64_t start, elapsed;
+    FILE* f = fopen(path, "rb");
+
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    rewind(f);
+    data = malloc(size > 0 ? size : 1);
+    if (!data || fread(data, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "failed to read %s\n", path);
+        fclose(f);
+        free(data);
+        return 1;
+    }
+    fclose(f);
+
+    rc = trusty_ipc_replay_init(&replay, data, size);
+    start = now_ns();
+    for (i = 0; i < iterations && !rc; i++) {
+        trusty_ipc_replay_rewind(&replay);
+        rc = run_session(suite, NULL);
+        if (!rc && (replay.mismatches || replay.pos != replay.size))
+            rc = TRUSTY_ERR_GENERIC;
+    }
+    elapsed = now_ns() - start;
+    if (rc) {
+        printf("replay FAILED (%d) in session %u: %zu of %zu commands differ, "
+               "%zu of %zu bytes replayed\n",
+               rc, i - 1, replay.mismatches, replay.cmds, replay.pos,
+               replay.size);
+        free(data);
+        return 1;
+    }
+    if (!elapsed)
+        elapsed = 1;
+
+    printf("replay: %s, sessions: %u, commands/session: %zu\n", path,
+           iterations, replay.cmds);
+    printf("%10.0f sessions/s %10.1f ns/session %8.1f ns/command\n",
+           iterations * 1e9 / elapsed, (double)elapsed / iterations,
+           (double)elapsed / iterations / replay.cmds);
+    free(data);
+    return 0;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [-n iterations] [-t smc|loopback] [-s suite] [-v] [-o]\n"
+            "          [-a version] [-b entries] [-m pages]\n"
+            "          [-r recording | -p recording]\n"
+            "  -o  emulate a secure OS without optional IPC commands\n"
+            "  -a  API version of the emulated secure OS\n"
+            "  -b  number of BccEntry items in the DICE artifacts\n"
+            "  -m  size of the shared buffer in pages\n"
+            "  -r  record one session (each benchmark once) to a file\n"
+            "  -p  replay a recorded session iterations times\n",
+            prog);
+}
+
+int main(int argc, char** argv) {
+    int opt;
+    size_t i;
+    int rc;
+    int failed = 0;
+    unsigned iterations = 10000;
+    const char* suite = NULL;
+    const char* record_path = NULL;
+    const char* replay_path = NULL;
+
+    trusty_host_quiet = true;
+    sim_config = trusty_sim_default_config;
+    while ((opt = getopt(argc, argv, "n:t:s:voa:b:m:r:p:")) != -1) {
+        switch (opt) {
+        case 'n':
+            iterations = strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            if (!strcmp(optarg, "smc")) {
+                transport = BENCH_SMC;
+            } else if (!strcmp(optarg, "loopback")) {
+                transport = BENCH_LOOPBACK;
+            } else {
+                usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 's':
+            suite = optarg;
+            break;
+        case 'v':
+            trusty_host_quiet = false;
+            break;
+        case 'o':
+            sim_config.legacy = true;
+            break;
+        case 'a':
+            sim_config.api_version = strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            sim_config.bcc_entries = strtoul(optarg, NULL, 0);
+            break;
+        case 'm':
+            shared_buf_size = strtoul(optarg, NULL, 0) * PAGE_SIZE;
+            break;
+        case 'r':
+            record_path = optarg;
+            break;
+        case 'p':
+            replay_path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!iterations || !shared_buf_size || (record_path && replay_path)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    memset(echo_tx, 0x5a, sizeof(echo_tx));
+
+    if (record_path)
+        return record_session(record_path, suite);
+    if (replay_path) {
+        transport = BENCH_REPLAY;
+        return replay_sessions(replay_path, suite, iterations);
+    }
+
+    rc = setup(NULL);
+    if (rc) {
+        fprintf(stderr, "setup over %s failed (%d)\n",
+                transport == BENCH_SMC ? "smc" : "loopback", rc);
+        return 1;
+    }
+
+    printf("transport: %s, iterations: %u\n",
+           transport == BENCH_SMC ? "smc" : "loopback", iterations);
+    printf("%-6s %-28s %10s %9s %8s %9s %8s\n", "suite", "benchmark", "ops/s",
+           "ns/op", "calls/op", "bytes/op", "MB/s");
+    for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        if (!selected(&benches[i], suite))
+            continue;
+        if (run_bench(&benches[i], iterations))
+            failed++;
+    }
+
+    teardown();
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,1170 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <interface/avb/avb.h>
+#include <interface/hwbcc/hwbcc.h>
+#include <interface/keymaster/keymaster.h>
+#include <interface/ql_tipc/ql_tipc.h>
+#include <interface/storage/storage.h>
+#include <trusty/avb.h>
+#include <trusty/keymaster_serializable.h>
+#include <trusty/smcall.h>
+#include <trusty/trusty_ipc.h>
+#include <uapi/uapi/err.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "trusty_sim.h"
+
+#define SIM_MAX_CHANS 16
+#define SIM_MAX_QUEUED_MSGS 64
+#define SIM_AVB_ROLLBACK_SLOTS 32
+#define SIM_KM_UUID_SIZE 32
+#define SIM_DICE_CDI_SIZE 32
+#define SIM_DICE_SIG_SIZE 64
+#define SIM_SINK_DEPTH 4
+#define SIM_KM_REPLY_DEPTH 2
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+struct sim_chan;
+
+/*
+ * Simulated secure service.
+ *
+ * @port:       name clients connect to
+ * @on_connect: optional, called when a client connects
+ * @on_msg:     handles a message sent by the client. Returns 0 or a negative
+ *              error which is reported back in the SEND response.
+ */
+struct sim_service {
+    const char* port;
+    void (*on_connect)(struct sim_chan* chan);
+    int (*on_msg)(struct sim_chan* chan, const uint8_t* msg, size_t len);
+};
+
+struct sim_msg {
+    uint8_t* data;
+    size_t len;
+};
+
+/*
+ * Secure side end of a channel.
+ *
+ * @pending:      edge triggered events (IPC_HANDLE_POLL_*) not yet reported
+ * @msgs:         ring of messages queued for the non-secure side
+ * @rx_cnt:       messages from the non-secure side not consumed yet, for
+ *                services that consume them late
+ * @rx_seq:       sequence number expected in the next message, ditto
+ * @send_blocked: a send failed because @rx_cnt or the queue of replies was
+ *                at its limit
+ */
+struct sim_chan {
+    bool in_use;
+    handle_t handle;
+    uint64_t cookie;
+    const struct sim_service* srv;
+    uint32_t pending;
+    struct sim_msg msgs[SIM_MAX_QUEUED_MSGS];
+    size_t msg_head;
+    size_t msg_cnt;
+    size_t rx_cnt;
+    uint32_t rx_seq;
+    bool send_blocked;
+};
+
+static struct {
+    struct trusty_sim_config config;
+    struct trusty_sim_stats stats;
+
+    void* buf;
+    size_t buf_size;
+    size_t max_msg_size;
+
+    struct sim_chan chans[SIM_MAX_CHANS];
+    size_t next_event_chan;
+
+    struct {
+        uint8_t* ca_request;
+        uint32_t ca_response_size;
+        uint32_t ca_response_received;
+        uint32_t certs[KM_ALGORITHM_EC + 1];
+        bool keys[KM_ALGORITHM_EC + 1];
+    } km;
+
+    struct {
+        uint64_t rollback[SIM_AVB_ROLLBACK_SLOTS];
+        uint8_t lock_state;
+        bool boot_locked;
+        uint8_t* perm_attr;
+    } avb;
+
+    struct {
+        uint8_t* artifacts;
+        size_t size;
+        bool deprivileged;
+    } hwbcc;
+
+    struct {
+        struct sim_chan* proxy[TRUSTY_SIM_STORAGE_PROXIES];
+        uint32_t next_op_id;
+    } storage;
+} sim;
+
+const struct trusty_sim_config trusty_sim_default_config = {
+        .ca_request_size = 6000,
+        .perm_attr_size = 1052,
+        .bcc_entries = 1,
+        .bcc_payload_size = 320,
+};
+
+/*
+ * Queues the concatenation of @a and @b as one message for the non-secure
+ * side of @chan.
+ */
+static int sim_chan_queue(struct sim_chan* chan,
+                          const void* a,
+                          size_t a_len,
+                          const void* b,
+                          size_t b_len) {
+    struct sim_msg* msg;
+    size_t len = a_len + b_len;
+
+    if (chan->msg_cnt == SIM_MAX_QUEUED_MSGS || len > sim.max_msg_size)
+        return ERR_NOT_ENOUGH_BUFFER;
+
+    msg = &chan->msgs[(chan->msg_head + chan->msg_cnt) % SIM_MAX_QUEUED_MSGS];
+    msg->data = malloc(len ? len : 1);
+    if (!msg->data)
+        return ERR_NO_MEMORY;
+    memcpy(msg->data, a, a_len);
+    if (b_len)
+        memcpy(msg->data + a_len, b, b_len);
+    msg->len = len;
+    chan->msg_cnt++;
+    return NO_ERROR;
+}
+
+/*
+ * Drops the oldest message queued for the non-secure side of @chan, which
+ * unblocks a send that was refused because of the queued replies.
+ */
+static void sim_chan_pop(struct sim_chan* chan) {
+    free(chan->msgs[chan->msg_head].data);
+    chan->msg_head = (chan->msg_head + 1) % SIM_MAX_QUEUED_MSGS;
+    chan->msg_cnt--;
+    sim.stats.msgs_out++;
+    if (chan->send_blocked && !chan->rx_cnt) {
+        chan->send_blocked = false;
+        chan->pending |= IPC_HANDLE_POLL_SEND_UNBLOCKED;
+    }
+}
+
+static void sim_chan_free(struct sim_chan* chan) {
+    size_t i;
+
+    while (chan->msg_cnt) {
+        free(chan->msgs[chan->msg_head].data);
+        chan->msg_head = (chan->msg_head + 1) % SIM_MAX_QUEUED_MSGS;
+        chan->msg_cnt--;
+    }
+    for (i = 0; i < TRUSTY_SIM_STORAGE_PROXIES; i++) {
+        if (sim.storage.proxy[i] == chan)
+            sim.storage.proxy[i] = NULL;
+    }
+    memset(chan, 0, sizeof(*chan));
+}
+
+static uint32_t sim_chan_events(struct sim_chan* chan) {
+    return chan->pending | (chan->msg_cnt ? IPC_HANDLE_POLL_MSG : 0);
+}
+
+/* Keymaster */
+
+static int km_reply(struct sim_chan* chan,
+                    uint32_t cmd,
+                    const void* body,
+                    size_t body_len) {
+    struct keymaster_message hdr = {
+            .cmd = cmd | KEYMASTER_RESP_BIT | KEYMASTER_STOP_BIT,
+    };
+    return sim_chan_queue(chan, &hdr, sizeof(hdr), body, body_len);
+}
+
+static int km_reply_error(struct sim_chan* chan, uint32_t cmd, int32_t error) {
+    struct km_no_response resp = {.error = error};
+    return km_reply(chan, cmd, &resp, sizeof(resp));
+}
+
+/*
+ * Sends @data as a keymaster data response, split in as many frames as the
+ * shared buffer requires. Only the last frame carries KEYMASTER_STOP_BIT.
+ */
+static int km_reply_data(struct sim_chan* chan,
+                         uint32_t cmd,
+                         const uint8_t* data,
+                         uint32_t size) {
+    int rc;
+    uint8_t first[3 * sizeof(uint32_t)];
+    struct keymaster_message hdr = {.cmd = cmd | KEYMASTER_RESP_BIT};
+    struct km_raw_buffer_resp resp = {.error = KM_ERROR_OK, .data_size = size};
+    size_t frame_max = MIN(sim.max_msg_size, KEYMASTER_MAX_BUFFER_LENGTH);
+    size_t chunk = MIN(size, frame_max - sizeof(first));
+    size_t sent;
+
+    if (chunk == size)
+        hdr.cmd |= KEYMASTER_STOP_BIT;
+    memcpy(first, &hdr, sizeof(hdr));
+    memcpy(first + sizeof(hdr), &resp, sizeof(resp));
+    rc = sim_chan_queue(chan, first, sizeof(first), data, chunk);
+    for (sent = chunk; !rc && sent < size; sent += chunk) {
+        chunk = MIN(size - sent, frame_max - sizeof(hdr));
+        if (sent + chunk == size)
+            hdr.cmd |= KEYMASTER_STOP_BIT;
+        rc = sim_chan_queue(chan, &hdr, sizeof(hdr), data + sent, chunk);
+    }
+    return rc;
+}
+
+static int32_t km_handle_cmd(uint32_t cmd, const uint8_t* req, size_t len) {
+    struct km_boot_params params;
+    struct km_attestation_data data;
+    struct km_raw_buffer buf;
+    uint32_t algorithm;
+
+    switch (cmd) {
+    case KM_SET_BOOT_PARAMS:
+        if (trusty_ipc_schema_decode(&km_boot_params_schema, &params, req,
+                                     len))
+            return KM_ERROR_INVALID_INPUT_LENGTH;
+        return KM_ERROR_OK;
+
+    case KM_SET_ATTESTATION_KEY:
+    case KM_APPEND_ATTESTATION_CERT_CHAIN:
+        if (trusty_ipc_schema_decode(&km_attestation_data_schema, &data, req,
+                                     len) ||
+            !data.data_size)
+            return KM_ERROR_INVALID_INPUT_LENGTH;
+        algorithm = data.algorithm;
+        if (algorithm != KM_ALGORITHM_RSA && algorithm != KM_ALGORITHM_EC)
+            return KM_ERROR_UNSUPPORTED_ALGORITHM;
+        if (cmd == KM_SET_ATTESTATION_KEY) {
+            sim.km.keys[algorithm] = true;
+            sim.km.certs[algorithm] = 0;
+        } else {
+            sim.km.certs[algorithm]++;
+        }
+        return KM_ERROR_OK;
+
+    case KM_ATAP_SET_CA_RESPONSE_BEGIN:
+        if (len != sizeof(struct km_set_ca_response_begin_req))
+            return KM_ERROR_INVALID_INPUT_LENGTH;
+        memcpy(&sim.km.ca_response_size, req, sizeof(uint32_t));
+        sim.km.ca_response_received = 0;
+        return KM_ERROR_OK;
+
+    case KM_ATAP_SET_CA_RESPONSE_UPDATE:
+        if (trusty_ipc_schema_decode(&km_raw_buffer_schema, &buf, req, len))
+            return KM_ERROR_INVALID_INPUT_LENGTH;
+        if (sim.km.ca_response_received + buf.data_size >
+            sim.km.ca_response_size)
+            return KM_ERROR_INVALID_INPUT_LENGTH;
+        sim.km.ca_response_received += buf.data_size;
+        return KM_ERROR_OK;
+
+    case KM_ATAP_SET_CA_RESPONSE_FINISH:
+        if (sim.km.ca_response_received != sim.km.ca_response_size)
+            return KM_ERROR_INVALID_INPUT_LENGTH;
+        return KM_ERROR_OK;
+
+    case KM_SET_PRODUCT_ID:
+        return KM_ERROR_OK;
+
+    default:
+        return KM_ERROR_UNIMPLEMENTED;
+    }
+}
+
+static int km_on_msg(struct sim_chan* chan, const uint8_t* msg, size_t len) {
+    struct keymaster_message hdr;
+    static const uint8_t uuid[SIM_KM_UUID_SIZE] =
+            "0123456789abcdef0123456789abcdef";
+    struct km_get_version_resp version = {
+            .error = KM_ERROR_OK,
+            .major_ver = 2,
+    };
+    struct km_raw_buffer buf;
+
+    /* like Trusty, refuse requests while the client has not read its replies */
+    if (chan->msg_cnt >= SIM_KM_REPLY_DEPTH) {
+        chan->send_blocked = true;
+        return ERR_NOT_ENOUGH_BUFFER;
+    }
+    if (len < sizeof(hdr))
+        return ERR_INVALID_ARGS;
+    memcpy(&hdr, msg, sizeof(hdr));
+    msg += sizeof(hdr);
+    len -= sizeof(hdr);
+
+    switch (hdr.cmd) {
+    case KM_GET_VERSION:
+        return km_reply(chan, hdr.cmd, &version, sizeof(version));
+
+    case KM_ATAP_GET_CA_REQUEST:
+        if (trusty_ipc_schema_decode(&km_raw_buffer_schema, &buf, msg, len))
+            return km_reply_error(chan, hdr.cmd, KM_ERROR_INVALID_INPUT_LENGTH);
+        return km_reply_data(chan, hdr.cmd, sim.km.ca_request,
+                             sim.config.ca_request_size);
+
+    case KM_ATAP_READ_UUID:
+        return km_reply_data(chan, hdr.cmd, uuid, sizeof(uuid));
+
+    default:
+        return km_reply_error(chan, hdr.cmd, km_handle_cmd(hdr.cmd, msg, len));
+    }
+}
+
+/* AVB */
+
+static int avb_reply(struct sim_chan* chan,
+                     uint32_t cmd,
+                     uint32_t result,
+                     const void* body,
+                     size_t body_len) {
+    struct avb_message hdr = {.cmd = cmd | AVB_RESP_BIT, .result = result};
+    if (result != AVB_ERROR_NONE)
+        body_len = 0;
+    return sim_chan_queue(chan, &hdr, sizeof(hdr), body, body_len);
+}
+
+/*
+ * Handles READ_ROLLBACK_INDEX_MULTI and WRITE_ROLLBACK_INDEX_MULTI. All
+ * entries of a write are checked before any is applied, like a single
+ * storage transaction would.
+ */
+static int avb_rollback_multi(struct sim_chan* chan,
+                              uint32_t cmd,
+                              const uint8_t* msg,
+                              size_t len) {
+    struct avb_rollback_multi req;
+    struct avb_rollback_req entries[AVB_ROLLBACK_MULTI_MAX];
+    size_t i;
+
+    if (sim.config.legacy ||
+        trusty_ipc_schema_decode(&avb_rollback_multi_schema, &req, msg, len))
+        return avb_reply(chan, cmd, AVB_ERROR_INVALID, NULL, 0);
+    if (req.reserved || req.count > AVB_ROLLBACK_MULTI_MAX ||
+        req.entries_size != req.count * sizeof(entries[0])) {
+        return avb_reply(chan, cmd, AVB_ERROR_INVALID, NULL, 0);
+    }
+    memcpy(entries, req.entries, req.entries_size);
+
+    for (i = 0; i < req.count; i++) {
+        if (entries[i].slot >= SIM_AVB_ROLLBACK_SLOTS)
+            return avb_reply(chan, cmd, AVB_ERROR_INVALID, NULL, 0);
+        if (cmd == WRITE_ROLLBACK_INDEX_MULTI &&
+            (sim.avb.boot_locked ||
+             entries[i].value < sim.avb.rollback[entries[i].slot])) {
+            return avb_reply(chan, cmd, AVB_ERROR_INVALID, NULL, 0);
+        }
+    }
+    if (cmd == WRITE_ROLLBACK_INDEX_MULTI && req.count) {
+        for (i = 0; i < req.count; i++)
+            sim.avb.rollback[entries[i].slot] = entries[i].value;
+        sim.stats.avb_commits++;
+    }
+
+    for (i = 0; i < req.count; i++)
+        entries[i].value = sim.avb.rollback[entries[i].slot];
+    return avb_reply(chan, cmd, AVB_ERROR_NONE, entries,
+                     req.count * sizeof(entries[0]));
+}
+
+/*
+ * Answers AVB_GET_SNAPSHOT. The digest only has the right size, like the
+ * DICE signatures below it is not computed.
+ */
+static int avb_snapshot(struct sim_chan* chan, uint32_t cmd) {
+    struct {
+        struct avb_snapshot_resp hdr;
+        uint64_t rollback[SIM_AVB_ROLLBACK_SLOTS];
+    } resp = {
+            .hdr.lock_state = sim.avb.lock_state,
+            .hdr.boot_locked = sim.avb.boot_locked,
+            .hdr.perm_attr_size = sim.config.perm_attr_size,
+            .hdr.rollback_count = SIM_AVB_ROLLBACK_SLOTS,
+    };
+    size_t i;
+
+    if (sim.config.legacy)
+        return avb_reply(chan, cmd, AVB_ERROR_INVALID, NULL, 0);
+    for (i = 0; i < sim.config.perm_attr_size; i++) {
+        resp.hdr.perm_attr_digest[i % AVB_PERM_ATTR_DIGEST_SIZE] ^=
+                sim.avb.perm_attr[i];
+    }
+    memcpy(resp.rollback, sim.avb.rollback, sizeof(resp.rollback));
+    return avb_reply(chan, cmd, AVB_ERROR_NONE, &resp, sizeof(resp));
+}
+
+static int avb_on_msg(struct sim_chan* chan, const uint8_t* msg, size_t len) {
+    struct avb_message hdr;
+    struct avb_rollback_req rb_req;
+    struct avb_rollback_resp rb_resp = {0};
+    struct avb_get_version_resp version = {.version = 1};
+    uint32_t result = AVB_ERROR_NONE;
+    size_t i;
+
+    if (len < sizeof(hdr))
+        return ERR_INVALID_ARGS;
+    memcpy(&hdr, msg, sizeof(hdr));
+    msg += sizeof(hdr);
+    len -= sizeof(hdr);
+
+    switch (hdr.cmd) {
+    case AVB_GET_VERSION:
+        return avb_reply(chan, hdr.cmd, result, &version, sizeof(version));
+
+    case READ_ROLLBACK_INDEX:
+    case WRITE_ROLLBACK_INDEX:
+        if (len != sizeof(rb_req))
+            return avb_reply(chan, hdr.cmd, AVB_ERROR_INVALID, NULL, 0);
+        memcpy(&rb_req, msg, sizeof(rb_req));
+        if (rb_req.slot >= SIM_AVB_ROLLBACK_SLOTS) {
+            result = AVB_ERROR_INVALID;
+        } else if (hdr.cmd == WRITE_ROLLBACK_INDEX) {
+            if (sim.avb.boot_locked ||
+                rb_req.value < sim.avb.rollback[rb_req.slot]) {
+                result = AVB_ERROR_INVALID;
+            } else {
+                sim.avb.rollback[rb_req.slot] = rb_req.value;
+                sim.stats.avb_commits++;
+            }
+        }
+        if (result == AVB_ERROR_NONE)
+            rb_resp.value = sim.avb.rollback[rb_req.slot];
+        return avb_reply(chan, hdr.cmd, result, &rb_resp, sizeof(rb_resp));
+
+    case READ_ROLLBACK_INDEX_MULTI:
+    case WRITE_ROLLBACK_INDEX_MULTI:
+        return avb_rollback_multi(chan, hdr.cmd, msg, len);
+
+    case AVB_GET_SNAPSHOT:
+        return avb_snapshot(chan, hdr.cmd);
+
+    case READ_PERMANENT_ATTRIBUTES:
+        return avb_reply(chan, hdr.cmd, result, sim.avb.perm_attr,
+                         sim.config.perm_attr_size);
+
+    case WRITE_PERMANENT_ATTRIBUTES:
+        /* Permanent attributes are preloaded and can not be written again */
+        return avb_reply(chan, hdr.cmd, AVB_ERROR_INVALID, NULL, 0);
+
+    case READ_LOCK_STATE:
+        return avb_reply(chan, hdr.cmd, result, &sim.avb.lock_state,
+                         sizeof(sim.avb.lock_state));
+
+    case WRITE_LOCK_STATE:
+        if (len != sizeof(sim.avb.lock_state) || sim.avb.boot_locked)
+            return avb_reply(chan, hdr.cmd, AVB_ERROR_INVALID, NULL, 0);
+        if (sim.avb.lock_state != msg[0]) {
+            for (i = 0; i < SIM_AVB_ROLLBACK_SLOTS; i++)
+                sim.avb.rollback[i] = 0;
+            sim.avb.lock_state = msg[0];
+        }
+        return avb_reply(chan, hdr.cmd, result, NULL, 0);
+
+    case LOCK_BOOT_STATE:
+        sim.avb.boot_locked = true;
+        return avb_reply(chan, hdr.cmd, result, NULL, 0);
+
+    default:
+        return avb_reply(chan, hdr.cmd, AVB_ERROR_INVALID, NULL, 0);
+    }
+}
+
+/* HWBCC */
+
+static uint8_t* cbor_put_head(uint8_t* p, uint8_t major, uint64_t val) {
+    major <<= 5;
+    if (val < 24) {
+        *p++ = major | (uint8_t)val;
+    } else if (val <= 0xff) {
+        *p++ = major | 24;
+        *p++ = (uint8_t)val;
+    } else if (val <= 0xffff) {
+        *p++ = major | 25;
+        *p++ = (uint8_t)(val >> 8);
+        *p++ = (uint8_t)val;
+    } else {
+        *p++ = major | 26;
+        *p++ = (uint8_t)(val >> 24);
+        *p++ = (uint8_t)(val >> 16);
+        *p++ = (uint8_t)(val >> 8);
+        *p++ = (uint8_t)val;
+    }
+    return p;
+}
+
+static uint8_t* cbor_put_bstr(uint8_t* p, uint8_t fill, size_t len) {
+    p = cbor_put_head(p, 2, len);
+    memset(p, fill, len);
+    return p + len;
+}
+
+/*
+ * Builds a BccHandover map with CDI_Attest, CDI_Seal and a Bcc made of an
+ * Ed25519 COSE_Key followed by sim.config.bcc_entries COSE_Sign1 entries.
+ */
+static void hwbcc_build_artifacts(void) {
+    static const uint8_t protected_hdr[] = {0xa1, 0x01, 0x27};
+    size_t max_size = 128 + sim.config.bcc_entries *
+                                    (sim.config.bcc_payload_size +
+                                     SIM_DICE_SIG_SIZE + 32);
+    uint8_t* p;
+    size_t i;
+
+    free(sim.hwbcc.artifacts);
+    sim.hwbcc.artifacts = malloc(max_size);
+    if (!sim.hwbcc.artifacts)
+        abort();
+    p = sim.hwbcc.artifacts;
+
+    p = cbor_put_head(p, 5, 3);
+    p = cbor_put_head(p, 0, 1);
+    p = cbor_put_bstr(p, 0xa5, SIM_DICE_CDI_SIZE);
+    p = cbor_put_head(p, 0, 2);
+    p = cbor_put_bstr(p, 0x5a, SIM_DICE_CDI_SIZE);
+    p = cbor_put_head(p, 0, 3);
+    p = cbor_put_head(p, 4, 1 + sim.config.bcc_entries);
+
+    /* {1: 1 (OKP), 3: -8 (EdDSA), -1: 6 (Ed25519), -2: x} */
+    p = cbor_put_head(p, 5, 4);
+    p = cbor_put_head(p, 0, 1);
+    p = cbor_put_head(p, 0, 1);
+    p = cbor_put_head(p, 0, 3);
+    p = cbor_put_head(p, 1, 7);
+    p = cbor_put_head(p, 1, 0);
+    p = cbor_put_head(p, 0, 6);
+    p = cbor_put_head(p, 1, 1);
+    p = cbor_put_bstr(p, 0x11, 32);
+
+    for (i = 0; i < sim.config.bcc_entries; i++) {
+        p = cbor_put_head(p, 4, 4);
+        p = cbor_put_head(p, 2, sizeof(protected_hdr));
+        memcpy(p, protected_hdr, sizeof(protected_hdr));
+        p += sizeof(protected_hdr);
+        p = cbor_put_head(p, 5, 0);
+        p = cbor_put_bstr(p, 0x20 + (uint8_t)i, sim.config.bcc_payload_size);
+        p = cbor_put_bstr(p, 0x5e, SIM_DICE_SIG_SIZE);
+    }
+
+    sim.hwbcc.size = p - sim.hwbcc.artifacts;
+}
+
+static int hwbcc_reply(struct sim_chan* chan,
+                       uint32_t cmd,
+                       int32_t status,
+                       const void* payload,
+                       size_t payload_size) {
+    struct hwbcc_resp_hdr hdr = {
+            .cmd = cmd | HWBCC_CMD_RESP_BIT,
+            .status = status,
+            .payload_size = status == NO_ERROR ? payload_size : 0,
+    };
+    return sim_chan_queue(chan, &hdr, sizeof(hdr), payload, hdr.payload_size);
+}
+
+/* Sends @payload in parts of HWBCC_MAX_RESP_PAYLOAD_SIZE bytes */
+static int hwbcc_reply_multi(struct sim_chan* chan,
+                             uint32_t cmd,
+                             const uint8_t* payload,
+                             size_t payload_size) {
+    struct hwbcc_resp_hdr hdr = {.cmd = cmd | HWBCC_CMD_RESP_BIT};
+    size_t off = 0;
+    int rc;
+
+    do {
+        hdr.payload_size = MIN(payload_size - off,
+                               (size_t)HWBCC_MAX_RESP_PAYLOAD_SIZE);
+        if (off + hdr.payload_size == payload_size)
+            hdr.cmd |= HWBCC_CMD_STOP_BIT;
+        rc = sim_chan_queue(chan, &hdr, sizeof(hdr), payload + off,
+                            hdr.payload_size);
+        if (rc)
+            return rc;
+        off += hdr.payload_size;
+    } while (off < payload_size);
+    return NO_ERROR;
+}
+
+static int hwbcc_on_msg(struct sim_chan* chan,
+                        const uint8_t* msg,
+                        size_t len) {
+    struct hwbcc_req_hdr hdr;
+
+    if (len < sizeof(hdr))
+        return ERR_INVALID_ARGS;
+    memcpy(&hdr, msg, sizeof(hdr));
+
+    switch (hdr.cmd) {
+    case HWBCC_CMD_GET_DICE_ARTIFACTS:
+        if (sim.hwbcc.deprivileged)
+            return hwbcc_reply(chan, hdr.cmd, ERR_ACCESS_DENIED, NULL, 0);
+        if (sim.hwbcc.size > HWBCC_MAX_RESP_PAYLOAD_SIZE)
+            return hwbcc_reply(chan, hdr.cmd, ERR_NOT_ENOUGH_BUFFER, NULL, 0);
+        return hwbcc_reply(chan, hdr.cmd, NO_ERROR, sim.hwbcc.artifacts,
+                           sim.hwbcc.size);
+
+    case HWBCC_CMD_GET_DICE_ARTIFACTS_MULTI:
+        if (sim.config.legacy)
+            break;
+        if (sim.hwbcc.deprivileged)
+            return hwbcc_reply(chan, hdr.cmd, ERR_ACCESS_DENIED, NULL, 0);
+        return hwbcc_reply_multi(chan, hdr.cmd, sim.hwbcc.artifacts,
+                                 sim.hwbcc.size);
+
+    case HWBCC_CMD_NS_DEPRIVILEGE:
+        sim.hwbcc.deprivileged = true;
+        return hwbcc_reply(chan, hdr.cmd, NO_ERROR, NULL, 0);
+    }
+    return hwbcc_reply(chan, hdr.cmd, ERR_NOT_SUPPORTED, NULL, 0);
+}
+
+/* Secure storage, talking to the non-secure storage proxy */
+
+static const char* const storage_ports[TRUSTY_SIM_STORAGE_PROXIES] = {
+        STORAGE_DISK_PROXY_PORT,
+        TRUSTY_SIM_STORAGE2_PORT,
+};
+
+static void storage_on_connect(struct sim_chan* chan) {
+    size_t i;
+
+    for (i = 0; i < TRUSTY_SIM_STORAGE_PROXIES; i++) {
+        if (!strcmp(chan->srv->port, storage_ports[i]))
+            sim.storage.proxy[i] = chan;
+    }
+}
+
+/* Fill of the frames written by trusty_sim_storage_queue_rpmb */
+#define SIM_RPMB_FILL 0x3c
+
+static int storage_on_msg(struct sim_chan* chan,
+                          const uint8_t* msg,
+                          size_t len) {
+    size_t i;
+    struct storage_msg hdr;
+
+    if (len < sizeof(hdr))
+        return ERR_INVALID_ARGS;
+    memcpy(&hdr, msg, sizeof(hdr));
+
+    sim.stats.storage_resps++;
+    if (hdr.cmd != (STORAGE_RPMB_SEND | STORAGE_RESP_BIT) ||
+        hdr.result != STORAGE_NO_ERROR) {
+        sim.stats.storage_errors++;
+    }
+    /* the frames read are copies of the frames written */
+    for (i = sizeof(hdr); i < len; i++) {
+        if (msg[i] != SIM_RPMB_FILL) {
+            sim.stats.storage_errors++;
+            break;
+        }
+    }
+    return NO_ERROR;
+}
+
+int trusty_sim_storage_queue_rpmb(unsigned proxy,
+                                  unsigned count,
+                                  uint32_t write_size,
+                                  uint32_t read_size,
+                                  unsigned batched) {
+    int rc;
+    unsigned i;
+    uint8_t* frames;
+    struct {
+        struct storage_msg msg;
+        struct storage_rpmb_send_req req;
+    } hdr = {0};
+
+    if (proxy >= TRUSTY_SIM_STORAGE_PROXIES || !sim.storage.proxy[proxy])
+        return ERR_NOT_READY;
+
+    frames = malloc(write_size ? write_size : 1);
+    if (!frames)
+        return ERR_NO_MEMORY;
+    memset(frames, SIM_RPMB_FILL, write_size);
+
+    hdr.msg.cmd = STORAGE_RPMB_SEND;
+    hdr.msg.size = sizeof(hdr) + write_size;
+    hdr.req.reliable_write_size = write_size;
+    hdr.req.read_size = read_size;
+
+    for (i = 0, rc = NO_ERROR; i < count && rc == NO_ERROR; i++) {
+        hdr.msg.op_id = sim.storage.next_op_id++;
+        hdr.msg.flags = i < batched ? STORAGE_MSG_FLAG_BATCH : 0;
+        rc = sim_chan_queue(sim.storage.proxy[proxy], &hdr, sizeof(hdr),
+                            frames, write_size);
+    }
+    free(frames);
+    return rc;
+}
+
+/* Echo */
+
+static int echo_on_msg(struct sim_chan* chan, const uint8_t* msg, size_t len) {
+    return sim_chan_queue(chan, msg, len, NULL, 0);
+}
+
+/* Sink */
+
+/*
+ * Takes up to SIM_SINK_DEPTH messages, each starting with a sequence number,
+ * and consumes one of them per QL_TIPC_DEV_GET_EVENT, like a slow service.
+ */
+static int sink_on_msg(struct sim_chan* chan, const uint8_t* msg, size_t len) {
+    uint32_t seq;
+
+    if (chan->rx_cnt == SIM_SINK_DEPTH) {
+        chan->send_blocked = true;
+        return ERR_NOT_ENOUGH_BUFFER;
+    }
+    chan->rx_cnt++;
+    sim.stats.sink_msgs++;
+    if (len < sizeof(seq)) {
+        sim.stats.sink_errors++;
+        return NO_ERROR;
+    }
+    memcpy(&seq, msg, sizeof(seq));
+    if (seq != chan->rx_seq)
+        sim.stats.sink_errors++;
+    chan->rx_seq = seq + 1;
+    return NO_ERROR;
+}
+
+static void sink_consume(void) {
+    size_t i;
+    struct sim_chan* chan;
+
+    for (i = 0; i < SIM_MAX_CHANS; i++) {
+        chan = &sim.chans[i];
+        if (!chan->in_use || !chan->rx_cnt)
+            continue;
+        chan->rx_cnt--;
+        if (chan->send_blocked) {
+            chan->send_blocked = false;
+            chan->pending |= IPC_HANDLE_POLL_SEND_UNBLOCKED;
+        }
+    }
+}
+
+static const struct sim_service services[] = {
+        {.port = KEYMASTER_PORT, .on_msg = km_on_msg},
+        {.port = AVB_PORT, .on_msg = avb_on_msg},
+        {.port = HWBCC_PORT, .on_msg = hwbcc_on_msg},
+        {.port = STORAGE_DISK_PROXY_PORT,
+         .on_connect = storage_on_connect,
+         .on_msg = storage_on_msg},
+        {.port = TRUSTY_SIM_STORAGE2_PORT,
+         .on_connect = storage_on_connect,
+         .on_msg = storage_on_msg},
+        {.port = TRUSTY_SIM_ECHO_PORT, .on_msg = echo_on_msg},
+        {.port = TRUSTY_SIM_SINK_PORT, .on_msg = sink_on_msg},
+};
+
+/* Queueless IPC device */
+
+static struct sim_chan* sim_lookup_chan(handle_t handle) {
+    if (handle == INVALID_IPC_HANDLE || handle > SIM_MAX_CHANS)
+        return NULL;
+    if (!sim.chans[handle - 1].in_use)
+        return NULL;
+    return &sim.chans[handle - 1];
+}
+
+/*
+ * Opens a channel to the service behind port @name. Returns the channel or
+ * NULL, in which case @rc is set.
+ */
+static struct sim_chan* sim_open_chan(const char* name,
+                                      uint64_t cookie,
+                                      int* rc) {
+    size_t i;
+    struct sim_chan* chan = NULL;
+    const struct sim_service* srv = NULL;
+
+    for (i = 0; i < sizeof(services) / sizeof(services[0]); i++) {
+        if (!strcmp(services[i].port, name))
+            srv = &services[i];
+    }
+    if (!srv) {
+        *rc = ERR_NOT_FOUND;
+        return NULL;
+    }
+
+    for (i = 0; i < SIM_MAX_CHANS && !chan; i++) {
+        if (!sim.chans[i].in_use)
+            chan = &sim.chans[i];
+    }
+    if (!chan) {
+        *rc = ERR_NO_MEMORY;
+        return NULL;
+    }
+
+    chan->in_use = true;
+    chan->handle = (handle_t)(chan - sim.chans) + 1;
+    chan->cookie = cookie;
+    chan->srv = srv;
+    chan->pending = IPC_HANDLE_POLL_READY;
+    if (srv->on_connect)
+        srv->on_connect(chan);
+    return chan;
+}
+
+static int sim_connect(struct trusty_ipc_cmd_hdr* cmd) {
+    int rc;
+    struct sim_chan* chan;
+    struct trusty_ipc_connect_req req;
+    const char* name = (const char*)cmd->payload + sizeof(req);
+    size_t name_max = cmd->payload_len - sizeof(req);
+
+    if (cmd->payload_len <= sizeof(req) || !memchr(name, 0, name_max))
+        return ERR_INVALID_ARGS;
+    memcpy(&req, cmd->payload, sizeof(req));
+
+    chan = sim_open_chan(name, req.cookie, &rc);
+    if (!chan)
+        return rc;
+
+    cmd->handle = chan->handle;
+    cmd->payload_len = 0;
+    return NO_ERROR;
+}
+
+/*
+ * Connects and delivers the first message right away, as the services
+ * accept connections synchronously. The READY event is reported in the
+ * response instead of by a later GET_EVENT.
+ */
+static int sim_connect_with_msg(struct trusty_ipc_cmd_hdr* cmd) {
+    int rc;
+    uint64_t len;
+    struct sim_chan* chan;
+    struct trusty_ipc_connect_msg_req req;
+    struct trusty_ipc_connect_msg_resp resp = {0};
+    const uint8_t* data = cmd->payload + sizeof(req);
+
+    if (cmd->payload_len < sizeof(req))
+        return ERR_INVALID_ARGS;
+    memcpy(&req, cmd->payload, sizeof(req));
+    len = (uint64_t)req.name_len + req.msg_len;
+    if (!req.name_len || len != cmd->payload_len - sizeof(req) ||
+        data[req.name_len - 1]) {
+        return ERR_INVALID_ARGS;
+    }
+
+    chan = sim_open_chan((const char*)data, req.cookie, &rc);
+    if (!chan)
+        return rc;
+
+    sim.stats.msgs_in++;
+    rc = chan->srv->on_msg(chan, data + req.name_len, req.msg_len);
+    if (rc != NO_ERROR) {
+        sim_chan_free(chan);
+        return rc;
+    }
+
+    resp.event = sim_chan_events(chan);
+    chan->pending = 0;
+    cmd->handle = chan->handle;
+    memcpy(cmd->payload, &resp, sizeof(resp));
+    cmd->payload_len = sizeof(resp);
+    return NO_ERROR;
+}
+
+static struct sim_chan* sim_next_event_chan(void) {
+    size_t i;
+    struct sim_chan* chan;
+
+    for (i = 0; i < SIM_MAX_CHANS; i++) {
+        chan = &sim.chans[(sim.next_event_chan + i) % SIM_MAX_CHANS];
+        if (chan->in_use && sim_chan_events(chan)) {
+            sim.next_event_chan = (chan - sim.chans) + 1;
+            return chan;
+        }
+    }
+    return NULL;
+}
+
+static int sim_get_event(struct trusty_ipc_cmd_hdr* cmd) {
+    struct trusty_ipc_event evt = {0};
+    struct sim_chan* chan;
+
+    sink_consume();
+    chan = sim_next_event_chan();
+
+    if (chan) {
+        evt.event = sim_chan_events(chan);
+        evt.handle = chan->handle;
+        evt.cookie = chan->cookie;
+        chan->pending = 0;
+    }
+    memcpy(cmd->payload, &evt, sizeof(evt));
+    cmd->payload_len = sizeof(evt);
+    return NO_ERROR;
+}
+
+static int sim_has_event(struct trusty_ipc_cmd_hdr* cmd) {
+    bool has_event = sim_next_event_chan() != NULL;
+
+    memcpy(cmd->payload, &has_event, sizeof(has_event));
+    cmd->payload_len = sizeof(has_event);
+    return NO_ERROR;
+}
+
+static int sim_send(struct trusty_ipc_cmd_hdr* cmd) {
+    int rc;
+    struct sim_chan* chan = sim_lookup_chan(cmd->handle);
+
+    if (!chan)
+        return ERR_NOT_FOUND;
+    if (cmd->payload_len > sim.max_msg_size)
+        return ERR_NOT_ENOUGH_BUFFER;
+
+    rc = chan->srv->on_msg(chan, cmd->payload, cmd->payload_len);
+    if (rc != ERR_NOT_ENOUGH_BUFFER)
+        sim.stats.msgs_in++;
+    cmd->payload_len = 0;
+    return rc;
+}
+
+static int sim_recv(struct trusty_ipc_cmd_hdr* cmd) {
+    struct sim_msg* msg;
+    struct sim_chan* chan = sim_lookup_chan(cmd->handle);
+
+    if (!chan)
+        return ERR_NOT_FOUND;
+    if (!chan->msg_cnt)
+        return ERR_NO_MSG;
+
+    msg = &chan->msgs[chan->msg_head];
+    memcpy(cmd->payload, msg->data, msg->len);
+    cmd->payload_len = msg->len;
+    sim_chan_pop(chan);
+    return NO_ERROR;
+}
+
+static int sim_recv_partial(struct trusty_ipc_cmd_hdr* cmd) {
+    struct sim_msg* msg;
+    struct trusty_ipc_recv_req req;
+    struct trusty_ipc_recv_resp resp = {0};
+    size_t len;
+    struct sim_chan* chan = sim_lookup_chan(cmd->handle);
+
+    if (!chan)
+        return ERR_NOT_FOUND;
+    if (cmd->payload_len < sizeof(req))
+        return ERR_INVALID_ARGS;
+    if (!chan->msg_cnt)
+        return ERR_NO_MSG;
+
+    memcpy(&req, cmd->payload, sizeof(req));
+    msg = &chan->msgs[chan->msg_head];
+    if (req.offset > msg->len)
+        return ERR_INVALID_ARGS;
+
+    len = MIN(req.max_len, msg->len - req.offset);
+    len = MIN(len, sim.max_msg_size - sizeof(resp));
+    resp.msg_len = (uint32_t)msg->len;
+    memcpy(cmd->payload, &resp, sizeof(resp));
+    memcpy(cmd->payload + sizeof(resp), msg->data + req.offset, len);
+    cmd->payload_len = sizeof(resp) + len;
+
+    if (!(cmd->flags & QL_TIPC_DEV_RECV_PEEK) &&
+        req.offset + len == msg->len) {
+        sim_chan_pop(chan);
+    }
+    return NO_ERROR;
+}
+
+static int sim_disconnect(struct trusty_ipc_cmd_hdr* cmd) {
+    struct sim_chan* chan = sim_lookup_chan(cmd->handle);
+
+    if (!chan)
+        return ERR_NOT_FOUND;
+    sim_chan_free(chan);
+    cmd->payload_len = 0;
+    return NO_ERROR;
+}
+
+int trusty_sim_dev_exec(void* buf,
+                        size_t buf_size,
+                        size_t cmd_size,
+                        bool fast) {
+    int rc;
+    struct trusty_ipc_cmd_hdr* cmd = buf;
+
+    if (buf != sim.buf || cmd_size < sizeof(*cmd) || cmd_size > buf_size ||
+        cmd->payload_len > cmd_size - sizeof(*cmd)) {
+        return ERR_INVALID_ARGS;
+    }
+
+    if (fast)
+        sim.stats.fast_calls++;
+    else
+        sim.stats.std_calls++;
+    sim.stats.bytes_in += cmd_size;
+
+    if (fast) {
+        rc = cmd->opcode == QL_TIPC_DEV_FC_HAS_EVENT ? sim_has_event(cmd)
+                                                     : ERR_NOT_SUPPORTED;
+    } else {
+        switch (cmd->opcode) {
+        case QL_TIPC_DEV_CONNECT:
+            rc = sim_connect(cmd);
+            break;
+        case QL_TIPC_DEV_GET_EVENT:
+            rc = sim_get_event(cmd);
+            break;
+        case QL_TIPC_DEV_SEND:
+            rc = sim_send(cmd);
+            break;
+        case QL_TIPC_DEV_RECV:
+            rc = sim_recv(cmd);
+            break;
+        case QL_TIPC_DEV_DISCONNECT:
+            rc = sim_disconnect(cmd);
+            break;
+        case QL_TIPC_DEV_RECV_PARTIAL:
+            if (sim.config.api_version < TRUSTY_API_VERSION_QL_TIPC_EXT)
+                rc = ERR_INVALID_ARGS;
+            else if (sim.config.legacy)
+                rc = ERR_NOT_SUPPORTED;
+            else
+                rc = sim_recv_partial(cmd);
+            break;
+        case QL_TIPC_DEV_CONNECT_WITH_MSG:
+            if (sim.config.api_version < TRUSTY_API_VERSION_QL_TIPC_EXT)
+                rc = ERR_INVALID_ARGS;
+            else if (sim.config.legacy)
+                rc = ERR_NOT_SUPPORTED;
+            else
+                rc = sim_connect_with_msg(cmd);
+            break;
+        default:
+            rc = ERR_NOT_SUPPORTED;
+        }
+    }
+
+    cmd->opcode |= QL_TIPC_DEV_RESP;
+    cmd->status = (uint32_t)rc;
+    if (rc != NO_ERROR)
+        cmd->payload_len = 0;
+    sim.stats.bytes_out += sizeof(*cmd) + cmd->payload_len;
+    return 0;
+}
+
+int trusty_sim_dev_create(void* buf, size_t buf_size) {
+    if (sim.buf || buf_size <= sizeof(struct trusty_ipc_cmd_hdr))
+        return ERR_INVALID_ARGS;
+
+    sim.buf = buf;
+    sim.buf_size = buf_size;
+    sim.max_msg_size = buf_size - sizeof(struct trusty_ipc_cmd_hdr);
+    return NO_ERROR;
+}
+
+void trusty_sim_dev_shutdown(void* buf) {
+    size_t i;
+
+    if (buf != sim.buf)
+        return;
+
+    for (i = 0; i < SIM_MAX_CHANS; i++) {
+        if (sim.chans[i].in_use)
+            sim_chan_free(&sim.chans[i]);
+    }
+    sim.buf = NULL;
+}
+
+static int sim_loopback_create(struct trusty_ipc_loopback* lb,
+                               void* buf,
+                               size_t buf_size) {
+    return trusty_sim_dev_create(buf, buf_size);
+}
+
+static void sim_loopback_shutdown(struct trusty_ipc_loopback* lb) {
+    trusty_sim_dev_shutdown(sim.buf);
+}
+
+static int sim_loopback_handle_cmd(struct trusty_ipc_loopback* lb,
+                                   void* buf,
+                                   size_t buf_size,
+                                   size_t cmd_size,
+                                   bool fast) {
+    return trusty_sim_dev_exec(buf, buf_size, cmd_size, fast);
+}
+
+struct trusty_ipc_loopback trusty_sim_loopback = {
+        .create = sim_loopback_create,
+        .shutdown = sim_loopback_shutdown,
+        .handle_cmd = sim_loopback_handle_cmd,
+};
+
+struct trusty_sim_stats* trusty_sim_stats(void) {
+    return &sim.stats;
+}
+
+uint32_t trusty_sim_api_version(void) {
+    return sim.config.api_version;
+}
+
+void trusty_sim_init(const struct trusty_sim_config* config) {
+    size_t i;
+
+    trusty_sim_dev_shutdown(sim.buf);
+    free(sim.km.ca_request);
+    free(sim.avb.perm_attr);
+    free(sim.hwbcc.artifacts);
+    memset(&sim, 0, sizeof(sim));
+
+    sim.config = config ? *config : trusty_sim_default_config;
+    if (!sim.config.api_version)
+        sim.config.api_version = TRUSTY_API_VERSION_CURRENT;
+    trusty_sim_loopback.api_version = sim.config.api_version;
+
+    sim.km.ca_request = malloc(sim.config.ca_request_size + 1);
+    sim.avb.perm_attr = malloc(sim.config.perm_attr_size + 1);
+    if (!sim.km.ca_request || !sim.avb.perm_attr)
+        abort();
+    for (i = 0; i < sim.config.ca_request_size; i++)
+        sim.km.ca_request[i] = (uint8_t)i;
+    for (i = 0; i < sim.config.perm_attr_size; i++)
+        sim.avb.perm_attr[i] = (uint8_t)(i * 7);
+
+    hwbcc_build_artifacts();
+}
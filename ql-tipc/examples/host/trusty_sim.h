@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef QL_TIPC_HOST_TRUSTY_SIM_H_
+#define QL_TIPC_HOST_TRUSTY_SIM_H_
+
+/*
+ * Simulated secure side for host builds of ql-tipc. Implements the queueless
+ * Trusty IPC device together with small models of the keymaster, AVB, HWBCC,
+ * secure storage and echo services. It is reached either through the
+ * simulated secure monitor in smc_host.c, which exercises the real SMC and
+ * FF-A code paths, or directly through the loopback transport.
+ *
+ * The models implement the wire formats, not the security properties, of
+ * the services. They exist to measure and regression-test client-side cost.
+ */
+
+#include <trusty/sysdeps.h>
+#include <trusty/trusty_ipc_loopback.h>
+
+#define TRUSTY_SIM_ECHO_PORT "com.android.ipc-unittest.srv.echo"
+
+/*
+ * Port of a service that discards messages, each starting with a uint32_t
+ * sequence number. It takes them slowly enough for senders to block.
+ */
+#define TRUSTY_SIM_SINK_PORT "com.android.trusty.sim.sink"
+
+/*
+ * Port of a second secure storage service, served by its own storage proxy.
+ * Storage proxy 0 is the one at STORAGE_DISK_PROXY_PORT, proxy 1 the one at
+ * this port.
+ */
+#define TRUSTY_SIM_STORAGE2_PORT "com.android.trusty.sim.storage.proxy2"
+#define TRUSTY_SIM_STORAGE_PROXIES 2
+
+/**
+ * struct trusty_sim_config - shape of the data returned by the services
+ * @ca_request_size:   size of the KM_ATAP_GET_CA_REQUEST response data
+ * @perm_attr_size:    size of the AVB permanent attributes
+ * @bcc_entries:       number of BccEntry items in the DICE artifacts
+ * @bcc_payload_size:  size of the payload of each BccEntry
+ * @legacy:            reject the optional QL_TIPC_DEV_* commands and the
+ *                     newer AVB commands like older secure OSes
+ * @api_version:       API version to negotiate, TRUSTY_API_VERSION_CURRENT
+ *                     if 0. QL_TIPC_DEV_* commands that are newer fail with
+ *                     ERR_INVALID_ARGS, like any unknown command.
+ */
+struct trusty_sim_config {
+    size_t ca_request_size;
+    size_t perm_attr_size;
+    size_t bcc_entries;
+    size_t bcc_payload_size;
+    bool legacy;
+    uint32_t api_version;
+};
+
+/**
+ * struct trusty_sim_stats - counters maintained by the simulated secure side
+ * @std_calls:       commands executed as standard calls
+ * @fast_calls:      commands executed as fast calls, and version string
+ *                   fast calls
+ * @bytes_in:        command bytes (header and payload) read by the secure side
+ * @bytes_out:       response bytes written back by the secure side
+ * @msgs_in:         messages delivered to services
+ * @msgs_out:        messages received by the non-secure side
+ * @rpmb_sends:      calls to rpmb_storage_send and rpmb_storage_send_multi
+ * @rpmb_frames:     RPMB frames moved by them
+ * @storage_resps:   responses received from the storage proxy
+ * @storage_errors:  storage proxy responses that carried an error
+ * @sink_msgs:       messages taken by the sink service
+ * @sink_errors:     sink messages that were short or out of sequence
+ * @avb_commits:     storage transactions that wrote AVB rollback indexes
+ */
+struct trusty_sim_stats {
+    uint64_t std_calls;
+    uint64_t fast_calls;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t msgs_in;
+    uint64_t msgs_out;
+    uint64_t rpmb_sends;
+    uint64_t rpmb_frames;
+    uint64_t storage_resps;
+    uint64_t storage_errors;
+    uint64_t sink_msgs;
+    uint64_t sink_errors;
+    uint64_t avb_commits;
+};
+
+extern const struct trusty_sim_config trusty_sim_default_config;
+
+/*
+ * Resets all service state to the defaults described by @config. Must be
+ * called before any Trusty IPC device is created.
+ */
+void trusty_sim_init(const struct trusty_sim_config* config);
+
+/*
+ * Returns the counters of the simulated secure side. The caller may clear
+ * them at any time.
+ */
+struct trusty_sim_stats* trusty_sim_stats(void);
+
+/*
+ * Returns the API version the simulated secure side supports, see
+ * SMC_FC_API_VERSION.
+ */
+uint32_t trusty_sim_api_version(void);
+
+/*
+ * Queueless IPC device entry points. These correspond to
+ * SMC_SC_TRUSTY_IPC_CREATE_QL_DEV, SMC_SC_TRUSTY_IPC_HANDLE_QL_DEV_CMD (or
+ * SMC_FC_HANDLE_QL_TIPC_DEV_CMD if @fast is set) and
+ * SMC_SC_TRUSTY_IPC_SHUTDOWN_QL_DEV. Return 0 or a negative error.
+ */
+int trusty_sim_dev_create(void* buf, size_t buf_size);
+int trusty_sim_dev_exec(void* buf, size_t buf_size, size_t cmd_size, bool fast);
+void trusty_sim_dev_shutdown(void* buf);
+
+/*
+ * Loopback handler that plays the secure side in-process, for use with
+ * trusty_ipc_loopback_dev_create.
+ */
+extern struct trusty_ipc_loopback trusty_sim_loopback;
+
+/*
+ * Makes the secure storage service queue @count STORAGE_RPMB_SEND requests
+ * for storage proxy @proxy. Each writes @write_size bytes and reads
+ * @read_size bytes. The first @batched requests carry STORAGE_MSG_FLAG_BATCH
+ * and are not answered: count - 1 makes one batch ended by the last request,
+ * count leaves the batch open. Returns 0 or a negative error if the proxy is
+ * not connected.
+ */
+int trusty_sim_storage_queue_rpmb(unsigned proxy,
+                                  unsigned count,
+                                  uint32_t write_size,
+                                  uint32_t read_size,
+                                  unsigned batched);
+
+#endif /* QL_TIPC_HOST_TRUSTY_SIM_H_ */
@@ -16,13 +16,34 @@
 
 #include <trusty/hwbcc.h>
 #include <trusty/trusty_ipc.h>
+#include <trusty/trusty_ipc_framer.h>
 #include <trusty/util.h>
 
 #include <uapi/uapi/err.h>
 
+#define LOCAL_LOG 0
+
 static struct trusty_ipc_chan hwbcc_chan;
 static bool initialized;
 
+/* Set once the service rejected HWBCC_CMD_GET_DICE_ARTIFACTS_MULTI */
+static bool multi_unsupported;
+
+#ifndef HWBCC_CACHE_ENTRIES
+#define HWBCC_CACHE_ENTRIES 2
+#endif
+
+/* DICE artifacts received for @context, see hwbcc_cache_enable */
+struct hwbcc_cache_entry {
+    uint64_t context;
+    uint8_t* data;
+    size_t size;
+};
+
+static bool cache_enabled;
+static struct hwbcc_cache_entry cache[HWBCC_CACHE_ENTRIES];
+static size_t cache_next;
+
 #ifndef MIN
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #endif
@@ -39,6 +60,7 @@ int hwbcc_tipc_init(struct trusty_ipc_dev* dev) {
         return rc;
     }
     initialized = true;
+    multi_unsupported = false;
     return TRUSTY_ERR_NONE;
 }
 
@@ -47,9 +69,67 @@ void hwbcc_tipc_shutdown() {
         return;
     }
     trusty_ipc_close(&hwbcc_chan);
+    hwbcc_cache_enable(false);
     initialized = false;
 }
 
+/* Wipes and frees @entry, whose artifacts include the CDIs */
+static void cache_entry_free(struct hwbcc_cache_entry* entry) {
+    if (entry->data) {
+        trusty_memset(entry->data, 0, entry->size);
+    }
+    trusty_free(entry->data);
+}
+
+static void cache_clear(void) {
+    for (size_t i = 0; i < HWBCC_CACHE_ENTRIES; i++) {
+        cache_entry_free(&cache[i]);
+        cache[i].data = NULL;
+        cache[i].size = 0;
+    }
+    cache_next = 0;
+}
+
+void hwbcc_cache_enable(bool enable) {
+    if (!enable) {
+        cache_clear();
+    }
+    cache_enabled = enable;
+}
+
+static const struct hwbcc_cache_entry* cache_lookup(uint64_t context) {
+    if (!cache_enabled) {
+        return NULL;
+    }
+    for (size_t i = 0; i < HWBCC_CACHE_ENTRIES; i++) {
+        if (cache[i].data && cache[i].context == context) {
+            return &cache[i];
+        }
+    }
+    return NULL;
+}
+
+/* Keeps a copy of @data, replacing the oldest entry if the cache is full */
+static void cache_store(uint64_t context, const uint8_t* data, size_t size) {
+    struct hwbcc_cache_entry* entry = &cache[cache_next];
+    uint8_t* copy;
+
+    if (!cache_enabled) {
+        return;
+    }
+    copy = trusty_calloc(1, size ? size : 1);
+    if (!copy) {
+        return; /* the next call asks the service again */
+    }
+    trusty_memcpy(copy, data, size);
+
+    cache_entry_free(entry);
+    entry->context = context;
+    entry->data = copy;
+    entry->size = size;
+    cache_next = (cache_next + 1) % HWBCC_CACHE_ENTRIES;
+}
+
 static int send_header_only_request(struct hwbcc_req_hdr* hdr,
                                     size_t hdr_size) {
     int num_iovec = 1;
@@ -132,6 +212,89 @@ static int read_header_only_response(struct hwbcc_req_hdr* hdr) {
     return rc;
 }
 
+/*
+ * Validates the header of each message of a multi-message response. Returns
+ * @frame_len or a trusty_err.
+ */
+static int check_dice_frame(struct trusty_ipc_framer* framer,
+                            size_t frame_len) {
+    const struct hwbcc_resp_hdr* resp_hdr = framer->hdr;
+
+    if ((resp_hdr->cmd & ~HWBCC_CMD_STOP_BIT) !=
+        (HWBCC_CMD_GET_DICE_ARTIFACTS_MULTI | HWBCC_CMD_RESP_BIT)) {
+        trusty_error("Unknown response cmd: %x\n", resp_hdr->cmd);
+        return TRUSTY_ERR_GENERIC;
+    }
+
+    if (resp_hdr->status == ERR_NOT_SUPPORTED) {
+        /* how the service answers commands it does not know */
+        trusty_debug("Multi-message DICE artifacts not supported.\n");
+        return TRUSTY_ERR_NOT_SUPPORTED;
+    }
+
+    if (resp_hdr->status != NO_ERROR) {
+        trusty_error("Status (%d) is not SUCCESS.\n", resp_hdr->status);
+        return TRUSTY_ERR_GENERIC;
+    }
+
+    if (resp_hdr->payload_size != frame_len - sizeof(*resp_hdr)) {
+        trusty_error("Invalid payload size: %d.", resp_hdr->payload_size);
+        return TRUSTY_ERR_GENERIC;
+    }
+
+    return (int)frame_len;
+}
+
+/*
+ * Gets the DICE artifacts with HWBCC_CMD_GET_DICE_ARTIFACTS_MULTI, which has
+ * no size limit other than @buf_size. Returns a trusty_err,
+ * TRUSTY_ERR_NOT_SUPPORTED if the service predates the command.
+ *
+ * There is no schema for this command: the request is a fixed header, and
+ * the response is opaque bytes split over several messages, each with its
+ * own header. The framer checks the headers and gathers the bytes into
+ * @buf, while a schema only describes one message held in one buffer.
+ */
+static int get_dice_artifacts_multi(uint64_t context,
+                                    uint8_t* buf,
+                                    size_t buf_size,
+                                    size_t* out_size) {
+    struct hwbcc_req_hdr hdr = {
+            .cmd = HWBCC_CMD_GET_DICE_ARTIFACTS_MULTI,
+            .context = context,
+    };
+    struct hwbcc_resp_hdr resp_hdr = {};
+    struct trusty_ipc_iovec hdr_iov = {.base = &resp_hdr,
+                                       .len = sizeof(resp_hdr)};
+    struct trusty_ipc_iovec buf_iov = {.base = buf, .len = buf_size};
+    struct trusty_ipc_framer framer;
+
+    int rc = send_header_only_request(&hdr, sizeof(hdr));
+    if (rc < 0) {
+        return rc;
+    }
+
+    trusty_ipc_framer_init(&framer, &hwbcc_chan, &resp_hdr, sizeof(resp_hdr),
+                           HWBCC_CMD_STOP_BIT, 0);
+    framer.check = check_dice_frame;
+    rc = trusty_ipc_framer_recv(&framer, &buf_iov, 1, true);
+    if (rc >= 0 && (resp_hdr.cmd & HWBCC_CMD_STOP_BIT)) {
+        *out_size = rc;
+        return TRUSTY_ERR_NONE;
+    }
+
+    /* @buf is full, drop the rest of the response */
+    while (rc >= 0 || rc == TRUSTY_ERR_MSG_TOO_BIG) {
+        if (resp_hdr.cmd & HWBCC_CMD_STOP_BIT) {
+            trusty_error("DICE artifacts do not fit into %zu bytes.\n",
+                         buf_size);
+            return TRUSTY_ERR_MSG_TOO_BIG;
+        }
+        rc = trusty_ipc_recv(&hwbcc_chan, &hdr_iov, 1, true);
+    }
+    return rc;
+}
+
 int hwbcc_get_dice_artifacts(uint64_t context,
                              uint8_t* dice_artifacts,
                              size_t dice_artifacts_buf_size,
@@ -139,11 +302,37 @@ int hwbcc_get_dice_artifacts(uint64_t context,
     trusty_assert(dice_artifacts);
     trusty_assert(dice_artifacts_size);
 
-    struct hwbcc_req_hdr hdr;
-    hdr.cmd = HWBCC_CMD_GET_DICE_ARTIFACTS;
-    hdr.context = context;
+    const struct hwbcc_cache_entry* cached = cache_lookup(context);
+    if (cached) {
+        if (cached->size > dice_artifacts_buf_size) {
+            return TRUSTY_ERR_MSG_TOO_BIG;
+        }
+        trusty_memcpy(dice_artifacts, cached->data, cached->size);
+        *dice_artifacts_size = cached->size;
+        return TRUSTY_ERR_NONE;
+    }
 
-    int rc = send_header_only_request(&hdr, sizeof(hdr));
+    int rc;
+    if (!multi_unsupported) {
+        rc = get_dice_artifacts_multi(context, dice_artifacts,
+                                      dice_artifacts_buf_size,
+                                      dice_artifacts_size);
+        if (rc == TRUSTY_ERR_NONE) {
+            cache_store(context, dice_artifacts, *dice_artifacts_size);
+        }
+        if (rc != TRUSTY_ERR_NOT_SUPPORTED) {
+            return rc;
+        }
+        multi_unsupported = true;
+    }
+
+    /* single message response, limited to HWBCC_MAX_RESP_PAYLOAD_SIZE */
+    struct hwbcc_req_hdr hdr = {
+            .cmd = HWBCC_CMD_GET_DICE_ARTIFACTS,
+            .context = context,
+    };
+
+    rc = send_header_only_request(&hdr, sizeof(hdr));
 
     if (rc < 0) {
         trusty_error(
@@ -162,11 +351,16 @@ int hwbcc_get_dice_artifacts(uint64_t context,
         return rc;
     }
 
+    cache_store(context, dice_artifacts, *dice_artifacts_size);
     return TRUSTY_ERR_NONE;
 }
 
 int hwbcc_ns_deprivilege(void) {
     struct hwbcc_req_hdr hdr = {.cmd = HWBCC_CMD_NS_DEPRIVILEGE};
+
+    /* artifacts must not be handed out after this, even from the cache */
+    cache_clear();
+
     int rc = send_header_only_request(&hdr, sizeof(hdr));
 
     if (rc < 0) {
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <trusty/hwbcc_handover.h>
+#include <trusty/trusty_ipc.h>
+#include <trusty/util.h>
+
+#define LOCAL_LOG 0
+
+/* Deepest nesting of arrays, maps and tags that is skipped over */
+#define CBOR_MAX_DEPTH 16
+
+enum cbor_major {
+    CBOR_UINT = 0,
+    CBOR_NINT = 1,
+    CBOR_BSTR = 2,
+    CBOR_TSTR = 3,
+    CBOR_ARRAY = 4,
+    CBOR_MAP = 5,
+    CBOR_TAG = 6,
+    CBOR_SIMPLE = 7,
+};
+
+/* Unread part of a CBOR encoded buffer */
+struct cbor_reader {
+    const uint8_t* pos;
+    const uint8_t* end;
+};
+
+static size_t cbor_left(const struct cbor_reader* r) {
+    return (size_t)(r->end - r->pos);
+}
+
+/*
+ * Reads the head of the next item into @major and @val. Fails on truncated
+ * heads and on indefinite lengths, which DICE artifacts do not use.
+ */
+static bool cbor_read_head(struct cbor_reader* r,
+                           uint8_t* major,
+                           uint64_t* val) {
+    uint8_t info;
+    size_t len;
+    size_t i;
+
+    if (!cbor_left(r))
+        return false;
+    *major = *r->pos >> 5;
+    info = *r->pos & 0x1f;
+    r->pos++;
+
+    if (info < 24) {
+        *val = info;
+        return true;
+    }
+    if (info > 27)
+        return false;
+    len = (size_t)1 << (info - 24);
+    if (cbor_left(r) < len)
+        return false;
+    *val = 0;
+    for (i = 0; i < len; i++)
+        *val = (*val << 8) | *r->pos++;
+    return true;
+}
+
+/* Reads a byte string and points @view at its contents */
+static bool cbor_read_bstr(struct cbor_reader* r, struct hwbcc_view* view) {
+    uint8_t major;
+    uint64_t len;
+
+    if (!cbor_read_head(r, &major, &len) || major != CBOR_BSTR ||
+        len > cbor_left(r)) {
+        return false;
+    }
+    view->data = r->pos;
+    view->size = (size_t)len;
+    r->pos += len;
+    return true;
+}
+
+/* Skips the next item, including everything nested in it */
+static bool cbor_skip(struct cbor_reader* r, unsigned depth) {
+    uint8_t major;
+    uint64_t val;
+    uint64_t i;
+
+    if (!cbor_read_head(r, &major, &val))
+        return false;
+
+    switch (major) {
+    case CBOR_BSTR:
+    case CBOR_TSTR:
+        if (val > cbor_left(r))
+            return false;
+        r->pos += val;
+        return true;
+
+    case CBOR_ARRAY:
+    case CBOR_MAP:
+    case CBOR_TAG:
+        if (depth == CBOR_MAX_DEPTH)
+            return false;
+        if (major == CBOR_TAG) {
+            val = 1;
+        } else if (major == CBOR_MAP) {
+            if (val > cbor_left(r))
+                return false;
+            val *= 2;
+        }
+        /* every item takes at least one byte */
+        if (val > cbor_left(r))
+            return false;
+        for (i = 0; i < val; i++) {
+            if (!cbor_skip(r, depth + 1))
+                return false;
+        }
+        return true;
+
+    default:
+        /* integers and simple values are all head */
+        return true;
+    }
+}
+
+/* Parses the Bcc array, which may be wrapped in a byte string */
+static bool parse_bcc(struct cbor_reader* r, struct hwbcc_handover* handover) {
+    struct cbor_reader bcc = *r;
+    struct hwbcc_view wrapped = {0};
+    uint8_t major;
+    uint64_t count;
+    uint64_t i;
+
+    if (cbor_left(r) && (*r->pos >> 5) == CBOR_BSTR) {
+        if (!cbor_read_bstr(r, &wrapped))
+            return false;
+        bcc.pos = wrapped.data;
+        bcc.end = wrapped.data + wrapped.size;
+    }
+
+    handover->bcc.data = bcc.pos;
+    if (!cbor_read_head(&bcc, &major, &count) || major != CBOR_ARRAY ||
+        count < 1) {
+        return false;
+    }
+    handover->pub_key.data = bcc.pos;
+    if (!cbor_skip(&bcc, 0))
+        return false;
+    handover->pub_key.size = bcc.pos - handover->pub_key.data;
+    for (i = 1; i < count; i++) {
+        if (!cbor_skip(&bcc, 0))
+            return false;
+    }
+    handover->bcc.size = bcc.pos - handover->bcc.data;
+    handover->num_entries = (size_t)(count - 1);
+
+    if (wrapped.data)
+        return !cbor_left(&bcc);
+    r->pos = bcc.pos;
+    return true;
+}
+
+int hwbcc_handover_parse(const uint8_t* buf,
+                         size_t size,
+                         struct hwbcc_handover* handover) {
+    struct cbor_reader r;
+    uint8_t major;
+    uint64_t count;
+    uint64_t key;
+    uint64_t i;
+    bool ok;
+
+    if (!buf || !handover) {
+        return TRUSTY_ERR_INVALID_ARGS;
+    }
+    trusty_memset(handover, 0, sizeof(*handover));
+    r.pos = buf;
+    r.end = buf + size;
+
+    ok = cbor_read_head(&r, &major, &count) && major == CBOR_MAP;
+    for (i = 0; ok && i < count; i++) {
+        ok = cbor_read_head(&r, &major, &key) && major == CBOR_UINT;
+        if (!ok)
+            break;
+        switch (key) {
+        case 1:
+            ok = cbor_read_bstr(&r, &handover->cdi_attest);
+            break;
+        case 2:
+            ok = cbor_read_bstr(&r, &handover->cdi_seal);
+            break;
+        case 3:
+            ok = parse_bcc(&r, handover);
+            break;
+        default:
+            ok = cbor_skip(&r, 0);
+            break;
+        }
+    }
+
+    if (!ok || cbor_left(&r) || !handover->cdi_attest.data ||
+        !handover->cdi_seal.data || !handover->bcc.data) {
+        trusty_error("%s: malformed BccHandover\n", __func__);
+        return TRUSTY_ERR_GENERIC;
+    }
+    return TRUSTY_ERR_NONE;
+}
+
+int hwbcc_handover_get_entry(const struct hwbcc_handover* handover,
+                             size_t index,
+                             struct hwbcc_view* entry) {
+    struct cbor_reader r;
+    uint8_t major;
+    uint64_t count;
+    size_t i;
+
+    if (!handover || !entry || index >= handover->num_entries) {
+        return TRUSTY_ERR_INVALID_ARGS;
+    }
+    r.pos = handover->bcc.data;
+    r.end = handover->bcc.data + handover->bcc.size;
+
+    /* skip the array head, the public key and the entries before @index */
+    if (!cbor_read_head(&r, &major, &count))
+        return TRUSTY_ERR_GENERIC;
+    for (i = 0; i <= index; i++) {
+        if (!cbor_skip(&r, 0))
+            return TRUSTY_ERR_GENERIC;
+    }
+    entry->data = r.pos;
+    if (!cbor_skip(&r, 0))
+        return TRUSTY_ERR_GENERIC;
+    entry->size = r.pos - entry->data;
+    return TRUSTY_ERR_NONE;
+}
@@ -27,7 +27,50 @@
 
 #include <interface/avb/avb.h>
 #include <trusty/sysdeps.h>
+#include <trusty/trusty_dev.h>
 #include <trusty/trusty_ipc.h>
+#include <trusty/trusty_ipc_schema.h>
+
+/*
+ * Decoded READ_ROLLBACK_INDEX_MULTI and WRITE_ROLLBACK_INDEX_MULTI request,
+ * see avb_rollback_multi_req. The entries are referenced, not inline.
+ *
+ * @entries:      @count packed avb_rollback_req entries
+ * @entries_size: size of @entries in bytes
+ */
+struct avb_rollback_multi {
+    uint32_t count;
+    uint32_t reserved;
+    const uint8_t* entries;
+    uint32_t entries_size;
+};
+
+/*
+ * Decoded AVB_GET_SNAPSHOT response, see avb_snapshot_resp. The rollback
+ * indexes are referenced, not inline.
+ *
+ * @rollback:      @rollback_count uint64_t values, not necessarily aligned
+ * @rollback_size: size of @rollback in bytes
+ */
+struct avb_snapshot {
+    uint8_t lock_state;
+    uint8_t boot_locked;
+    uint16_t reserved;
+    uint32_t perm_attr_size;
+    uint8_t perm_attr_digest[AVB_PERM_ATTR_DIGEST_SIZE];
+    uint32_t rollback_count;
+    uint32_t reserved2;
+    const uint8_t* rollback;
+    uint32_t rollback_size;
+};
+
+/*
+ * Wire formats of the variable sized AVB messages above. The client builds
+ * and checks messages with these, and the secure side can decode them.
+ * Neither checks that the count matches the size of the array.
+ */
+extern const struct trusty_ipc_schema avb_rollback_multi_schema;
+extern const struct trusty_ipc_schema avb_snapshot_schema;
 
 /*
  * Initialize AVB TIPC client. Returns one of trusty_err.
@@ -35,12 +78,56 @@
  * @dev: initialized with trusty_ipc_dev_create
  */
 int avb_tipc_init(struct trusty_ipc_dev* dev);
+
+/*
+ * Like avb_tipc_init, but skips the version handshake if @handoff holds a
+ * version an earlier boot stage negotiated with the same Trusty instance.
+ * Otherwise the handshake is done and, on success, its result is stored in
+ * @handoff for the next stage. Returns one of trusty_err.
+ *
+ * @dev:         initialized with trusty_ipc_dev_create
+ * @instance_id: from trusty_dev_get_instance_id, 0 if unknown or to always
+ *               do the handshake
+ * @handoff:     optional, result of an earlier handshake
+ */
+int avb_tipc_init_handoff(struct trusty_ipc_dev* dev,
+                          uint64_t instance_id,
+                          struct trusty_version_handoff* handoff);
 /*
  * Shutdown AVB TIPC client.
  *
  * @dev: initialized with trusty_ipc_dev_create
  */
 void avb_tipc_shutdown(struct trusty_ipc_dev* dev);
+#ifdef TIPC_ENABLE_AVB_CACHE
+/*
+ * Counters of the AVB cache.
+ *
+ * @hits:   reads answered from the cache
+ * @misses: reads sent to the secure side while the cache was enabled
+ */
+struct trusty_avb_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+};
+/*
+ * Enables or disables the write-through cache of the lock state, permanent
+ * attributes and rollback indexes. While enabled, the first read of each
+ * value is sent to the secure side and later reads are answered from the
+ * cache. Successful writes update it, and trusty_lock_boot_state empties it.
+ * Disabling the cache empties it. It is disabled by avb_tipc_shutdown.
+ *
+ * The cache assumes that nothing else changes the AVB data during boot. It
+ * takes about 2.3 KB of memory and is only built if TIPC_ENABLE_AVB_CACHE is
+ * set.
+ */
+void trusty_avb_cache_enable(bool enable);
+/*
+ * Returns the counters of the AVB cache. The caller may clear them at any
+ * time.
+ */
+struct trusty_avb_cache_stats* trusty_avb_cache_stats(void);
+#endif
 /*
  * Send request to secure side to read rollback index.
  * Returns one of trusty_err.
@@ -57,19 +144,74 @@ int trusty_read_rollback_index(uint32_t slot, uint64_t* value);
  * @value:   rollback index value to write
  */
 int trusty_write_rollback_index(uint32_t slot, uint64_t value);
+/*
+ * Reads the rollback indexes of @count slots in one request. The value of
+ * each entry is replaced by the value of its slot. Returns one of trusty_err.
+ *
+ * Falls back to one trusty_read_rollback_index call per entry if the secure
+ * side does not support READ_ROLLBACK_INDEX_MULTI.
+ *
+ * @entries: slots to read, at most AVB_ROLLBACK_MULTI_MAX
+ * @count:   number of entries
+ */
+int trusty_read_rollback_indexes(struct avb_rollback_req* entries,
+                                 size_t count);
+/*
+ * Writes the rollback indexes of @count slots in one request, which the
+ * secure side commits in one storage transaction: either all values are
+ * written or none. On success the value of each entry is replaced by the
+ * value of its slot. Returns one of trusty_err.
+ *
+ * Falls back to one trusty_write_rollback_index call per entry if the secure
+ * side does not support WRITE_ROLLBACK_INDEX_MULTI. The fallback is not
+ * atomic: if it fails, the entries before the failing one are written.
+ *
+ * @entries: slots and values to write, at most AVB_ROLLBACK_MULTI_MAX
+ * @count:   number of entries
+ */
+int trusty_write_rollback_indexes(struct avb_rollback_req* entries,
+                                  size_t count);
 /*
  * Send request to secure side to read permanent attributes. When permanent
  * attributes are stored in RPMB, a hash of the permanent attributes which is
  * given to AVB during verification MUST still be backed by write-once hardware.
  *
- * Copies attributes received by secure side to |attributes|. If |size| does not
- * match the size returned by the secure side, an error is returned. Returns one
- * of trusty_err.
+ * Receives the attributes straight into |attributes|. If |size| does not
+ * match the size returned by the secure side, TRUSTY_ERR_INVALID_ARGS is
+ * returned and |attributes| may have been written to. Returns one of
+ * trusty_err.
  *
  * @attributes:  caller allocated buffer
- * @size:        size of |attributes|
+ * @size:        size of |attributes|, see
+ *               trusty_read_permanent_attributes_size
  */
 int trusty_read_permanent_attributes(uint8_t* attributes, uint32_t size);
+/*
+ * Gets the size of the permanent attributes without reading them, for
+ * callers that need it to allocate the buffer for
+ * trusty_read_permanent_attributes. Secure OSes that predate partial receives
+ * send the attributes anyway; they are then kept in the AVB cache if it is
+ * enabled. Without TIPC_ENABLE_AVB_CACHE, TRUSTY_ERR_NOT_SUPPORTED is
+ * returned for them. Returns one of trusty_err.
+ *
+ * @size: set to the size of the permanent attributes
+ */
+int trusty_read_permanent_attributes_size(uint32_t* size);
+/*
+ * Reads the lock state, a digest of the permanent attributes and every
+ * rollback index in one request. The response is received into @buf and
+ * @snapshot points into it, so it is valid as long as @buf is. Returns one of
+ * trusty_err, TRUSTY_ERR_NOT_SUPPORTED if the secure side does not support
+ * AVB_GET_SNAPSHOT.
+ *
+ * @buf:      receive buffer, AVB_MAX_BUFFER_LENGTH bytes are always enough.
+ *            The rollback indexes are aligned if @buf is 8 byte aligned.
+ * @size:     size of @buf
+ * @snapshot: set to the snapshot in @buf on success
+ */
+int trusty_read_avb_snapshot(void* buf,
+                             uint32_t size,
+                             const struct avb_snapshot_resp** snapshot);
 /*
  * Send request to secure side to write permanent attributes. Permanent
  * attributes can only be written to storage once.
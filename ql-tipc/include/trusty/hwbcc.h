@@ -34,9 +34,22 @@ int hwbcc_tipc_init(struct trusty_ipc_dev* dev);
  */
 void hwbcc_tipc_shutdown(void);
 
+/**
+ * Enables or disables the client side cache of DICE artifacts. While enabled,
+ * the artifacts returned by hwbcc_get_dice_artifacts are kept for each
+ * @context, so that the service only derives them once. Disabling the cache
+ * empties it, and so do hwbcc_ns_deprivilege and hwbcc_tipc_shutdown.
+ * Entries are allocated with trusty_calloc. They hold the DICE artifacts
+ * including CDI_Attest and CDI_Seal, which are secrets, so entries are wiped
+ * before they are freed.
+ */
+void hwbcc_cache_enable(bool enable);
+
 /**
  * Retrieves DICE artifacts for a child node in the DICE chain/tree in
- * non-secure world (e.g. ABL).
+ * non-secure world (e.g. ABL). Artifacts larger than
+ * HWBCC_MAX_RESP_PAYLOAD_SIZE are received in several messages if the service
+ * supports HWBCC_CMD_GET_DICE_ARTIFACTS_MULTI.
  * @context:                    Context information passed in by the client.
  * @dice_artifacts:             Pointer to a buffer to store the CBOR encoded
  *                              DICE artifacts.
@@ -57,7 +70,7 @@ int hwbcc_get_dice_artifacts(uint64_t context,
                              size_t* dice_artifacts_size);
 /**
  * Deprivilege hwbcc from serving calls (i.e. stop serving calls after this
- * point) to non-secure clients.
+ * point) to non-secure clients. Empties the cache of DICE artifacts.
  */
 int hwbcc_ns_deprivilege(void);
 
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TRUSTY_HWBCC_HANDOVER_H_
+#define TRUSTY_HWBCC_HANDOVER_H_
+
+#include <trusty/sysdeps.h>
+
+/*
+ * Bytes inside the buffer a BccHandover was parsed from.
+ */
+struct hwbcc_view {
+    const uint8_t* data;
+    size_t size;
+};
+
+/*
+ * Fields of a BccHandover map, as returned by hwbcc_get_dice_artifacts.
+ * Every view points into the parsed buffer, nothing is copied, so they are
+ * valid as long as that buffer is.
+ *
+ * @cdi_attest:  contents of CDI_Attest
+ * @cdi_seal:    contents of CDI_Seal
+ * @bcc:         the encoded Bcc array
+ * @pub_key:     the encoded COSE_Key at the start of the Bcc
+ * @num_entries: number of BccEntry items following @pub_key
+ */
+struct hwbcc_handover {
+    struct hwbcc_view cdi_attest;
+    struct hwbcc_view cdi_seal;
+    struct hwbcc_view bcc;
+    struct hwbcc_view pub_key;
+    size_t num_entries;
+};
+
+/*
+ * Parses the CBOR encoded BccHandover of @size bytes at @buf into @handover,
+ * without allocating. Both a Bcc array and a Bcc wrapped in a byte string are
+ * accepted. Returns a trusty_err, TRUSTY_ERR_GENERIC if @buf is malformed.
+ */
+int hwbcc_handover_parse(const uint8_t* buf,
+                         size_t size,
+                         struct hwbcc_handover* handover);
+
+/*
+ * Points @entry at the encoded BccEntry number @index of @handover, counted
+ * from the root. Returns a trusty_err.
+ */
+int hwbcc_handover_get_entry(const struct hwbcc_handover* handover,
+                             size_t index,
+                             struct hwbcc_view* entry);
+
+#endif /* TRUSTY_HWBCC_HANDOVER_H_ */
@@ -27,8 +27,22 @@
 
 #include <interface/keymaster/keymaster.h>
 #include <trusty/sysdeps.h>
+#include <trusty/trusty_dev.h>
 #include <trusty/trusty_ipc.h>
 
+/*
+ * Number of requests trusty_provision_attestation and
+ * trusty_atap_set_ca_response send ahead of reading their responses. The
+ * default of 1 reads each response before sending the next request. Deeper
+ * pipelines are opt-in: the responses queue up on the channel until they are
+ * read, so this must not exceed the number of messages the secure side can
+ * queue for a client. If a request finds the channel full, the oldest
+ * response is read before it is sent again.
+ */
+#ifndef KM_PIPELINE_DEPTH
+#define KM_PIPELINE_DEPTH 1
+#endif
+
 /*
  * Initialize Keymaster TIPC client. Returns one of trusty_err.
  *
@@ -36,6 +50,21 @@
  */
 int km_tipc_init(struct trusty_ipc_dev* dev);
 
+/*
+ * Like km_tipc_init, but skips the version handshake if @handoff holds a
+ * version an earlier boot stage negotiated with the same Trusty instance.
+ * Otherwise the handshake is done and, on success, its result is stored in
+ * @handoff for the next stage. Returns one of trusty_err.
+ *
+ * @dev:         initialized with trusty_ipc_dev_create
+ * @instance_id: from trusty_dev_get_instance_id, 0 if unknown or to always
+ *               do the handshake
+ * @handoff:     optional, result of an earlier handshake
+ */
+int km_tipc_init_handoff(struct trusty_ipc_dev* dev,
+                         uint64_t instance_id,
+                         struct trusty_version_handoff* handoff);
+
 /*
  * Shutdown Keymaster TIPC client.
  */
@@ -85,10 +114,52 @@ int trusty_set_attestation_key(const uint8_t* key,
 int trusty_append_attestation_cert_chain(const uint8_t* cert,
                                          uint32_t cert_size,
                                          keymaster_algorithm_t algorithm);
+
+/*
+ * One certificate of an attestation certificate chain.
+ *
+ * @data: buffer containing certificate
+ * @size: size of certificate in bytes
+ */
+struct trusty_attestation_cert {
+    const uint8_t* data;
+    uint32_t size;
+};
+
+/*
+ * Attestation key and certificate chain for one algorithm.
+ *
+ * @algorithm:  one of KM_ALGORITHM_RSA or KM_ALGORITHM_EC
+ * @key:        buffer containing key
+ * @key_size:   size of key in bytes
+ * @certs:      certificate chain, in the order it is appended
+ * @cert_count: number of entries in @certs
+ */
+struct trusty_attestation_keybox {
+    keymaster_algorithm_t algorithm;
+    const uint8_t* key;
+    uint32_t key_size;
+    const struct trusty_attestation_cert* certs;
+    size_t cert_count;
+};
+
+/*
+ * Provisions the attestation keys and certificate chains of all
+ * @keybox_count entries of @keyboxes. This is equivalent to calling
+ * trusty_set_attestation_key and then trusty_append_attestation_cert_chain
+ * for each certificate of each entry, but if KM_PIPELINE_DEPTH is raised,
+ * up to that many requests are sent before their responses are read. Every
+ * response is checked and the first error is returned once all requests are
+ * done. Returns one of trusty_err.
+ */
+int trusty_provision_attestation(
+        const struct trusty_attestation_keybox* keyboxes,
+        size_t keybox_count);
 /*
  * Reads a CA Request from Keymaster. On success allocates a new CA Request
- * message at |*ca_request_p|, and the caller takes ownership. Returns one
- * of trusty_err.
+ * message at |*ca_request_p|, and the caller takes ownership. The allocation
+ * is sized from the response where the secure OS supports partial receives.
+ * Returns one of trusty_err.
  *
  * @operation_start: Operation Start message
  * @operation_start_size: size of operation_start
@@ -100,7 +171,23 @@ int trusty_atap_get_ca_request(const uint8_t* operation_start,
                                uint8_t** ca_request_p,
                                uint32_t* ca_request_size_p);
 /*
- * Sends the CA Response to Keymaster. Returns one of trusty_err.
+ * Reads a CA Request from Keymaster into a caller provided buffer. Returns
+ * one of trusty_err, TRUSTY_ERR_MSG_TOO_BIG if the buffer is too small.
+ *
+ * @operation_start: Operation Start message
+ * @operation_start_size: size of operation_start
+ * @ca_request: buffer for the CA Request message
+ * @ca_request_size_p: size of ca_request on entry, size of the CA Request
+ *                     message on return
+ */
+int trusty_atap_get_ca_request_buf(const uint8_t* operation_start,
+                                   uint32_t operation_start_size,
+                                   uint8_t* ca_request,
+                                   uint32_t* ca_request_size_p);
+/*
+ * Sends the CA Response to Keymaster. The message is sent from @ca_response
+ * in chunks as large as the transport allows, with up to KM_PIPELINE_DEPTH
+ * chunks in flight, one by default. Returns one of trusty_err.
  *
  * @ca_response: CA Response message
  * @ca_response_size: size of ca_response
@@ -26,6 +26,7 @@
 #define TRUSTY_KEYMASTER_SERIALIZABLE_H_
 
 #include <trusty/keymaster.h>
+#include <trusty/trusty_ipc_schema.h>
 
 /**
  * Simple serialization routines for dynamically sized keymaster messages.
@@ -52,6 +53,14 @@ uint8_t* append_sized_buf_to_buf(uint8_t* buf,
                                  const uint8_t* data,
                                  uint32_t data_len);
 
+/**
+ * Wire formats of the keymaster request structures below. The serializers
+ * are built on these, and the secure side can decode requests with them.
+ */
+extern const struct trusty_ipc_schema km_boot_params_schema;
+extern const struct trusty_ipc_schema km_attestation_data_schema;
+extern const struct trusty_ipc_schema km_raw_buffer_schema;
+
 /**
  * Serializes a km_boot_params structure. On success, allocates |*out_size|
  * bytes to |*out| and writes the serialized |params| to |*out|. Caller takes
@@ -79,4 +88,30 @@ int km_raw_buffer_serialize(const struct km_raw_buffer* buf,
                             uint8_t** out,
                             uint32_t* out_size);
 
+/**
+ * Maximum number of iovecs filled in by the km_*_to_iovecs routines below.
+ */
+#define KM_MAX_REQ_IOVS 4
+
+/**
+ * The km_*_to_iovecs routines describe the same wire format as the
+ * serializers above as a list of at most KM_MAX_REQ_IOVS iovecs written to
+ * |iovs|, without allocating or copying. The iovecs point into the structure
+ * passed in and into the buffers it references, so both must stay valid until
+ * the request has been sent. Fields adjacent in memory share an iovec and
+ * empty buffers are left out. Each returns the number of iovecs used, or one
+ * of trusty_err on error.
+ */
+int km_boot_params_to_iovecs(const struct km_boot_params* params,
+                             struct trusty_ipc_iovec* iovs,
+                             size_t iovs_cnt);
+
+int km_attestation_data_to_iovecs(const struct km_attestation_data* data,
+                                  struct trusty_ipc_iovec* iovs,
+                                  size_t iovs_cnt);
+
+int km_raw_buffer_to_iovecs(const struct km_raw_buffer* buf,
+                            struct trusty_ipc_iovec* iovs,
+                            size_t iovs_cnt);
+
 #endif /* TRUSTY_KEYMASTER_SERIALIZABLE_H_ */
@@ -28,10 +28,27 @@
 #include <trusty/keymaster.h>
 #include <trusty/sysdeps.h>
 
+/*
+ * Version handshake results of the services libtipc connects to, handed
+ * from one boot stage to the next.
+ */
+struct trusty_ipc_handoff {
+    struct trusty_version_handoff avb;
+    struct trusty_version_handoff km;
+};
+
 /*
  * Initialize TIPC library
  */
 int trusty_ipc_init(void);
+/*
+ * Initialize TIPC library, skipping the version handshakes that @handoff
+ * holds results for from an earlier stage talking to the same Trusty
+ * instance. On success @handoff holds the results for the next stage. Secure
+ * OSes that take a message with the connect do the handshakes at no extra
+ * cost, so there @handoff is not used and is passed on without an instance.
+ */
+int trusty_ipc_init_handoff(struct trusty_ipc_handoff* handoff);
 /*
  * Shutdown TIPC library
  */
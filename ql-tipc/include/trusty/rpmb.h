@@ -30,6 +30,8 @@
 
 #define MMC_BLOCK_SIZE 512
 
+struct rpmb_storage_proxy;
+
 /*
  * Initialize RPMB storage proxy. Returns one of trusty_err.
  *
@@ -43,6 +45,25 @@ int rpmb_storage_proxy_init(struct trusty_ipc_dev* dev, void* rpmb_dev);
  * @dev: initialized with trusty_ipc_dev_create
  */
 void rpmb_storage_proxy_shutdown(struct trusty_ipc_dev* dev);
+/*
+ * Creates an RPMB storage proxy serving the storage service at @port with
+ * @rpmb_dev. Unlike rpmb_storage_proxy_init, which serves
+ * STORAGE_DISK_PROXY_PORT, any number of proxies can be created, e.g. one per
+ * RPMB device. Returns one of trusty_err.
+ *
+ * @proxy:    set to the new proxy
+ * @dev:      initialized with trusty_ipc_dev_create
+ * @rpmb_dev: Context of RPMB device, passed to rpmb_storage_send
+ * @port:     port of the storage service
+ */
+int rpmb_storage_proxy_create(struct rpmb_storage_proxy** proxy,
+                              struct trusty_ipc_dev* dev,
+                              void* rpmb_dev,
+                              const char* port);
+/*
+ * Disconnects and frees a proxy created with rpmb_storage_proxy_create
+ */
+void rpmb_storage_proxy_destroy(struct rpmb_storage_proxy* proxy);
 /*
  * Execute RPMB command. Implementation is platform specific.
  * Returns one of trusty_err.
@@ -54,7 +75,8 @@ void rpmb_storage_proxy_shutdown(struct trusty_ipc_dev* dev);
  * @write_data:          Buffer containing RPMB structs for write
  * @write_size:          Size of write_data
  * @read_data:           Buffer to be filled with RPMB structs read from RPMB
- *                       partition
+ *                       partition. It may overlap the write data, so it must
+ *                       only be written once the write data has been sent.
  * @read_size:           Size of read_data
  */
 int rpmb_storage_send(void* rpmb_dev,
@@ -64,6 +86,58 @@ int rpmb_storage_send(void* rpmb_dev,
                       size_t write_size,
                       void* read_buf,
                       size_t read_size);
+/*
+ * One RPMB command of a multi-command sequence, with the arguments of
+ * rpmb_storage_send. As there, @read_buf may overlap the write data of the
+ * same command.
+ */
+struct rpmb_storage_cmd {
+    const void* reliable_write_data;
+    size_t reliable_write_size;
+    const void* write_data;
+    size_t write_size;
+    void* read_buf;
+    size_t read_size;
+};
+#ifdef TIPC_ENABLE_RPMB_MULTI_CMD
+/*
+ * Execute @count RPMB commands in order, as one sequence, e.g. a single
+ * MMC_IOC_MULTI_CMD. Stops at the first command that fails. Implementation
+ * is platform specific and only needed if TIPC_ENABLE_RPMB_MULTI_CMD is set,
+ * otherwise the storage proxy calls rpmb_storage_send once per command.
+ * Returns one of trusty_err.
+ *
+ * @rpmb_dev: Context of RPMB device, initialized with rpmb_storage_get_ctx
+ * @cmds:     commands to execute
+ * @count:    number of commands
+ */
+int rpmb_storage_send_multi(void* rpmb_dev,
+                            const struct rpmb_storage_cmd* cmds,
+                            size_t count);
+#endif
+#ifdef TIPC_ENABLE_RPMB_ASYNC
+/*
+ * Start @count RPMB commands in order, as one sequence, and return without
+ * waiting for them. Commands started by later calls execute after these. The
+ * buffers of the commands must stay valid until rpmb_storage_wait returns.
+ * Implementation is platform specific and only needed if
+ * TIPC_ENABLE_RPMB_ASYNC is set. Returns one of trusty_err.
+ *
+ * @rpmb_dev: Context of RPMB device, initialized with rpmb_storage_get_ctx
+ * @cmds:     commands to start
+ * @count:    number of commands
+ */
+int rpmb_storage_send_async(void* rpmb_dev,
+                            const struct rpmb_storage_cmd* cmds,
+                            size_t count);
+/*
+ * Wait for all commands started with rpmb_storage_send_async. Returns
+ * TRUSTY_ERR_NONE if all of them succeeded, one of trusty_err otherwise.
+ *
+ * @rpmb_dev: Context of RPMB device, initialized with rpmb_storage_get_ctx
+ */
+int rpmb_storage_wait(void* rpmb_dev);
+#endif
 /*
  * Return context for RPMB device. This is called when the RPMB storage proxy is
  * initialized, and subsequently used when issuing RPMB storage requests.
@@ -138,7 +138,12 @@
 #define TRUSTY_API_VERSION_SMP_NOP (3)
 #define TRUSTY_API_VERSION_PHYS_MEM_OBJ (4)
 #define TRUSTY_API_VERSION_MEM_OBJ (5)
-#define TRUSTY_API_VERSION_CURRENT (5)
+/*
+ * queueless IPC device implements QL_TIPC_DEV_RECV_PARTIAL and
+ * QL_TIPC_DEV_CONNECT_WITH_MSG
+ */
+#define TRUSTY_API_VERSION_QL_TIPC_EXT (6)
+#define TRUSTY_API_VERSION_CURRENT (6)
 #define SMC_FC_API_VERSION SMC_FASTCALL_NR(SMC_ENTITY_SECURE_MONITOR, 11)
 
 /* TRUSTED_OS entity calls */
@@ -34,22 +34,47 @@ typedef uint64_t trusty_shared_mem_id_t;
  *
  * @priv_data:   system dependent data, may be unused
  * @api_version: TIPC version
+ * @instance_id: cached result of trusty_dev_get_instance_id, 0 if unknown
  */
 struct trusty_dev {
     void* priv_data;
     uint32_t api_version;
+    uint64_t instance_id;
     uint16_t ffa_local_id;
     uint16_t ffa_remote_id;
     void* ffa_tx;
     void* ffa_rx;
 };
 
+/*
+ * Outcome of a service version handshake, passed on to later boot stages so
+ * they can skip the handshake when talking to the same Trusty instance.
+ *
+ * @instance_id: trusty_dev_get_instance_id of the instance the version was
+ *               negotiated with, 0 if not set
+ * @version:     version the service reported
+ */
+struct trusty_version_handoff {
+    uint64_t instance_id;
+    uint32_t version;
+};
+
 /*
  * Initializes @dev with @priv, and gets the API version by calling
  * into Trusty. Returns negative on error.
  */
 int trusty_dev_init(struct trusty_dev* dev, void* priv);
 
+/*
+ * Gets an identifier of the running Trusty instance, a hash of its version
+ * string and API version, into @id. Boot stages use it to tell whether
+ * results handed over by an earlier stage came from the same instance. The
+ * string is read one character per fast call the first time, the result is
+ * cached in @dev. Returns TRUSTY_ERR_NOT_SUPPORTED if Trusty does not report
+ * a version string, otherwise a trusty_err.
+ */
+int trusty_dev_get_instance_id(struct trusty_dev* dev, uint64_t* id);
+
 /*
  * Cleans up anything related to @dev. Returns negative on error.
  */
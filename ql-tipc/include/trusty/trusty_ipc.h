@@ -93,13 +93,45 @@ struct trusty_ipc_iovec {
     size_t len;
 };
 
+struct trusty_ipc_dev;
+struct trusty_ipc_recorder;
+
+/*
+ * Trusty IPC transport. Carries commands placed in the shared buffer of a
+ * Trusty IPC device to the secure side. The response is written back into
+ * the same buffer.
+ *
+ * @attach: registers the shared buffer (already allocated) with the secure
+ *          side. Returns a trusty_err.
+ * @detach: unregisters the shared buffer from the secure side
+ * @exec:   executes the command of @cmd_size bytes at the start of the shared
+ *          buffer. If @fast is set the secure side must not block. Returns
+ *          negative on error.
+ * @idle:   waits for the secure side to have more work, see trusty_idle
+ */
+struct trusty_ipc_transport_ops {
+    int (*attach)(struct trusty_ipc_dev* dev);
+    void (*detach)(struct trusty_ipc_dev* dev);
+    int (*exec)(struct trusty_ipc_dev* dev, size_t cmd_size, bool fast);
+    void (*idle)(struct trusty_ipc_dev* dev, bool event_poll);
+};
+
 /*
  * Trusty IPC device
  *
- * @buf_vaddr: virtual address of shared buffer associated with device
- * @buf_size:  size of shared buffer
- * @buf_ns:    physical address info of shared buffer
- * @tdev:      trusty device
+ * @buf_vaddr:      virtual address of shared buffer associated with device
+ * @buf_size:       size of shared buffer
+ * @buf_id:         id of shared buffer returned by the secure side
+ * @buf_ns:         physical address info of shared buffer
+ * @tdev:           trusty device, may be NULL if not used by @ops
+ * @ops:            transport used to reach the secure side
+ * @transport_priv: private data of @ops
+ * @recorder:       optional, see trusty/trusty_ipc_record.h
+ * @api_version:    API version negotiated with the secure side, see
+ *                  SMC_FC_API_VERSION
+ * @unsupported:    bitmask of (1 << QL_TIPC_DEV_*) commands the secure side
+ *                  has rejected as not supported, or does not implement at
+ *                  @api_version
  */
 struct trusty_ipc_dev {
     void* buf_vaddr;
@@ -107,6 +139,11 @@ struct trusty_ipc_dev {
     trusty_shared_mem_id_t buf_id;
     struct ns_mem_page_info buf_ns;
     struct trusty_dev* tdev;
+    const struct trusty_ipc_transport_ops* ops;
+    void* transport_priv;
+    struct trusty_ipc_recorder* recorder;
+    uint32_t api_version;
+    uint32_t unsupported;
 };
 
 /*
@@ -121,6 +158,25 @@ struct trusty_ipc_ops {
     int (*on_disconnect)(struct trusty_ipc_chan* chan);
 };
 
+/*
+ * Bounded queue of messages that could not be sent yet because the queue of
+ * the peer was full. Messages are stored back to back in caller provided
+ * memory, each preceded by its length as a uint32_t.
+ *
+ * @buf:   storage, provided by the caller
+ * @size:  size of @buf
+ * @head:  offset of the first queued message in @buf
+ * @tail:  offset of the end of the last queued message in @buf
+ * @count: number of queued messages
+ */
+struct trusty_ipc_sendq {
+    uint8_t* buf;
+    size_t size;
+    size_t head;
+    size_t tail;
+    size_t count;
+};
+
 /*
  * Trusty IPC channel.
  *
@@ -130,6 +186,12 @@ struct trusty_ipc_ops {
  * @dev:      Trusty IPC device used by channel, initialized with
               trusty_ipc_dev_create
  * @ops:      callbacks for Trusty events
+ * @pending:  IPC_HANDLE_POLL_* events seen but not yet acted upon:
+ *            IPC_HANDLE_POLL_MSG if a message is known to be queued without
+ *            having been waited for, see trusty_ipc_connect_with_msg, and
+ *            IPC_HANDLE_POLL_SEND_UNBLOCKED
+ * @sendq:    optional queue for messages the peer cannot take yet, see
+ *            trusty_ipc_chan_set_sendq
  */
 struct trusty_ipc_chan {
     void* ops_ctx;
@@ -137,6 +199,8 @@ struct trusty_ipc_chan {
     volatile int complete;
     struct trusty_ipc_dev* dev;
     struct trusty_ipc_ops* ops;
+    uint32_t pending;
+    struct trusty_ipc_sendq* sendq;
 };
 
 /*
@@ -151,8 +215,25 @@ int trusty_ipc_dev_create(struct trusty_ipc_dev** ipc_dev,
                           struct trusty_dev* tdev,
                           size_t shared_buf_size);
 /*
- * Shutdown @dev. Frees shared buffer, and calls trusty_dev_shutdown_ipc
- * to shutdown on the secure side.
+ * Creates new Trusty IPC device that reaches the secure side through @ops
+ * instead of SMCs. Allocates shared buffer and calls @ops->attach. Returns a
+ * trusty_err.
+ *
+ * @ipc_dev:         new Trusty IPC device to be initialized
+ * @tdev:            associated Trusty device, may be NULL if unused by @ops
+ * @shared_buf_size: size of shared buffer to be allocated
+ * @ops:             transport operations
+ * @transport_priv:  private data for @ops, stored in @ipc_dev
+ */
+int trusty_ipc_dev_create_with_transport(
+        struct trusty_ipc_dev** ipc_dev,
+        struct trusty_dev* tdev,
+        size_t shared_buf_size,
+        const struct trusty_ipc_transport_ops* ops,
+        void* transport_priv);
+/*
+ * Shutdown @dev. Detaches the transport, which shuts down the device on the
+ * secure side, and frees shared buffer.
  */
 void trusty_ipc_dev_shutdown(struct trusty_ipc_dev* dev);
 
@@ -167,6 +248,33 @@ void trusty_ipc_dev_shutdown(struct trusty_ipc_dev* dev);
 int trusty_ipc_dev_connect(struct trusty_ipc_dev* dev,
                            const char* port,
                            uint64_t cookie);
+/*
+ * Calls into secure OS to initiate a new connection to a Trusty IPC service
+ * and to send the first message on it once it is accepted. Returns handle for
+ * the new channel, TRUSTY_ERR_NOT_SUPPORTED if the secure OS predates this
+ * command, or another trusty_err on error.
+ *
+ * @dev:      Trusty IPC device initialized with trusty_ipc_dev_create
+ * @port:     name of port to connect to on secure side
+ * @cookie:   cookie associated with new channel.
+ * @iovs:     first message
+ * @iovs_cnt: number of iovecs in first message
+ * @event:    set to the IPC_HANDLE_POLL_* events of the new channel that
+ *            are already known. A reported IPC_HANDLE_POLL_READY will not be
+ *            reported again by trusty_ipc_dev_get_event.
+ */
+int trusty_ipc_dev_connect_with_msg(struct trusty_ipc_dev* dev,
+                                    const char* port,
+                                    uint64_t cookie,
+                                    const struct trusty_ipc_iovec* iovs,
+                                    size_t iovs_cnt,
+                                    uint32_t* event);
+/*
+ * Returns false if @dev is known not to support
+ * trusty_ipc_dev_connect_with_msg, because of the negotiated API version or
+ * because the secure OS has rejected it.
+ */
+bool trusty_ipc_dev_has_connect_with_msg(struct trusty_ipc_dev* dev);
 /*
  * Calls into secure OS to close connection to Trusty IPC service.
  * Returns a trusty_err.
@@ -219,14 +327,121 @@ int trusty_ipc_dev_recv(struct trusty_ipc_dev* dev,
                         handle_t chan,
                         const struct trusty_ipc_iovec* iovs,
                         size_t iovs_cnt);
+/*
+ * Like trusty_ipc_dev_recv, but leaves the message in the shared buffer and
+ * points @msg at it instead of copying it out. The message starts at
+ * trusty_ipc_dev_send_buf, so a reply can be built in place on top of it. It
+ * is valid until the next call into the secure OS through @dev. Returns the
+ * message length on success, trusty_err on failure.
+ *
+ * @dev:  Trusty IPC device
+ * @chan: handle for connection
+ * @msg:  set to the received message
+ */
+int trusty_ipc_dev_recv_borrow(struct trusty_ipc_dev* dev,
+                               handle_t chan,
+                               void** msg);
+/*
+ * Returns where trusty_ipc_dev_send_in_place takes the message from, in the
+ * shared buffer of @dev. trusty_ipc_dev_max_msg_size bytes are available.
+ */
+void* trusty_ipc_dev_send_buf(struct trusty_ipc_dev* dev);
+/*
+ * Calls into secure OS to send the first @msg_size bytes at
+ * trusty_ipc_dev_send_buf as a message to channel, without copying them.
+ * Returns a trusty_err.
+ *
+ * @dev:      Trusty IPC device
+ * @chan:     handle for connection
+ * @msg_size: size of the message
+ */
+int trusty_ipc_dev_send_in_place(struct trusty_ipc_dev* dev,
+                                 handle_t chan,
+                                 size_t msg_size);
+
+/*
+ * Calls into secure OS to get the size of the next message on channel
+ * without receiving it. Returns the size, TRUSTY_ERR_NOT_SUPPORTED if the
+ * secure OS predates partial receives, or another trusty_err on failure.
+ *
+ * @dev:  Trusty IPC device
+ * @chan: handle for connection
+ */
+int trusty_ipc_dev_peek_msg_size(struct trusty_ipc_dev* dev, handle_t chan);
+/*
+ * Returns false if @dev is known not to support partial receives, because of
+ * the negotiated API version or because the secure OS has rejected them.
+ */
+bool trusty_ipc_dev_has_recv_partial(struct trusty_ipc_dev* dev);
+/*
+ * Calls into secure OS to receive the part of the next message on channel
+ * that starts at @offset. The message stays queued until a call copies its
+ * last byte, so a large message can be read in several calls into a small
+ * buffer. Returns the number of bytes received, which may be less than the
+ * size of @iovs if the shared buffer is smaller, or a trusty_err on failure.
+ * TRUSTY_ERR_NOT_SUPPORTED means the secure OS predates partial receives and
+ * trusty_ipc_dev_recv must be used instead.
+ *
+ * @dev:      Trusty IPC device
+ * @chan:     handle for connection
+ * @offset:   offset into the message
+ * @iovs:     receive buffers
+ * @iovs_cnt: number of iovecs
+ * @msg_len:  optional, set to the size of the whole message
+ */
+int trusty_ipc_dev_recv_at(struct trusty_ipc_dev* dev,
+                           handle_t chan,
+                           size_t offset,
+                           const struct trusty_ipc_iovec* iovs,
+                           size_t iovs_cnt,
+                           size_t* msg_len);
+
+/*
+ * Returns the size of the largest message that can be sent or received
+ * through @dev in one piece.
+ */
+size_t trusty_ipc_dev_max_msg_size(struct trusty_ipc_dev* dev);
 
 void trusty_ipc_dev_idle(struct trusty_ipc_dev* dev, bool event_poll);
 
+/*
+ * Gathers @iovs into @buf, up to @buf_len bytes. Returns the number of bytes
+ * copied.
+ */
+size_t trusty_ipc_iovec_to_buf(void* buf,
+                               size_t buf_len,
+                               const struct trusty_ipc_iovec* iovs,
+                               size_t iovs_cnt);
+/*
+ * Scatters @buf_len bytes at @buf into @iovs. Returns the number of bytes
+ * copied, which is less than @buf_len if @iovs are too small.
+ */
+size_t trusty_ipc_buf_to_iovec(const struct trusty_ipc_iovec* iovs,
+                               size_t iovs_cnt,
+                               const void* buf,
+                               size_t buf_len);
+
 /*
  * Initializes @chan with default values and @dev.
  */
 void trusty_ipc_chan_init(struct trusty_ipc_chan* chan,
                           struct trusty_ipc_dev* dev);
+/*
+ * Gives @chan a send queue of @buf_size bytes at @buf, both owned by the
+ * caller. Messages that trusty_ipc_send cannot send because the queue of the
+ * peer is full are then copied into @sendq and sent from the
+ * IPC_HANDLE_POLL_SEND_UNBLOCKED handler, or by trusty_ipc_flush, in order.
+ * Only channels using the default synchronous ops flush from the handler.
+ *
+ * @chan:     channel initialized with trusty_ipc_chan_init
+ * @sendq:    queue to initialize and attach
+ * @buf:      storage for queued messages and their lengths
+ * @buf_size: size of @buf
+ */
+void trusty_ipc_chan_set_sendq(struct trusty_ipc_chan* chan,
+                               struct trusty_ipc_sendq* sendq,
+                               void* buf,
+                               size_t buf_size);
 /*
  * Calls trusty_ipc_dev_connect to get a handle for channel.
  * Returns a trusty_err.
@@ -240,7 +455,26 @@ int trusty_ipc_connect(struct trusty_ipc_chan* chan,
                        const char* port,
                        bool wait);
 /*
- * Calls trusty_ipc_dev_close and invalidates @chan. Returns a trusty_err.
+ * Like trusty_ipc_connect with @wait set, but also sends the first message on
+ * the channel. Uses trusty_ipc_dev_connect_with_msg, which saves the round
+ * trips to wait for the connection and to send, if the secure OS supports it.
+ * Otherwise falls back to trusty_ipc_connect and trusty_ipc_send. If the reply
+ * is already readable, a following trusty_ipc_recv does not wait. Returns
+ * TRUSTY_ERR_NONE once the connection is complete and the message sent, or
+ * another trusty_err on error.
+ *
+ * @chan:     channel to initialize with new handle
+ * @port:     name of port to connect to on secure side
+ * @iovs:     first message
+ * @iovs_cnt: number of iovecs in first message
+ */
+int trusty_ipc_connect_with_msg(struct trusty_ipc_chan* chan,
+                                const char* port,
+                                const struct trusty_ipc_iovec* iovs,
+                                size_t iovs_cnt);
+/*
+ * Calls trusty_ipc_dev_close and invalidates @chan. Messages left in the send
+ * queue are dropped. Returns a trusty_err.
  */
 int trusty_ipc_close(struct trusty_ipc_chan* chan);
 /*
@@ -251,6 +485,10 @@ int trusty_ipc_poll_for_event(struct trusty_ipc_dev* dev);
 /*
  * Calls trusty_ipc_dev_send to send a message. Returns a trusty_err.
  *
+ * If @chan has a send queue, a message the peer cannot take yet, or that
+ * would overtake queued ones, is queued instead and TRUSTY_ERR_NONE returned.
+ * Only when the send queue is full as well does @wait apply.
+ *
  * @chan:     handle for connection
  * @iovs:     contains messages to be sent
  * @iovs_cnt: number of iovecs to be sent
@@ -260,6 +498,15 @@ int trusty_ipc_send(struct trusty_ipc_chan* chan,
                     const struct trusty_ipc_iovec* iovs,
                     size_t iovs_cnt,
                     bool wait);
+/*
+ * Sends the messages in the send queue of @chan. Returns TRUSTY_ERR_NONE once
+ * the queue is empty, TRUSTY_ERR_SEND_BLOCKED if messages remain and @wait is
+ * not set, or another trusty_err on failure.
+ *
+ * @chan: handle for connection
+ * @wait: flag to wait until all messages are sent
+ */
+int trusty_ipc_flush(struct trusty_ipc_chan* chan, bool wait);
 /*
  * Calls trusty_ipc_dev_recv to receive a message. Return number of bytes
  * received on success, trusty_err on failure.
@@ -273,5 +520,54 @@ int trusty_ipc_recv(struct trusty_ipc_chan* chan,
                     const struct trusty_ipc_iovec* iovs,
                     size_t iovs_cnt,
                     bool wait);
+/*
+ * Calls trusty_ipc_dev_recv_borrow to receive a message without copying it.
+ * Return number of bytes received on success, trusty_err on failure.
+ *
+ * @chan: handle for connection
+ * @msg:  set to the message in the shared buffer, see
+ *        trusty_ipc_dev_recv_borrow
+ * @wait: flag to wait for a message to receive
+ */
+int trusty_ipc_recv_borrow(struct trusty_ipc_chan* chan,
+                           void** msg,
+                           bool wait);
+/*
+ * Calls trusty_ipc_dev_send_in_place to send the message built at
+ * trusty_ipc_dev_send_buf of the device of @chan. Returns a trusty_err.
+ *
+ * If @chan has a send queue holding messages, the message is queued behind
+ * them. Otherwise a message the peer cannot take yet is lost and
+ * TRUSTY_ERR_SEND_BLOCKED returned, as waiting would overwrite it.
+ *
+ * @chan:     handle for connection
+ * @msg_size: size of the message
+ */
+int trusty_ipc_send_in_place(struct trusty_ipc_chan* chan, size_t msg_size);
+/*
+ * Calls trusty_ipc_dev_peek_msg_size to get the size of the next message
+ * without receiving it. Returns the size on success, trusty_err on failure.
+ *
+ * @chan: handle for connection
+ * @wait: flag to wait for a message to arrive
+ */
+int trusty_ipc_peek_msg_size(struct trusty_ipc_chan* chan, bool wait);
+/*
+ * Calls trusty_ipc_dev_recv_at to receive part of the next message. Returns
+ * number of bytes received on success, trusty_err on failure. Callers
+ * typically wait with trusty_ipc_peek_msg_size first, then call this with
+ * increasing @offset until @msg_len bytes have been received.
+ *
+ * @chan:     handle for connection
+ * @offset:   offset into the message
+ * @iovs:     receive buffers
+ * @iovs_cnt: number of iovecs
+ * @msg_len:  optional, set to the size of the whole message
+ */
+int trusty_ipc_recv_at(struct trusty_ipc_chan* chan,
+                       size_t offset,
+                       const struct trusty_ipc_iovec* iovs,
+                       size_t iovs_cnt,
+                       size_t* msg_len);
 
 #endif /* TRUSTY_TRUSTY_IPC_H_ */
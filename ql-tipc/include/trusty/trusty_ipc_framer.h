@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TRUSTY_TRUSTY_IPC_FRAMER_H_
+#define TRUSTY_TRUSTY_IPC_FRAMER_H_
+
+#include <trusty/sysdeps.h>
+#include <trusty/trusty_ipc.h>
+
+/*
+ * Maximum number of caller iovecs a framer can scatter one message into
+ * or gather it from
+ */
+#define TRUSTY_IPC_FRAMER_MAX_IOVS 8
+
+/*
+ * Reader and writer for messages that are split into frames, such as the
+ * keymaster responses. Each frame is one Trusty IPC message made of a fixed
+ * size header followed by the next chunk of the payload. The first 32-bit
+ * word of the header of the last frame has @stop_bit set.
+ *
+ * Payloads are scattered into, or gathered from, caller iovecs directly, so
+ * frames are never staged in an intermediate buffer.
+ *
+ * @chan:       channel the frames are exchanged on
+ * @hdr:        frame header, written before each frame is sent and
+ *              overwritten with the header of each frame received
+ * @hdr_len:    size of @hdr, at least 4
+ * @stop_bit:   bit marking the last frame
+ * @frame_size: maximum size of a frame, including the header
+ * @check:      optional, validates the header of a received frame of
+ *              @frame_len bytes. Returns @frame_len, or negative on error.
+ * @priv:       private data of @check
+ */
+struct trusty_ipc_framer {
+    struct trusty_ipc_chan* chan;
+    void* hdr;
+    size_t hdr_len;
+    uint32_t stop_bit;
+    size_t frame_size;
+    int (*check)(struct trusty_ipc_framer* framer, size_t frame_len);
+    void* priv;
+};
+
+/*
+ * Initializes @framer for @chan. Frames are limited to @max_frame_size bytes,
+ * or to the largest message the Trusty IPC device of @chan can carry if that
+ * is smaller or @max_frame_size is 0.
+ */
+void trusty_ipc_framer_init(struct trusty_ipc_framer* framer,
+                            struct trusty_ipc_chan* chan,
+                            void* hdr,
+                            size_t hdr_len,
+                            uint32_t stop_bit,
+                            size_t max_frame_size);
+
+/*
+ * Receives frames into @iovs until a frame with the stop bit arrives or
+ * @iovs are full. Returns the number of payload bytes received, or a
+ * trusty_err on failure. A frame that does not fit into what is left of
+ * @iovs fails with TRUSTY_ERR_MSG_TOO_BIG.
+ *
+ * @framer:   framer initialized with trusty_ipc_framer_init
+ * @iovs:     buffers for the payload, filled in order across frames
+ * @iovs_cnt: number of iovecs, at most TRUSTY_IPC_FRAMER_MAX_IOVS
+ * @wait:     flag to wait for each frame to arrive
+ */
+int trusty_ipc_framer_recv(struct trusty_ipc_framer* framer,
+                           const struct trusty_ipc_iovec* iovs,
+                           size_t iovs_cnt,
+                           bool wait);
+
+/*
+ * Sends the payload in @iovs as frames of at most frame_size bytes, with
+ * the stop bit set in the last one only. @framer->hdr is restored
+ * afterwards. Returns a trusty_err.
+ *
+ * @framer:   framer initialized with trusty_ipc_framer_init
+ * @iovs:     payload
+ * @iovs_cnt: number of iovecs, at most TRUSTY_IPC_FRAMER_MAX_IOVS
+ * @wait:     flag to wait for each send to complete
+ */
+int trusty_ipc_framer_send(struct trusty_ipc_framer* framer,
+                           const struct trusty_ipc_iovec* iovs,
+                           size_t iovs_cnt,
+                           bool wait);
+
+#endif /* TRUSTY_TRUSTY_IPC_FRAMER_H_ */
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TRUSTY_TRUSTY_IPC_LOOPBACK_H_
+#define TRUSTY_TRUSTY_IPC_LOOPBACK_H_
+
+#include <trusty/sysdeps.h>
+#include <trusty/trusty_ipc.h>
+
+/*
+ * In-process loopback transport for Trusty IPC devices. Instead of entering
+ * the secure OS, each command is handed to a handler that runs in the same
+ * address space and plays the secure side. This allows the client libraries
+ * to be run and benchmarked on a host without secure hardware.
+ *
+ * @create:      optional, called when the device is created with the shared
+ *               buffer at @buf of @buf_size bytes. Returns negative on error.
+ * @shutdown:    optional, called when the device is shut down
+ * @handle_cmd:  executes the queueless IPC command of @cmd_size bytes at the
+ *               start of @buf and writes the response back into @buf. @fast
+ *               is set for commands that would have been issued as fast
+ *               calls. Returns negative on error.
+ * @priv:        private data of the handler
+ * @api_version: optional, API version the handler implements if not
+ *               TRUSTY_API_VERSION_CURRENT, see SMC_FC_API_VERSION
+ */
+struct trusty_ipc_loopback {
+    int (*create)(struct trusty_ipc_loopback* lb, void* buf, size_t buf_size);
+    void (*shutdown)(struct trusty_ipc_loopback* lb);
+    int (*handle_cmd)(struct trusty_ipc_loopback* lb,
+                      void* buf,
+                      size_t buf_size,
+                      size_t cmd_size,
+                      bool fast);
+    void* priv;
+    uint32_t api_version;
+};
+
+/*
+ * Creates new Trusty IPC device backed by @lb. @lb must stay valid until the
+ * device is shut down with trusty_ipc_dev_shutdown. Returns a trusty_err.
+ *
+ * @ipc_dev:         new Trusty IPC device to be initialized
+ * @lb:              loopback handler playing the secure side
+ * @shared_buf_size: size of shared buffer to be allocated
+ */
+int trusty_ipc_loopback_dev_create(struct trusty_ipc_dev** ipc_dev,
+                                   struct trusty_ipc_loopback* lb,
+                                   size_t shared_buf_size);
+
+#endif /* TRUSTY_TRUSTY_IPC_LOOPBACK_H_ */
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TRUSTY_TRUSTY_IPC_RECORD_H_
+#define TRUSTY_TRUSTY_IPC_RECORD_H_
+
+#include <trusty/sysdeps.h>
+#include <trusty/trusty_ipc.h>
+#include <trusty/trusty_ipc_loopback.h>
+
+/*
+ * Recording of the command stream of a Trusty IPC device.
+ *
+ * A recording starts with a struct trusty_ipc_record_file_hdr and is
+ * followed by one record per command and one per response, in the order
+ * they crossed the shared buffer. Each record is a struct
+ * trusty_ipc_record_hdr followed by @size bytes copied from the start of the
+ * shared buffer. All fields are in the byte order of the recording cpu.
+ */
+
+#define TRUSTY_IPC_RECORD_MAGIC 0x43524c51 /* "QLRC" */
+#define TRUSTY_IPC_RECORD_VERSION 1
+
+enum trusty_ipc_record_type {
+    TRUSTY_IPC_RECORD_CMD = 1,
+    TRUSTY_IPC_RECORD_RESP = 2,
+};
+
+/**
+ * struct trusty_ipc_record_file_hdr - header of a recording
+ * @magic:    TRUSTY_IPC_RECORD_MAGIC
+ * @version:  TRUSTY_IPC_RECORD_VERSION
+ * @buf_size: size of the shared buffer of the recorded device
+ * @reserved: must be 0
+ */
+struct trusty_ipc_record_file_hdr {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t buf_size;
+    uint32_t reserved;
+};
+
+/**
+ * struct trusty_ipc_record_hdr - header of a single record
+ * @type:      one of enum trusty_ipc_record_type
+ * @fast:      nonzero if the command was issued as a fast call
+ * @reserved:  must be 0
+ * @size:      number of bytes of shared buffer following this header
+ * @result:    return value of the transport, responses only
+ * @timestamp: value of trusty_ipc_recorder.now when the record was taken
+ */
+struct trusty_ipc_record_hdr {
+    uint8_t type;
+    uint8_t fast;
+    uint16_t reserved;
+    uint32_t size;
+    int32_t result;
+    uint32_t reserved2;
+    uint64_t timestamp;
+};
+
+/**
+ * struct trusty_ipc_recorder - sink for a recording
+ * @write: appends @size bytes at @data to the recording
+ * @now:   optional, returns a timestamp in a unit chosen by the caller
+ * @priv:  private data of the sink
+ */
+struct trusty_ipc_recorder {
+    void (*write)(struct trusty_ipc_recorder* rec,
+                  const void* data,
+                  size_t size);
+    uint64_t (*now)(struct trusty_ipc_recorder* rec);
+    void* priv;
+};
+
+/*
+ * Starts recording every command executed on @dev, and its response, to
+ * @rec. Writes the recording header immediately. Pass NULL to stop recording.
+ * @rec must stay valid while it is attached.
+ */
+void trusty_ipc_dev_set_recorder(struct trusty_ipc_dev* dev,
+                                 struct trusty_ipc_recorder* rec);
+
+#define TRUSTY_IPC_REPLAY_MAX_COOKIES 16
+
+/**
+ * struct trusty_ipc_replay - plays back a recording as the secure side
+ * @lb:          loopback handler, pass to trusty_ipc_loopback_dev_create
+ * @data:        recording
+ * @size:        size of @data
+ * @pos:         offset of the next record in @data
+ * @cmds:        commands replayed since the last rewind
+ * @mismatches:  commands that did not match the recording
+ * @strict:      fail commands that do not match the recording instead of
+ *               just counting them
+ * @cookies:     cookies of the recorded connects, in order
+ * @live:        cookies of the replayed connects, in order
+ * @num_cookies: number of valid entries in @cookies and @live
+ *
+ * Channel cookies are usually pointers and differ between runs. Connect
+ * commands are therefore compared without their cookie, and cookies in
+ * replayed events are translated to the ones of the replaying client.
+ */
+struct trusty_ipc_replay {
+    struct trusty_ipc_loopback lb;
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    size_t cmds;
+    size_t mismatches;
+    bool strict;
+    uint64_t cookies[TRUSTY_IPC_REPLAY_MAX_COOKIES];
+    uint64_t live[TRUSTY_IPC_REPLAY_MAX_COOKIES];
+    size_t num_cookies;
+};
+
+/*
+ * Initializes @replay to play back the recording of @size bytes at @data.
+ * @data must stay valid while @replay is used. Returns a trusty_err.
+ */
+int trusty_ipc_replay_init(struct trusty_ipc_replay* replay,
+                           const void* data,
+                           size_t size);
+
+/*
+ * Restarts @replay from the first record and clears its counters.
+ */
+void trusty_ipc_replay_rewind(struct trusty_ipc_replay* replay);
+
+#endif /* TRUSTY_TRUSTY_IPC_RECORD_H_ */
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TRUSTY_TRUSTY_IPC_SCHEMA_H_
+#define TRUSTY_TRUSTY_IPC_SCHEMA_H_
+
+#include <trusty/sysdeps.h>
+#include <trusty/trusty_ipc.h>
+
+/*
+ * Declarative description of a message wire format. A schema is a list of
+ * fields, each bound to a member of a C structure, that are laid out on the
+ * wire in order with no padding. From it the message can be sized, encoded
+ * into a buffer, described as iovecs without copying, and decoded with bounds
+ * checks, pointing variable sized fields into the received message.
+ *
+ * Field types:
+ * @TRUSTY_IPC_SCHEMA_U32:   32-bit integer
+ * @TRUSTY_IPC_SCHEMA_U64:   64-bit integer
+ * @TRUSTY_IPC_SCHEMA_BYTES: byte array of fixed size, inline in the structure
+ * @TRUSTY_IPC_SCHEMA_BLOB:  32-bit length followed by that many bytes. The
+ *                           length is a uint32_t member, the data is
+ *                           referenced by a const uint8_t* member.
+ * @TRUSTY_IPC_SCHEMA_TAIL:  like BLOB without the length on the wire, takes
+ *                           up the rest of the message. Must be last.
+ */
+enum trusty_ipc_schema_type {
+    TRUSTY_IPC_SCHEMA_U32,
+    TRUSTY_IPC_SCHEMA_U64,
+    TRUSTY_IPC_SCHEMA_BYTES,
+    TRUSTY_IPC_SCHEMA_BLOB,
+    TRUSTY_IPC_SCHEMA_TAIL,
+};
+
+/*
+ * @type:   one of trusty_ipc_schema_type
+ * @offset: offset of the member holding the value, or the data pointer of
+ *          BLOB and TAIL fields
+ * @arg:    size of BYTES fields, offset of the uint32_t length member of BLOB
+ *          and TAIL fields
+ */
+struct trusty_ipc_schema_field {
+    uint16_t type;
+    uint16_t offset;
+    uint16_t arg;
+};
+
+struct trusty_ipc_schema {
+    const struct trusty_ipc_schema_field* fields;
+    size_t num_fields;
+};
+
+#define TRUSTY_IPC_SCHEMA_FIELD_U32(type, member) \
+    {TRUSTY_IPC_SCHEMA_U32, offsetof(type, member), 0}
+#define TRUSTY_IPC_SCHEMA_FIELD_U64(type, member) \
+    {TRUSTY_IPC_SCHEMA_U64, offsetof(type, member), 0}
+#define TRUSTY_IPC_SCHEMA_FIELD_BYTES(type, member)     \
+    {TRUSTY_IPC_SCHEMA_BYTES, offsetof(type, member), \
+     sizeof(((type*)0)->member)}
+#define TRUSTY_IPC_SCHEMA_FIELD_BLOB(type, data, size) \
+    {TRUSTY_IPC_SCHEMA_BLOB, offsetof(type, data), offsetof(type, size)}
+#define TRUSTY_IPC_SCHEMA_FIELD_TAIL(type, data, size) \
+    {TRUSTY_IPC_SCHEMA_TAIL, offsetof(type, data), offsetof(type, size)}
+
+/*
+ * Initializer for a schema made of the field array @field_array, e.g.
+ *
+ * static const struct trusty_ipc_schema_field foo_fields[] = {
+ *         TRUSTY_IPC_SCHEMA_FIELD_U32(struct foo, bar),
+ *         TRUSTY_IPC_SCHEMA_FIELD_BLOB(struct foo, data, data_size),
+ * };
+ * const struct trusty_ipc_schema foo_schema = TRUSTY_IPC_SCHEMA(foo_fields);
+ */
+#define TRUSTY_IPC_SCHEMA(field_array) \
+    {.fields = (field_array),          \
+     .num_fields = sizeof(field_array) / sizeof((field_array)[0])}
+
+/*
+ * Returns the number of bytes @obj takes up on the wire.
+ */
+size_t trusty_ipc_schema_size(const struct trusty_ipc_schema* schema,
+                              const void* obj);
+
+/*
+ * Writes @obj to @buf in one pass. Returns the number of bytes written, or
+ * TRUSTY_ERR_MSG_TOO_BIG if it does not fit in @buf_size bytes.
+ */
+int trusty_ipc_schema_encode(const struct trusty_ipc_schema* schema,
+                             const void* obj,
+                             void* buf,
+                             size_t buf_size);
+
+/*
+ * Describes @obj on the wire as iovecs pointing into @obj and the buffers it
+ * references, without copying. Fields that are adjacent in memory share an
+ * iovec and empty buffers are left out. @obj and its buffers must stay valid
+ * until the iovecs have been sent. Returns the number of iovecs used, or
+ * TRUSTY_ERR_INVALID_ARGS if @iovs_cnt is too small.
+ */
+int trusty_ipc_schema_to_iovecs(const struct trusty_ipc_schema* schema,
+                                const void* obj,
+                                struct trusty_ipc_iovec* iovs,
+                                size_t iovs_cnt);
+
+/*
+ * Decodes the @len byte message at @buf into @obj. Integer and fixed size
+ * fields are copied, BLOB and TAIL fields are pointed into @buf, which must
+ * stay valid for as long as they are used. Fails with TRUSTY_ERR_GENERIC
+ * unless the message is exactly as long as the fields it describes.
+ */
+int trusty_ipc_schema_decode(const struct trusty_ipc_schema* schema,
+                             void* obj,
+                             const void* buf,
+                             size_t len);
+
+#endif /* TRUSTY_TRUSTY_IPC_SCHEMA_H_ */
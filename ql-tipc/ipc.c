@@ -41,6 +41,23 @@ static int sync_ipc_on_message(struct trusty_ipc_chan* chan) {
     return TRUSTY_EVENT_HANDLED;
 }
 
+static int sendq_flush(struct trusty_ipc_chan* chan);
+
+static int sync_ipc_on_send_unblocked(struct trusty_ipc_chan* chan) {
+    int rc;
+
+    trusty_assert(chan);
+
+    chan->pending |= IPC_HANDLE_POLL_SEND_UNBLOCKED;
+    if (chan->sendq) {
+        rc = sendq_flush(chan);
+        if (rc < 0)
+            return rc;
+    }
+    /* let the other events of this round be handled too */
+    return TRUSTY_ERR_NONE;
+}
+
 static int sync_ipc_on_disconnect(struct trusty_ipc_chan* chan) {
     trusty_assert(chan);
 
@@ -74,8 +91,29 @@ static int wait_for_connect(struct trusty_ipc_chan* chan) {
 }
 
 static int wait_for_send(struct trusty_ipc_chan* chan) {
+    int rc;
+
     trusty_debug("%s: chan %d: waiting for send\n", __func__, chan->handle);
-    return wait_for_complete(chan);
+
+    chan->pending &= ~IPC_HANDLE_POLL_SEND_UNBLOCKED;
+    chan->complete = 0;
+    for (;;) {
+        rc = trusty_ipc_poll_for_event(chan->dev);
+        if (rc < 0)
+            return rc;
+
+        if (chan->pending & IPC_HANDLE_POLL_SEND_UNBLOCKED)
+            break;
+
+        if (chan->complete < 0)
+            return chan->complete;
+
+        if (rc == TRUSTY_EVENT_NONE && !trusty_ipc_dev_has_event(chan->dev, 0))
+            trusty_ipc_dev_idle(chan->dev, true);
+    }
+
+    chan->pending &= ~IPC_HANDLE_POLL_SEND_UNBLOCKED;
+    return TRUSTY_EVENT_HANDLED;
 }
 
 static int wait_for_reply(struct trusty_ipc_chan* chan) {
@@ -85,10 +123,76 @@ static int wait_for_reply(struct trusty_ipc_chan* chan) {
 
 static struct trusty_ipc_ops sync_ipc_ops = {
         .on_connect_complete = sync_ipc_on_connect_complete,
+        .on_send_unblocked = sync_ipc_on_send_unblocked,
         .on_message = sync_ipc_on_message,
         .on_disconnect = sync_ipc_on_disconnect,
 };
 
+/*
+ * Copies the message in @iovs to the end of @q. Returns TRUSTY_ERR_NONE,
+ * TRUSTY_ERR_SEND_BLOCKED if there is no room for it yet, or
+ * TRUSTY_ERR_MSG_TOO_BIG if it would never fit.
+ */
+static int sendq_put(struct trusty_ipc_sendq* q,
+                     const struct trusty_ipc_iovec* iovs,
+                     size_t iovs_cnt) {
+    size_t i;
+    uint32_t len32;
+    size_t len = 0;
+
+    for (i = 0; i < iovs_cnt; i++)
+        len += iovs[i].len;
+    if (len > UINT32_MAX || sizeof(len32) + len > q->size)
+        return TRUSTY_ERR_MSG_TOO_BIG;
+
+    if (sizeof(len32) + len > q->size - q->tail) {
+        if (sizeof(len32) + len > q->size - (q->tail - q->head))
+            return TRUSTY_ERR_SEND_BLOCKED;
+        /* move queued messages to the start, forwards as they overlap */
+        for (i = 0; i < q->tail - q->head; i++)
+            q->buf[i] = q->buf[q->head + i];
+        q->tail -= q->head;
+        q->head = 0;
+    }
+
+    len32 = (uint32_t)len;
+    trusty_memcpy(q->buf + q->tail, &len32, sizeof(len32));
+    q->tail += sizeof(len32);
+    q->tail += trusty_ipc_iovec_to_buf(q->buf + q->tail, len, iovs, iovs_cnt);
+    q->count++;
+    return TRUSTY_ERR_NONE;
+}
+
+/*
+ * Sends queued messages of @chan until the peer blocks or the queue is
+ * empty. Returns a trusty_err.
+ */
+static int sendq_flush(struct trusty_ipc_chan* chan) {
+    int rc;
+    uint32_t len32;
+    struct trusty_ipc_iovec iov;
+    struct trusty_ipc_sendq* q = chan->sendq;
+
+    while (q->count) {
+        trusty_memcpy(&len32, q->buf + q->head, sizeof(len32));
+        iov.base = q->buf + q->head + sizeof(len32);
+        iov.len = len32;
+        rc = trusty_ipc_dev_send(chan->dev, chan->handle, &iov, 1);
+        if (rc == TRUSTY_ERR_SEND_BLOCKED)
+            return TRUSTY_ERR_NONE;
+        if (rc < 0) {
+            trusty_error("%s: chan %d: send failed (%d)\n", __func__,
+                         chan->handle, rc);
+            return rc;
+        }
+        q->head += sizeof(len32) + len32;
+        q->count--;
+    }
+    q->head = 0;
+    q->tail = 0;
+    return TRUSTY_ERR_NONE;
+}
+
 void trusty_ipc_chan_init(struct trusty_ipc_chan* chan,
                           struct trusty_ipc_dev* dev) {
     trusty_assert(chan);
@@ -102,6 +206,20 @@ void trusty_ipc_chan_init(struct trusty_ipc_chan* chan,
     chan->ops_ctx = chan;
 }
 
+void trusty_ipc_chan_set_sendq(struct trusty_ipc_chan* chan,
+                               struct trusty_ipc_sendq* sendq,
+                               void* buf,
+                               size_t buf_size) {
+    trusty_assert(chan);
+    trusty_assert(sendq);
+    trusty_assert(buf || !buf_size);
+
+    trusty_memset(sendq, 0, sizeof(*sendq));
+    sendq->buf = buf;
+    sendq->size = buf_size;
+    chan->sendq = sendq;
+}
+
 int trusty_ipc_connect(struct trusty_ipc_chan* chan,
                        const char* port,
                        bool wait) {
@@ -132,6 +250,54 @@ int trusty_ipc_connect(struct trusty_ipc_chan* chan,
     return rc;
 }
 
+int trusty_ipc_connect_with_msg(struct trusty_ipc_chan* chan,
+                                const char* port,
+                                const struct trusty_ipc_iovec* iovs,
+                                size_t iovs_cnt) {
+    int rc;
+    uint32_t event = 0;
+
+    trusty_assert(chan);
+    trusty_assert(chan->dev);
+    trusty_assert(chan->handle == INVALID_IPC_HANDLE);
+    trusty_assert(port);
+
+    rc = trusty_ipc_dev_connect_with_msg(chan->dev, port,
+                                         (uint64_t)(uintptr_t)chan, iovs,
+                                         iovs_cnt, &event);
+    if (rc == TRUSTY_ERR_NOT_SUPPORTED) {
+        /* a message can only be sent once the connection is complete */
+        rc = trusty_ipc_connect(chan, port, true);
+        if (rc < 0)
+            return rc;
+        rc = trusty_ipc_send(chan, iovs, iovs_cnt, true);
+        if (rc < 0) {
+            trusty_error("%s: send failed (%d)\n", __func__, rc);
+            trusty_ipc_close(chan);
+            return rc;
+        }
+        return TRUSTY_ERR_NONE;
+    }
+    if (rc < 0) {
+        trusty_error("%s: init connection failed (%d)\n", __func__, rc);
+        return rc;
+    }
+    chan->handle = (handle_t)rc;
+    chan->pending = event & IPC_HANDLE_POLL_MSG;
+    trusty_debug("chan->handle: %x, event: %x\n", (int)chan->handle, event);
+
+    if (!(event & IPC_HANDLE_POLL_READY)) {
+        rc = wait_for_connect(chan);
+        if (rc < 0) {
+            trusty_error("%s: wait for connect failed (%d)\n", __func__, rc);
+            trusty_ipc_close(chan);
+            return rc;
+        }
+    }
+
+    return TRUSTY_ERR_NONE;
+}
+
 int trusty_ipc_close(struct trusty_ipc_chan* chan) {
     int rc;
 
@@ -139,6 +305,12 @@ int trusty_ipc_close(struct trusty_ipc_chan* chan) {
 
     rc = trusty_ipc_dev_close(chan->dev, chan->handle);
     chan->handle = INVALID_IPC_HANDLE;
+    chan->pending = 0;
+    if (chan->sendq) {
+        chan->sendq->head = 0;
+        chan->sendq->tail = 0;
+        chan->sendq->count = 0;
+    }
 
     return rc;
 }
@@ -154,7 +326,17 @@ int trusty_ipc_send(struct trusty_ipc_chan* chan,
     trusty_assert(chan->handle);
 
 Again:
-    rc = trusty_ipc_dev_send(chan->dev, chan->handle, iovs, iovs_cnt);
+    if (chan->sendq && chan->sendq->count) {
+        /* do not overtake queued messages */
+        rc = TRUSTY_ERR_SEND_BLOCKED;
+    } else {
+        rc = trusty_ipc_dev_send(chan->dev, chan->handle, iovs, iovs_cnt);
+    }
+    if (rc == TRUSTY_ERR_SEND_BLOCKED && chan->sendq) {
+        rc = sendq_put(chan->sendq, iovs, iovs_cnt);
+        if (rc != TRUSTY_ERR_SEND_BLOCKED)
+            return rc;
+    }
     if (rc == TRUSTY_ERR_SEND_BLOCKED) {
         if (wait) {
             rc = wait_for_send(chan);
@@ -168,6 +350,33 @@ Again:
     return rc;
 }
 
+int trusty_ipc_flush(struct trusty_ipc_chan* chan, bool wait) {
+    int rc;
+
+    trusty_assert(chan);
+    trusty_assert(chan->dev);
+
+    if (!chan->sendq)
+        return TRUSTY_ERR_NONE;
+
+    rc = sendq_flush(chan);
+    if (rc < 0)
+        return rc;
+
+    /* the send unblocked handler flushes the rest */
+    while (chan->sendq->count) {
+        if (!wait)
+            return TRUSTY_ERR_SEND_BLOCKED;
+
+        rc = wait_for_send(chan);
+        if (rc < 0) {
+            trusty_error("%s: wait to send failed (%d)\n", __func__, rc);
+            return rc;
+        }
+    }
+    return TRUSTY_ERR_NONE;
+}
+
 int trusty_ipc_recv(struct trusty_ipc_chan* chan,
                     const struct trusty_ipc_iovec* iovs,
                     size_t iovs_cnt,
@@ -177,7 +386,7 @@ int trusty_ipc_recv(struct trusty_ipc_chan* chan,
     trusty_assert(chan->dev);
     trusty_assert(chan->handle);
 
-    if (wait) {
+    if (wait && !(chan->pending & IPC_HANDLE_POLL_MSG)) {
         rc = wait_for_reply(chan);
         if (rc < 0) {
             trusty_error("%s: wait to reply failed (%d)\n", __func__, rc);
@@ -185,6 +394,7 @@ int trusty_ipc_recv(struct trusty_ipc_chan* chan,
         }
     }
 
+    chan->pending &= ~IPC_HANDLE_POLL_MSG;
     rc = trusty_ipc_dev_recv(chan->dev, chan->handle, iovs, iovs_cnt);
     if (rc < 0)
         trusty_error("%s: ipc recv failed (%d)\n", __func__, rc);
@@ -192,6 +402,93 @@ int trusty_ipc_recv(struct trusty_ipc_chan* chan,
     return rc;
 }
 
+int trusty_ipc_recv_borrow(struct trusty_ipc_chan* chan,
+                           void** msg,
+                           bool wait) {
+    int rc;
+    trusty_assert(chan);
+    trusty_assert(chan->dev);
+    trusty_assert(chan->handle);
+
+    if (wait && !(chan->pending & IPC_HANDLE_POLL_MSG)) {
+        rc = wait_for_reply(chan);
+        if (rc < 0) {
+            trusty_error("%s: wait to reply failed (%d)\n", __func__, rc);
+            return rc;
+        }
+    }
+
+    chan->pending &= ~IPC_HANDLE_POLL_MSG;
+    rc = trusty_ipc_dev_recv_borrow(chan->dev, chan->handle, msg);
+    if (rc < 0)
+        trusty_error("%s: ipc recv failed (%d)\n", __func__, rc);
+
+    return rc;
+}
+
+int trusty_ipc_send_in_place(struct trusty_ipc_chan* chan, size_t msg_size) {
+    struct trusty_ipc_iovec iov;
+
+    trusty_assert(chan);
+    trusty_assert(chan->dev);
+    trusty_assert(chan->handle);
+
+    if (chan->sendq && chan->sendq->count) {
+        /* do not overtake queued messages */
+        iov.base = trusty_ipc_dev_send_buf(chan->dev);
+        iov.len = msg_size;
+        return sendq_put(chan->sendq, &iov, 1);
+    }
+    return trusty_ipc_dev_send_in_place(chan->dev, chan->handle, msg_size);
+}
+
+int trusty_ipc_peek_msg_size(struct trusty_ipc_chan* chan, bool wait) {
+    int rc;
+    trusty_assert(chan);
+    trusty_assert(chan->dev);
+    trusty_assert(chan->handle);
+
+    if (wait && !(chan->pending & IPC_HANDLE_POLL_MSG)) {
+        rc = wait_for_reply(chan);
+        if (rc < 0) {
+            trusty_error("%s: wait to reply failed (%d)\n", __func__, rc);
+            return rc;
+        }
+    }
+
+    rc = trusty_ipc_dev_peek_msg_size(chan->dev, chan->handle);
+    if (rc < 0 && rc != TRUSTY_ERR_NOT_SUPPORTED)
+        trusty_error("%s: ipc peek failed (%d)\n", __func__, rc);
+
+    return rc;
+}
+
+int trusty_ipc_recv_at(struct trusty_ipc_chan* chan,
+                       size_t offset,
+                       const struct trusty_ipc_iovec* iovs,
+                       size_t iovs_cnt,
+                       size_t* msg_len) {
+    int rc;
+    size_t len;
+    trusty_assert(chan);
+    trusty_assert(chan->dev);
+    trusty_assert(chan->handle);
+
+    rc = trusty_ipc_dev_recv_at(chan->dev, chan->handle, offset, iovs,
+                                iovs_cnt, &len);
+    if (rc < 0) {
+        if (rc != TRUSTY_ERR_NOT_SUPPORTED)
+            trusty_error("%s: ipc recv failed (%d)\n", __func__, rc);
+        return rc;
+    }
+
+    if (offset + rc == len)
+        chan->pending &= ~IPC_HANDLE_POLL_MSG; /* message consumed */
+    if (msg_len)
+        *msg_len = len;
+    return rc;
+}
+
 int trusty_ipc_poll_for_event(struct trusty_ipc_dev* ipc_dev) {
     int rc;
     struct trusty_ipc_event evt;
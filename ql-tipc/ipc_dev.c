@@ -22,43 +22,18 @@
  * SOFTWARE.
  */
 
+#include <interface/ql_tipc/ql_tipc.h>
+#include <trusty/smcall.h>
 #include <trusty/trusty_dev.h>
 #include <trusty/trusty_ipc.h>
+#include <trusty/trusty_ipc_record.h>
 #include <trusty/trusty_mem.h>
 #include <trusty/util.h>
 
 #define NS_PTE_PHYSADDR(pte) ((pte)&0xFFFFFFFFF000ULL)
 
-#define QL_TIPC_DEV_RESP 0x8000
-#define QL_TIPC_DEV_CONNECT 0x1
-#define QL_TIPC_DEV_GET_EVENT 0x2
-#define QL_TIPC_DEV_SEND 0x3
-#define QL_TIPC_DEV_RECV 0x4
-#define QL_TIPC_DEV_DISCONNECT 0x5
-
-#define QL_TIPC_DEV_FC_HAS_EVENT 0x100
-
 #define LOCAL_LOG 0
 
-struct trusty_ipc_cmd_hdr {
-    uint16_t opcode;
-    uint16_t flags;
-    uint32_t status;
-    uint32_t handle;
-    uint32_t payload_len;
-    uint8_t payload[0];
-};
-
-struct trusty_ipc_wait_req {
-    uint64_t reserved;
-};
-
-struct trusty_ipc_connect_req {
-    uint64_t cookie;
-    uint64_t reserved;
-    uint8_t name[0];
-};
-
 static size_t iovec_size(const struct trusty_ipc_iovec* iovs, size_t iovs_cnt) {
     size_t i;
     size_t cb = 0;
@@ -72,70 +47,142 @@ static size_t iovec_size(const struct trusty_ipc_iovec* iovs, size_t iovs_cnt) {
     return cb;
 }
 
-static size_t iovec_to_buf(void* buf,
-                           size_t buf_len,
-                           const struct trusty_ipc_iovec* iovs,
-                           size_t iovs_cnt) {
-    size_t i;
-    size_t buf_pos = 0;
-
-    trusty_assert(iovs);
-
-    for (i = 0; i < iovs_cnt; i++) {
-        size_t to_copy = (size_t)iovs[i].len;
-
-        if (!to_copy)
-            continue;
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
 
-        if (to_copy > buf_len)
-            to_copy = buf_len;
-
-        trusty_memcpy((uint8_t*)buf + buf_pos, iovs[i].base, to_copy);
-
-        buf_pos += to_copy;
-        buf_len -= to_copy;
+/*
+ * Copies of at least IPC_COPY_BULK_MIN bytes use wide loads and stores:
+ * NEON registers where available, or machine words if TIPC_ENABLE_WORD_COPY
+ * is set. The latter only pays off on platforms where trusty_memcpy is a
+ * byte loop; an optimized trusty_memcpy is used as is.
+ */
+#define IPC_COPY_BULK_MIN 64
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define IPC_COPY_NEON 1
+#endif
+
+#ifdef TIPC_ENABLE_WORD_COPY
+typedef unsigned long __attribute__((__may_alias__)) ipc_word_t;
+#endif
+
+static void ipc_copy_bulk(uint8_t* d, const uint8_t* s, size_t len) {
+#ifdef IPC_COPY_NEON
+    /* NEON loads and stores do not need to be aligned */
+    for (; len >= 64; len -= 64, d += 64, s += 64) {
+        uint8x16_t v0 = vld1q_u8(s);
+        uint8x16_t v1 = vld1q_u8(s + 16);
+        uint8x16_t v2 = vld1q_u8(s + 32);
+        uint8x16_t v3 = vld1q_u8(s + 48);
+        vst1q_u8(d, v0);
+        vst1q_u8(d + 16, v1);
+        vst1q_u8(d + 32, v2);
+        vst1q_u8(d + 48, v3);
+    }
+    for (; len >= 16; len -= 16, d += 16, s += 16) {
+        vst1q_u8(d, vld1q_u8(s));
+    }
+#elif defined(TIPC_ENABLE_WORD_COPY)
+    const size_t word = sizeof(ipc_word_t);
 
-        if (buf_len == 0)
-            break;
+    if (((uintptr_t)d ^ (uintptr_t)s) & (word - 1)) {
+        /* can never be co-aligned */
+        trusty_memcpy(d, s, len);
+        return;
+    }
+    for (; (uintptr_t)d & (word - 1); len--) {
+        *d++ = *s++;
+    }
+    for (; len >= 4 * word; len -= 4 * word, d += 4 * word, s += 4 * word) {
+        ipc_word_t w0 = ((const ipc_word_t*)s)[0];
+        ipc_word_t w1 = ((const ipc_word_t*)s)[1];
+        ipc_word_t w2 = ((const ipc_word_t*)s)[2];
+        ipc_word_t w3 = ((const ipc_word_t*)s)[3];
+        ((ipc_word_t*)d)[0] = w0;
+        ((ipc_word_t*)d)[1] = w1;
+        ((ipc_word_t*)d)[2] = w2;
+        ((ipc_word_t*)d)[3] = w3;
+    }
+    for (; len >= word; len -= word, d += word, s += word) {
+        *(ipc_word_t*)d = *(const ipc_word_t*)s;
+    }
+#else
+    trusty_memcpy(d, s, len);
+    return;
+#endif
+    while (len--) {
+        *d++ = *s++;
     }
+}
 
-    return buf_pos;
+/*
+ * Copies @len bytes between an iovec and the shared buffer. Most iovecs are
+ * message headers of 4, 8 or 16 bytes, which are moved with a single fixed
+ * size copy. This keeps the cost independent of trusty_memcpy, which is a
+ * byte loop on some platforms.
+ */
+static inline void ipc_copy(void* dst, const void* src, size_t len) {
+    switch (len) {
+    case 0:
+        return;
+    case 4:
+        __builtin_memcpy(dst, src, 4);
+        return;
+    case 8:
+        __builtin_memcpy(dst, src, 8);
+        return;
+    case 16:
+        __builtin_memcpy(dst, src, 16);
+        return;
+    }
+    if (len < IPC_COPY_BULK_MIN) {
+        trusty_memcpy(dst, src, len);
+        return;
+    }
+    ipc_copy_bulk(dst, src, len);
 }
 
-static size_t buf_to_iovec(const struct trusty_ipc_iovec* iovs,
-                           size_t iovs_cnt,
-                           const void* buf,
-                           size_t buf_len) {
+size_t trusty_ipc_iovec_to_buf(void* buf,
+                               size_t buf_len,
+                               const struct trusty_ipc_iovec* iovs,
+                               size_t iovs_cnt) {
     size_t i;
-    size_t copied = 0;
-    const uint8_t* buf_ptr = buf;
-
-    trusty_assert(buf_ptr);
-    trusty_assert(iovs);
+    size_t to_copy;
+    uint8_t* pos = buf;
+    uint8_t* end = pos + buf_len;
 
-    if (iovs_cnt == 0 || buf_len == 0)
-        return 0;
-
-    for (i = 0; i < iovs_cnt; i++) {
-        size_t to_copy = buf_len;
+    trusty_assert(iovs || !iovs_cnt);
 
-        if (to_copy > iovs[i].len)
-            to_copy = iovs[i].len;
+    for (i = 0; i < iovs_cnt && pos != end; i++) {
+        to_copy = MIN(iovs[i].len, (size_t)(end - pos));
+        ipc_copy(pos, iovs[i].base, to_copy);
+        pos += to_copy;
+    }
 
-        if (!to_copy)
-            continue;
+    return pos - (uint8_t*)buf;
+}
 
-        trusty_memcpy(iovs[i].base, buf_ptr, to_copy);
+size_t trusty_ipc_buf_to_iovec(const struct trusty_ipc_iovec* iovs,
+                               size_t iovs_cnt,
+                               const void* buf,
+                               size_t buf_len) {
+    size_t i;
+    size_t to_copy;
+    const uint8_t* pos = buf;
+    const uint8_t* end = pos + buf_len;
 
-        copied += to_copy;
-        buf_ptr += to_copy;
-        buf_len -= to_copy;
+    trusty_assert(buf || !buf_len);
+    trusty_assert(iovs || !iovs_cnt);
 
-        if (buf_len == 0)
-            break;
+    for (i = 0; i < iovs_cnt && pos != end; i++) {
+        to_copy = MIN(iovs[i].len, (size_t)(end - pos));
+        ipc_copy(iovs[i].base, pos, to_copy);
+        pos += to_copy;
     }
 
-    return copied;
+    return pos - (const uint8_t*)buf;
 }
 
 static int check_response(struct trusty_ipc_dev* dev,
@@ -158,14 +205,156 @@ static int check_response(struct trusty_ipc_dev* dev,
     return TRUSTY_ERR_NONE;
 }
 
+static int smc_transport_attach(struct trusty_ipc_dev* dev) {
+    int rc;
+    int rc2;
+
+    /* Get memory attributes */
+    rc = trusty_encode_page_info(&dev->buf_ns, dev->buf_vaddr);
+    if (rc != 0) {
+        trusty_error("%s: failed to get shared memory attributes\n", __func__);
+        return TRUSTY_ERR_GENERIC;
+    }
+    /* call secure OS to register shared buffer */
+    rc = trusty_dev_share_memory(dev->tdev, &dev->buf_id, &dev->buf_ns,
+                                 dev->buf_size / PAGE_SIZE);
+    if (rc != 0) {
+        trusty_error("%s: failed (%d) to share memory\n", __func__, rc);
+        return TRUSTY_ERR_SECOS_ERR;
+    }
+
+    rc = trusty_dev_init_ipc(dev->tdev, dev->buf_id, dev->buf_size);
+    if (rc != 0) {
+        trusty_error("%s: failed (%d) to create Trusty IPC device\n", __func__,
+                     rc);
+        rc2 = trusty_dev_reclaim_memory(dev->tdev, dev->buf_id);
+        if (rc2) {
+            trusty_fatal("%s: failed to remove shared memory\n", __func__);
+        }
+        return TRUSTY_ERR_SECOS_ERR;
+    }
+
+    return TRUSTY_ERR_NONE;
+}
+
+static void smc_transport_detach(struct trusty_ipc_dev* dev) {
+    int rc;
+
+    /* shutdown Trusty IPC device */
+    rc = trusty_dev_shutdown_ipc(dev->tdev, dev->buf_id, dev->buf_size);
+    trusty_assert(!rc);
+    if (rc != 0) {
+        trusty_error("%s: failed (%d) to shutdown Trusty IPC device\n",
+                     __func__, rc);
+    }
+    rc = trusty_dev_reclaim_memory(dev->tdev, dev->buf_id);
+    if (rc) {
+        trusty_fatal("%s: failed to remove shared memory\n", __func__);
+    }
+}
+
+static int smc_transport_exec(struct trusty_ipc_dev* dev,
+                              size_t cmd_size,
+                              bool fast) {
+    if (fast) {
+        return trusty_dev_exec_fc_ipc(dev->tdev, dev->buf_id, cmd_size);
+    }
+    return trusty_dev_exec_ipc(dev->tdev, dev->buf_id, cmd_size);
+}
+
+static void smc_transport_idle(struct trusty_ipc_dev* dev, bool event_poll) {
+    trusty_idle(dev->tdev, event_poll);
+}
+
+static const struct trusty_ipc_transport_ops smc_transport_ops = {
+        .attach = smc_transport_attach,
+        .detach = smc_transport_detach,
+        .exec = smc_transport_exec,
+        .idle = smc_transport_idle,
+};
+
+/*
+ * Appends a record of @type holding the first @size bytes of the shared
+ * buffer of @dev to the attached recording.
+ */
+static void record_buf(struct trusty_ipc_dev* dev,
+                       uint8_t type,
+                       bool fast,
+                       int32_t result,
+                       size_t size) {
+    struct trusty_ipc_recorder* rec = dev->recorder;
+    struct trusty_ipc_record_hdr hdr = {
+            .type = type,
+            .fast = fast,
+            .size = (uint32_t)size,
+            .result = result,
+    };
+
+    if (rec->now)
+        hdr.timestamp = rec->now(rec);
+    rec->write(rec, &hdr, sizeof(hdr));
+    rec->write(rec, dev->buf_vaddr, size);
+}
+
+/*
+ * Passes the command in the shared buffer of @dev to the secure side. The
+ * response overwrites the command.
+ */
+static int exec_cmd(struct trusty_ipc_dev* dev,
+                    volatile struct trusty_ipc_cmd_hdr* cmd,
+                    bool fast) {
+    int rc;
+    size_t resp_size;
+    size_t cmd_size = sizeof(*cmd) + cmd->payload_len;
+
+    if (!dev->recorder)
+        return dev->ops->exec(dev, cmd_size, fast);
+
+    record_buf(dev, TRUSTY_IPC_RECORD_CMD, fast, 0, cmd_size);
+    rc = dev->ops->exec(dev, cmd_size, fast);
+    resp_size = sizeof(*cmd) + cmd->payload_len;
+    if (resp_size > dev->buf_size)
+        resp_size = dev->buf_size; /* malformed, keep it for inspection */
+    record_buf(dev, TRUSTY_IPC_RECORD_RESP, fast, rc, resp_size);
+    return rc;
+}
+
+void trusty_ipc_dev_set_recorder(struct trusty_ipc_dev* dev,
+                                 struct trusty_ipc_recorder* rec) {
+    struct trusty_ipc_record_file_hdr hdr = {
+            .magic = TRUSTY_IPC_RECORD_MAGIC,
+            .version = TRUSTY_IPC_RECORD_VERSION,
+    };
+
+    trusty_assert(dev);
+    trusty_assert(!rec || rec->write);
+
+    hdr.buf_size = (uint32_t)dev->buf_size;
+    dev->recorder = rec;
+    if (rec)
+        rec->write(rec, &hdr, sizeof(hdr));
+}
+
 int trusty_ipc_dev_create(struct trusty_ipc_dev** idev,
                           struct trusty_dev* tdev,
                           size_t shared_buf_size) {
+    trusty_assert(tdev);
+
+    return trusty_ipc_dev_create_with_transport(idev, tdev, shared_buf_size,
+                                                &smc_transport_ops, NULL);
+}
+
+int trusty_ipc_dev_create_with_transport(
+        struct trusty_ipc_dev** idev,
+        struct trusty_dev* tdev,
+        size_t shared_buf_size,
+        const struct trusty_ipc_transport_ops* ops,
+        void* transport_priv) {
     int rc;
-    int rc2;
     struct trusty_ipc_dev* dev;
 
     trusty_assert(idev);
+    trusty_assert(ops && ops->attach && ops->detach && ops->exec && ops->idle);
     trusty_assert(!(shared_buf_size % PAGE_SIZE));
     trusty_debug("%s: Create new Trusty IPC device (%zu)\n", __func__,
                  shared_buf_size);
@@ -177,6 +366,9 @@ int trusty_ipc_dev_create(struct trusty_ipc_dev** idev,
         return TRUSTY_ERR_NO_MEMORY;
     }
     dev->tdev = tdev;
+    dev->ops = ops;
+    dev->transport_priv = transport_priv;
+    dev->api_version = tdev ? tdev->api_version : TRUSTY_API_VERSION_CURRENT;
 
     /* allocate shared buffer */
     dev->buf_size = shared_buf_size;
@@ -187,28 +379,17 @@ int trusty_ipc_dev_create(struct trusty_ipc_dev** idev,
         goto err_alloc_pages;
     }
 
-    /* Get memory attributes */
-    rc = trusty_encode_page_info(&dev->buf_ns, dev->buf_vaddr);
-    if (rc != 0) {
-        trusty_error("%s: failed to get shared memory attributes\n", __func__);
-        rc = TRUSTY_ERR_GENERIC;
-        goto err_page_info;
-    }
-    /* call secure OS to register shared buffer */
-    rc = trusty_dev_share_memory(dev->tdev, &dev->buf_id, &dev->buf_ns,
-                                 dev->buf_size / PAGE_SIZE);
+    /* register shared buffer with the secure side */
+    rc = dev->ops->attach(dev);
     if (rc != 0) {
-        trusty_error("%s: failed (%d) to share memory\n", __func__, rc);
-        rc = TRUSTY_ERR_SECOS_ERR;
-        goto err_share_memory;
+        trusty_error("%s: failed (%d) to attach transport\n", __func__, rc);
+        goto err_attach;
     }
 
-    rc = trusty_dev_init_ipc(dev->tdev, dev->buf_id, dev->buf_size);
-    if (rc != 0) {
-        trusty_error("%s: failed (%d) to create Trusty IPC device\n", __func__,
-                     rc);
-        rc = TRUSTY_ERR_SECOS_ERR;
-        goto err_create_sec_dev;
+    /* never send commands the secure side predates, see smcall.h */
+    if (dev->api_version < TRUSTY_API_VERSION_QL_TIPC_EXT) {
+        dev->unsupported |= 1U << QL_TIPC_DEV_RECV_PARTIAL;
+        dev->unsupported |= 1U << QL_TIPC_DEV_CONNECT_WITH_MSG;
     }
 
     trusty_debug("%s: new Trusty IPC device (%p)\n", __func__, dev);
@@ -216,13 +397,7 @@ int trusty_ipc_dev_create(struct trusty_ipc_dev** idev,
     *idev = dev;
     return TRUSTY_ERR_NONE;
 
-err_page_info:
-err_create_sec_dev:
-    rc2 = trusty_dev_reclaim_memory(dev->tdev, dev->buf_id);
-    if (rc2) {
-        trusty_fatal("%s: failed to remove shared memory\n", __func__);
-    }
-err_share_memory:
+err_attach:
     trusty_free_pages(dev->buf_vaddr, dev->buf_size / PAGE_SIZE);
 err_alloc_pages:
     trusty_free(dev);
@@ -230,22 +405,11 @@ err_alloc_pages:
 }
 
 void trusty_ipc_dev_shutdown(struct trusty_ipc_dev* dev) {
-    int rc;
     trusty_assert(dev);
 
     trusty_debug("%s: shutting down Trusty IPC device (%p)\n", __func__, dev);
 
-    /* shutdown Trusty IPC device */
-    rc = trusty_dev_shutdown_ipc(dev->tdev, dev->buf_id, dev->buf_size);
-    trusty_assert(!rc);
-    if (rc != 0) {
-        trusty_error("%s: failed (%d) to shutdown Trusty IPC device\n",
-                     __func__, rc);
-    }
-    rc = trusty_dev_reclaim_memory(dev->tdev, dev->buf_id);
-    if (rc) {
-        trusty_fatal("%s: failed to remove shared memory\n", __func__);
-    }
+    dev->ops->detach(dev);
     trusty_free_pages(dev->buf_vaddr, dev->buf_size / PAGE_SIZE);
     trusty_free(dev);
 }
@@ -284,8 +448,7 @@ int trusty_ipc_dev_connect(struct trusty_ipc_dev* dev,
     cmd->payload_len = sizeof(*req) + port_len;
 
     /* call secure os */
-    rc = trusty_dev_exec_ipc(dev->tdev, dev->buf_id,
-                             sizeof(*cmd) + cmd->payload_len);
+    rc = exec_cmd(dev, cmd, false);
     if (rc) {
         /* secure OS returned an error */
         trusty_error("%s: secure OS returned (%d)\n", __func__, rc);
@@ -302,6 +465,90 @@ int trusty_ipc_dev_connect(struct trusty_ipc_dev* dev,
     return cmd->handle;
 }
 
+bool trusty_ipc_dev_has_connect_with_msg(struct trusty_ipc_dev* dev) {
+    trusty_assert(dev);
+
+    return !(dev->unsupported & (1U << QL_TIPC_DEV_CONNECT_WITH_MSG));
+}
+
+int trusty_ipc_dev_connect_with_msg(struct trusty_ipc_dev* dev,
+                                    const char* port,
+                                    uint64_t cookie,
+                                    const struct trusty_ipc_iovec* iovs,
+                                    size_t iovs_cnt,
+                                    uint32_t* event) {
+    int rc;
+    size_t port_len;
+    size_t msg_size;
+    volatile struct trusty_ipc_cmd_hdr* cmd;
+    struct trusty_ipc_connect_msg_req req;
+    struct trusty_ipc_connect_msg_resp resp;
+
+    trusty_assert(dev);
+    trusty_assert(port);
+    trusty_assert(event);
+
+    if (dev->unsupported & (1U << QL_TIPC_DEV_CONNECT_WITH_MSG))
+        return TRUSTY_ERR_NOT_SUPPORTED;
+
+    trusty_debug("%s: connecting to '%s'\n", __func__, port);
+
+    /* check that port name and message fit into buffer */
+    port_len = trusty_strlen(port) + 1;
+    msg_size = iovs_cnt ? iovec_size(iovs, iovs_cnt) : 0;
+    if (port_len + msg_size > dev->buf_size - sizeof(*cmd) - sizeof(req)) {
+        trusty_error("%s: msg is too long (%zu)\n", __func__, msg_size);
+        return TRUSTY_ERR_MSG_TOO_BIG;
+    }
+
+    /* prepare command */
+    cmd = dev->buf_vaddr;
+    trusty_memset((void*)cmd, 0, sizeof(*cmd));
+    cmd->opcode = QL_TIPC_DEV_CONNECT_WITH_MSG;
+
+    /* prepare payload: request, port name, message */
+    req.cookie = cookie;
+    req.name_len = (uint32_t)port_len;
+    req.msg_len = (uint32_t)msg_size;
+    trusty_memcpy((void*)cmd->payload, &req, sizeof(req));
+    trusty_memcpy((void*)(cmd->payload + sizeof(req)), port, port_len);
+    trusty_ipc_iovec_to_buf((void*)(cmd->payload + sizeof(req) + port_len),
+                            msg_size, iovs, iovs_cnt);
+    cmd->payload_len = (uint32_t)(sizeof(req) + port_len + msg_size);
+
+    /* call secure os */
+    rc = exec_cmd(dev, cmd, false);
+    if (rc) {
+        trusty_error("%s: secure OS returned (%d)\n", __func__, rc);
+        return TRUSTY_ERR_SECOS_ERR;
+    }
+
+    if (cmd->opcode == (QL_TIPC_DEV_CONNECT_WITH_MSG | QL_TIPC_DEV_RESP) &&
+        cmd->status == QL_TIPC_DEV_ERR_NOT_SUPPORTED) {
+        /* older secure OS, do not ask again */
+        trusty_debug("%s: connect with msg not supported\n", __func__);
+        dev->unsupported |= 1U << QL_TIPC_DEV_CONNECT_WITH_MSG;
+        return TRUSTY_ERR_NOT_SUPPORTED;
+    }
+
+    rc = check_response(dev, cmd, QL_TIPC_DEV_CONNECT_WITH_MSG);
+    if (rc) {
+        trusty_error("%s: connect cmd failed (%d)\n", __func__, rc);
+        return rc;
+    }
+
+    if ((size_t)cmd->payload_len < sizeof(resp)) {
+        trusty_error("%s: invalid response length (%zd)\n", __func__,
+                     (size_t)cmd->payload_len);
+        return TRUSTY_ERR_SECOS_ERR;
+    }
+    trusty_memcpy(&resp, (const void*)cmd->payload, sizeof(resp));
+    *event = resp.event;
+
+    /* success */
+    return cmd->handle;
+}
+
 int trusty_ipc_dev_close(struct trusty_ipc_dev* dev, handle_t handle) {
     int rc;
     volatile struct trusty_ipc_cmd_hdr* cmd;
@@ -318,8 +565,7 @@ int trusty_ipc_dev_close(struct trusty_ipc_dev* dev, handle_t handle) {
     /* no payload */
 
     /* call into secure os */
-    rc = trusty_dev_exec_ipc(dev->tdev, dev->buf_id,
-                             sizeof(*cmd) + cmd->payload_len);
+    rc = exec_cmd(dev, cmd, false);
     if (rc) {
         trusty_error("%s: secure OS returned (%d)\n", __func__, rc);
         return TRUSTY_ERR_SECOS_ERR;
@@ -353,8 +599,7 @@ bool trusty_ipc_dev_has_event(struct trusty_ipc_dev* dev, handle_t chan) {
     cmd->payload_len = 0;
 
     /* call into secure os */
-    rc = trusty_dev_exec_fc_ipc(dev->tdev, dev->buf_id,
-                                sizeof(*cmd) + cmd->payload_len);
+    rc = exec_cmd(dev, cmd, true);
     if (rc) {
         trusty_error("%s: secure OS returned (%d)\n", __func__, rc);
         return false;
@@ -397,8 +642,7 @@ int trusty_ipc_dev_get_event(struct trusty_ipc_dev* dev,
     cmd->payload_len = sizeof(struct trusty_ipc_wait_req);
 
     /* call into secure os */
-    rc = trusty_dev_exec_ipc(dev->tdev, dev->buf_id,
-                             sizeof(*cmd) + cmd->payload_len);
+    rc = exec_cmd(dev, cmd, false);
     if (rc) {
         trusty_error("%s: secure OS returned (%d)\n", __func__, rc);
         return TRUSTY_ERR_SECOS_ERR;
@@ -421,50 +665,124 @@ int trusty_ipc_dev_get_event(struct trusty_ipc_dev* dev,
     return TRUSTY_ERR_NONE;
 }
 
+/*
+ * Sends the @msg_size bytes following the command header in the shared
+ * buffer of @dev as a message on @chan.
+ */
+static int exec_send(struct trusty_ipc_dev* dev,
+                     handle_t chan,
+                     size_t msg_size) {
+    int rc;
+    volatile struct trusty_ipc_cmd_hdr* cmd;
+
+    /* prepare command */
+    cmd = dev->buf_vaddr;
+    trusty_memset((void*)cmd, 0, sizeof(*cmd));
+    cmd->opcode = QL_TIPC_DEV_SEND;
+    cmd->handle = chan;
+    cmd->payload_len = (uint32_t)msg_size;
+
+    /* call into secure os */
+    rc = exec_cmd(dev, cmd, false);
+    if (rc < 0) {
+        trusty_error("%s: secure OS returned (%d)\n", __func__, rc);
+        return TRUSTY_ERR_SECOS_ERR;
+    }
+
+    if (cmd->opcode == (QL_TIPC_DEV_SEND | QL_TIPC_DEV_RESP) &&
+        cmd->status == QL_TIPC_DEV_ERR_NOT_ENOUGH_BUFFER) {
+        /* IPC_HANDLE_POLL_SEND_UNBLOCKED follows once there is room */
+        trusty_debug("%s: chan %d: send blocked\n", __func__, chan);
+        return TRUSTY_ERR_SEND_BLOCKED;
+    }
+
+    rc = check_response(dev, cmd, QL_TIPC_DEV_SEND);
+    if (rc) {
+        trusty_error("%s: send msg failed (%d)\n", __func__, rc);
+    }
+
+    return rc;
+}
+
 int trusty_ipc_dev_send(struct trusty_ipc_dev* dev,
                         handle_t chan,
                         const struct trusty_ipc_iovec* iovs,
                         size_t iovs_cnt) {
-    int rc;
     size_t msg_size;
-    volatile struct trusty_ipc_cmd_hdr* cmd;
+    size_t copied;
 
     trusty_assert(dev);
     /* calc message length */
     msg_size = iovec_size(iovs, iovs_cnt);
-    if (msg_size > dev->buf_size - sizeof(*cmd)) {
+    if (msg_size > trusty_ipc_dev_max_msg_size(dev)) {
         /* msg is too big to fit provided buffer */
         trusty_error("%s: chan %d: msg is too long (%zu)\n", __func__, chan,
                      msg_size);
         return TRUSTY_ERR_MSG_TOO_BIG;
     }
 
+    /* copy in message data */
+    copied = trusty_ipc_iovec_to_buf(trusty_ipc_dev_send_buf(dev),
+                                     trusty_ipc_dev_max_msg_size(dev), iovs,
+                                     iovs_cnt);
+    trusty_assert(copied == msg_size);
+
+    return exec_send(dev, chan, copied);
+}
+
+void* trusty_ipc_dev_send_buf(struct trusty_ipc_dev* dev) {
+    trusty_assert(dev);
+
+    return (uint8_t*)dev->buf_vaddr + sizeof(struct trusty_ipc_cmd_hdr);
+}
+
+int trusty_ipc_dev_send_in_place(struct trusty_ipc_dev* dev,
+                                 handle_t chan,
+                                 size_t msg_size) {
+    trusty_assert(dev);
+
+    if (msg_size > trusty_ipc_dev_max_msg_size(dev)) {
+        trusty_error("%s: chan %d: msg is too long (%zu)\n", __func__, chan,
+                     msg_size);
+        return TRUSTY_ERR_MSG_TOO_BIG;
+    }
+    return exec_send(dev, chan, msg_size);
+}
+
+/*
+ * Receives the next message on @chan into the shared buffer of @dev, right
+ * after the command header. Returns its length or a trusty_err.
+ */
+static int exec_recv(struct trusty_ipc_dev* dev, handle_t chan) {
+    int rc;
+    volatile struct trusty_ipc_cmd_hdr* cmd;
+
     /* prepare command */
     cmd = dev->buf_vaddr;
     trusty_memset((void*)cmd, 0, sizeof(*cmd));
-    cmd->opcode = QL_TIPC_DEV_SEND;
+    cmd->opcode = QL_TIPC_DEV_RECV;
     cmd->handle = chan;
-
-    /* copy in message data */
-    cmd->payload_len = (uint32_t)msg_size;
-    msg_size = iovec_to_buf(dev->buf_vaddr + sizeof(*cmd),
-                            dev->buf_size - sizeof(*cmd), iovs, iovs_cnt);
-    trusty_assert(msg_size == (size_t)cmd->payload_len);
+    /* no payload */
 
     /* call into secure os */
-    rc = trusty_dev_exec_ipc(dev->tdev, dev->buf_id,
-                             sizeof(*cmd) + cmd->payload_len);
+    rc = exec_cmd(dev, cmd, false);
     if (rc < 0) {
         trusty_error("%s: secure OS returned (%d)\n", __func__, rc);
         return TRUSTY_ERR_SECOS_ERR;
     }
 
-    rc = check_response(dev, cmd, QL_TIPC_DEV_SEND);
+    rc = check_response(dev, cmd, QL_TIPC_DEV_RECV);
     if (rc) {
-        trusty_error("%s: send msg failed (%d)\n", __func__, rc);
+        trusty_error("%s: recv cmd failed (%d)\n", __func__, rc);
+        return rc;
     }
 
-    return rc;
+    if ((size_t)cmd->payload_len > trusty_ipc_dev_max_msg_size(dev)) {
+        trusty_error("%s: invalid response length (%zu)\n", __func__,
+                     (size_t)cmd->payload_len);
+        return TRUSTY_ERR_SECOS_ERR;
+    }
+    return (int)cmd->payload_len;
 }
 
 int trusty_ipc_dev_recv(struct trusty_ipc_dev* dev,
@@ -473,44 +791,159 @@ int trusty_ipc_dev_recv(struct trusty_ipc_dev* dev,
                         size_t iovs_cnt) {
     int rc;
     size_t copied;
-    volatile struct trusty_ipc_cmd_hdr* cmd;
 
     trusty_assert(dev);
 
+    rc = exec_recv(dev, chan);
+    if (rc < 0) {
+        return rc;
+    }
+
+    /* copy data out to proper destination */
+    copied = trusty_ipc_buf_to_iovec(iovs, iovs_cnt,
+                                     trusty_ipc_dev_send_buf(dev), rc);
+    if (copied != (size_t)rc) {
+        /* msg is too big to fit provided buffer */
+        trusty_error("%s: chan %d: buffer too small (%zu vs. %zu)\n", __func__,
+                     chan, copied, (size_t)rc);
+        return TRUSTY_ERR_MSG_TOO_BIG;
+    }
+
+    return (int)copied;
+}
+
+int trusty_ipc_dev_recv_borrow(struct trusty_ipc_dev* dev,
+                               handle_t chan,
+                               void** msg) {
+    int rc;
+
+    trusty_assert(dev);
+    trusty_assert(msg);
+
+    rc = exec_recv(dev, chan);
+    if (rc >= 0) {
+        *msg = trusty_ipc_dev_send_buf(dev);
+    }
+    return rc;
+}
+
+/*
+ * Executes QL_TIPC_DEV_RECV_PARTIAL to copy the part of the first message
+ * queued on @chan that starts at @offset into @iovs. Stores the length of the
+ * whole message in @msg_len. Returns the number of bytes copied or a
+ * trusty_err.
+ */
+static int recv_partial(struct trusty_ipc_dev* dev,
+                        handle_t chan,
+                        size_t offset,
+                        const struct trusty_ipc_iovec* iovs,
+                        size_t iovs_cnt,
+                        uint16_t flags,
+                        size_t* msg_len) {
+    int rc;
+    size_t max_len;
+    size_t copied;
+    struct trusty_ipc_recv_req req;
+    struct trusty_ipc_recv_resp resp;
+    volatile struct trusty_ipc_cmd_hdr* cmd;
+
+    if (dev->unsupported & (1U << QL_TIPC_DEV_RECV_PARTIAL))
+        return TRUSTY_ERR_NOT_SUPPORTED;
+    if (offset > UINT32_MAX)
+        return TRUSTY_ERR_INVALID_ARGS;
+
+    max_len = 0;
+    if (iovs_cnt) {
+        max_len = MIN(iovec_size(iovs, iovs_cnt),
+                      dev->buf_size - sizeof(*cmd) - sizeof(resp));
+    }
+    req.offset = (uint32_t)offset;
+    req.max_len = (uint32_t)max_len;
+
     /* prepare command */
     cmd = dev->buf_vaddr;
     trusty_memset((void*)cmd, 0, sizeof(*cmd));
-    cmd->opcode = QL_TIPC_DEV_RECV;
+    cmd->opcode = QL_TIPC_DEV_RECV_PARTIAL;
+    cmd->flags = flags;
     cmd->handle = chan;
-    /* no payload */
+    trusty_memcpy((void*)cmd->payload, &req, sizeof(req));
+    cmd->payload_len = sizeof(req);
 
     /* call into secure os */
-    rc = trusty_dev_exec_ipc(dev->tdev, dev->buf_id,
-                             sizeof(*cmd) + cmd->payload_len);
+    rc = exec_cmd(dev, cmd, false);
     if (rc < 0) {
         trusty_error("%s: secure OS returned (%d)\n", __func__, rc);
         return TRUSTY_ERR_SECOS_ERR;
     }
 
-    rc = check_response(dev, cmd, QL_TIPC_DEV_RECV);
+    if (cmd->opcode == (QL_TIPC_DEV_RECV_PARTIAL | QL_TIPC_DEV_RESP) &&
+        cmd->status == QL_TIPC_DEV_ERR_NOT_SUPPORTED) {
+        /* older secure OS, do not ask again */
+        trusty_debug("%s: partial recv not supported\n", __func__);
+        dev->unsupported |= 1U << QL_TIPC_DEV_RECV_PARTIAL;
+        return TRUSTY_ERR_NOT_SUPPORTED;
+    }
+
+    rc = check_response(dev, cmd, QL_TIPC_DEV_RECV_PARTIAL);
     if (rc) {
         trusty_error("%s: recv cmd failed (%d)\n", __func__, rc);
         return rc;
     }
 
-    /* copy data out to proper destination */
-    copied = buf_to_iovec(iovs, iovs_cnt, (const void*)cmd->payload,
-                          cmd->payload_len);
-    if (copied != (size_t)cmd->payload_len) {
-        /* msg is too big to fit provided buffer */
-        trusty_error("%s: chan %d: buffer too small (%zu vs. %zu)\n", __func__,
-                     chan, copied, (size_t)cmd->payload_len);
-        return TRUSTY_ERR_MSG_TOO_BIG;
+    if ((size_t)cmd->payload_len < sizeof(resp) ||
+        (size_t)cmd->payload_len - sizeof(resp) > max_len) {
+        trusty_error("%s: invalid response length (%zd)\n", __func__,
+                     (size_t)cmd->payload_len);
+        return TRUSTY_ERR_SECOS_ERR;
     }
+    trusty_memcpy(&resp, (const void*)cmd->payload, sizeof(resp));
 
+    copied = trusty_ipc_buf_to_iovec(iovs, iovs_cnt,
+                                     (const void*)(cmd->payload + sizeof(resp)),
+                                     cmd->payload_len - sizeof(resp));
+    if (msg_len)
+        *msg_len = resp.msg_len;
     return (int)copied;
 }
 
+bool trusty_ipc_dev_has_recv_partial(struct trusty_ipc_dev* dev) {
+    trusty_assert(dev);
+
+    return !(dev->unsupported & (1U << QL_TIPC_DEV_RECV_PARTIAL));
+}
+
+int trusty_ipc_dev_peek_msg_size(struct trusty_ipc_dev* dev, handle_t chan) {
+    int rc;
+    size_t msg_len;
+
+    trusty_assert(dev);
+
+    rc = recv_partial(dev, chan, 0, NULL, 0, QL_TIPC_DEV_RECV_PEEK, &msg_len);
+    if (rc < 0)
+        return rc;
+    if (msg_len > INT32_MAX)
+        return TRUSTY_ERR_MSG_TOO_BIG;
+    return (int)msg_len;
+}
+
+int trusty_ipc_dev_recv_at(struct trusty_ipc_dev* dev,
+                           handle_t chan,
+                           size_t offset,
+                           const struct trusty_ipc_iovec* iovs,
+                           size_t iovs_cnt,
+                           size_t* msg_len) {
+    trusty_assert(dev);
+    trusty_assert(iovs || !iovs_cnt);
+
+    return recv_partial(dev, chan, offset, iovs, iovs_cnt, 0, msg_len);
+}
+
+size_t trusty_ipc_dev_max_msg_size(struct trusty_ipc_dev* dev) {
+    trusty_assert(dev);
+
+    return dev->buf_size - sizeof(struct trusty_ipc_cmd_hdr);
+}
+
 void trusty_ipc_dev_idle(struct trusty_ipc_dev* dev, bool event_poll) {
-    trusty_idle(dev->tdev, event_poll);
+    dev->ops->idle(dev, event_poll);
 }
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <trusty/trusty_ipc.h>
+#include <trusty/trusty_ipc_framer.h>
+#include <trusty/util.h>
+
+#define LOCAL_LOG 0
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+/*
+ * Position in a list of caller iovecs
+ */
+struct framer_cursor {
+    const struct trusty_ipc_iovec* iovs;
+    size_t iovs_cnt;
+    size_t idx;
+    size_t off;
+};
+
+/*
+ * Fills @out, after the frame header in @out[0], with the next @len bytes of
+ * @cur without advancing it. Returns the number of iovecs used in total.
+ */
+static size_t framer_window(const struct framer_cursor* cur,
+                            struct trusty_ipc_iovec* out,
+                            size_t len) {
+    size_t n = 1;
+    size_t idx = cur->idx;
+    size_t off = cur->off;
+    size_t chunk;
+
+    while (len && idx < cur->iovs_cnt) {
+        chunk = MIN(cur->iovs[idx].len - off, len);
+        if (chunk) {
+            out[n].base = (uint8_t*)cur->iovs[idx].base + off;
+            out[n].len = chunk;
+            n++;
+            len -= chunk;
+        }
+        idx++;
+        off = 0;
+    }
+    return n;
+}
+
+static void framer_advance(struct framer_cursor* cur, size_t len) {
+    size_t chunk;
+
+    while (len && cur->idx < cur->iovs_cnt) {
+        chunk = MIN(cur->iovs[cur->idx].len - cur->off, len);
+        cur->off += chunk;
+        len -= chunk;
+        if (cur->off == cur->iovs[cur->idx].len) {
+            cur->idx++;
+            cur->off = 0;
+        }
+    }
+}
+
+static size_t framer_iovs_size(const struct trusty_ipc_iovec* iovs,
+                               size_t iovs_cnt) {
+    size_t i;
+    size_t len = 0;
+
+    for (i = 0; i < iovs_cnt; i++)
+        len += iovs[i].len;
+    return len;
+}
+
+static uint32_t framer_hdr_word(const struct trusty_ipc_framer* framer) {
+    uint32_t word;
+
+    trusty_memcpy(&word, framer->hdr, sizeof(word));
+    return word;
+}
+
+static void framer_set_hdr_word(struct trusty_ipc_framer* framer,
+                                uint32_t word) {
+    trusty_memcpy(framer->hdr, &word, sizeof(word));
+}
+
+void trusty_ipc_framer_init(struct trusty_ipc_framer* framer,
+                            struct trusty_ipc_chan* chan,
+                            void* hdr,
+                            size_t hdr_len,
+                            uint32_t stop_bit,
+                            size_t max_frame_size) {
+    size_t max_msg;
+
+    trusty_assert(framer);
+    trusty_assert(chan);
+    trusty_assert(chan->dev);
+    trusty_assert(hdr);
+    trusty_assert(hdr_len >= sizeof(uint32_t));
+
+    max_msg = trusty_ipc_dev_max_msg_size(chan->dev);
+    trusty_assert(max_msg > hdr_len);
+
+    trusty_memset(framer, 0, sizeof(*framer));
+    framer->chan = chan;
+    framer->hdr = hdr;
+    framer->hdr_len = hdr_len;
+    framer->stop_bit = stop_bit;
+    framer->frame_size = max_frame_size && max_frame_size < max_msg
+                                 ? max_frame_size
+                                 : max_msg;
+}
+
+int trusty_ipc_framer_recv(struct trusty_ipc_framer* framer,
+                           const struct trusty_ipc_iovec* iovs,
+                           size_t iovs_cnt,
+                           bool wait) {
+    int rc;
+    size_t n;
+    size_t total;
+    size_t space;
+    size_t received = 0;
+    struct framer_cursor cur = {.iovs = iovs, .iovs_cnt = iovs_cnt};
+    struct trusty_ipc_iovec frame[TRUSTY_IPC_FRAMER_MAX_IOVS + 1];
+
+    trusty_assert(framer);
+    trusty_assert(iovs || !iovs_cnt);
+    trusty_assert(iovs_cnt <= TRUSTY_IPC_FRAMER_MAX_IOVS);
+
+    total = framer_iovs_size(iovs, iovs_cnt);
+    frame[0].base = framer->hdr;
+    frame[0].len = framer->hdr_len;
+    for (;;) {
+        /*
+         * Offer all that is left, up to the largest frame, so that a frame
+         * which is too big is detected rather than truncated.
+         */
+        space = MIN(total - received, framer->frame_size - framer->hdr_len);
+        n = framer_window(&cur, frame, space);
+
+        rc = trusty_ipc_recv(framer->chan, frame, n, wait);
+        if (rc < 0)
+            return rc;
+        if ((size_t)rc < framer->hdr_len) {
+            trusty_error("%s: short frame (%d)\n", __func__, rc);
+            return TRUSTY_ERR_GENERIC;
+        }
+        if (framer->check) {
+            rc = framer->check(framer, (size_t)rc);
+            if (rc < 0)
+                return rc;
+        }
+        rc -= framer->hdr_len;
+        framer_advance(&cur, (size_t)rc);
+        received += (size_t)rc;
+
+        if (framer_hdr_word(framer) & framer->stop_bit)
+            break;
+        if (received == total)
+            break;
+    }
+
+    return (int)received;
+}
+
+int trusty_ipc_framer_send(struct trusty_ipc_framer* framer,
+                           const struct trusty_ipc_iovec* iovs,
+                           size_t iovs_cnt,
+                           bool wait) {
+    int rc = TRUSTY_ERR_NONE;
+    size_t n;
+    size_t len;
+    size_t total;
+    size_t sent = 0;
+    uint32_t word = framer_hdr_word(framer);
+    struct framer_cursor cur = {.iovs = iovs, .iovs_cnt = iovs_cnt};
+    struct trusty_ipc_iovec frame[TRUSTY_IPC_FRAMER_MAX_IOVS + 1];
+
+    trusty_assert(framer);
+    trusty_assert(iovs || !iovs_cnt);
+    trusty_assert(iovs_cnt <= TRUSTY_IPC_FRAMER_MAX_IOVS);
+
+    total = framer_iovs_size(iovs, iovs_cnt);
+    frame[0].base = framer->hdr;
+    frame[0].len = framer->hdr_len;
+    do {
+        len = MIN(total - sent, framer->frame_size - framer->hdr_len);
+        if (sent + len == total)
+            framer_set_hdr_word(framer, word | framer->stop_bit);
+        else
+            framer_set_hdr_word(framer, word & ~framer->stop_bit);
+
+        n = framer_window(&cur, frame, len);
+        rc = trusty_ipc_send(framer->chan, frame, n, wait);
+        if (rc < 0)
+            break;
+        framer_advance(&cur, len);
+        sent += len;
+    } while (sent < total);
+
+    framer_set_hdr_word(framer, word);
+    return rc < 0 ? rc : TRUSTY_ERR_NONE;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <trusty/trusty_ipc.h>
+#include <trusty/trusty_ipc_loopback.h>
+#include <trusty/util.h>
+
+#define LOCAL_LOG 0
+
+static int loopback_attach(struct trusty_ipc_dev* dev) {
+    int rc;
+    struct trusty_ipc_loopback* lb = dev->transport_priv;
+
+    if (lb->api_version)
+        dev->api_version = lb->api_version;
+    if (!lb->create)
+        return TRUSTY_ERR_NONE;
+
+    rc = lb->create(lb, dev->buf_vaddr, dev->buf_size);
+    if (rc < 0) {
+        trusty_error("%s: loopback handler failed (%d) to create device\n",
+                     __func__, rc);
+        return TRUSTY_ERR_SECOS_ERR;
+    }
+    return TRUSTY_ERR_NONE;
+}
+
+static void loopback_detach(struct trusty_ipc_dev* dev) {
+    struct trusty_ipc_loopback* lb = dev->transport_priv;
+
+    if (lb->shutdown)
+        lb->shutdown(lb);
+}
+
+static int loopback_exec(struct trusty_ipc_dev* dev,
+                         size_t cmd_size,
+                         bool fast) {
+    struct trusty_ipc_loopback* lb = dev->transport_priv;
+
+    trusty_assert(cmd_size <= dev->buf_size);
+
+    return lb->handle_cmd(lb, dev->buf_vaddr, dev->buf_size, cmd_size, fast);
+}
+
+static void loopback_idle(struct trusty_ipc_dev* dev, bool event_poll) {
+    /*
+     * The handler runs synchronously on this cpu, so there is nothing that
+     * could make progress while we wait.
+     */
+}
+
+static const struct trusty_ipc_transport_ops loopback_transport_ops = {
+        .attach = loopback_attach,
+        .detach = loopback_detach,
+        .exec = loopback_exec,
+        .idle = loopback_idle,
+};
+
+int trusty_ipc_loopback_dev_create(struct trusty_ipc_dev** ipc_dev,
+                                   struct trusty_ipc_loopback* lb,
+                                   size_t shared_buf_size) {
+    trusty_assert(lb);
+    trusty_assert(lb->handle_cmd);
+
+    return trusty_ipc_dev_create_with_transport(ipc_dev, NULL, shared_buf_size,
+                                                &loopback_transport_ops, lb);
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <interface/ql_tipc/ql_tipc.h>
+#include <trusty/trusty_ipc.h>
+#include <trusty/trusty_ipc_record.h>
+#include <trusty/util.h>
+
+#define LOCAL_LOG 0
+
+/*
+ * Reads the next record, which must be of @type, into @hdr and points @buf
+ * at its contents. Returns a trusty_err.
+ */
+static int replay_next(struct trusty_ipc_replay* replay,
+                       uint8_t type,
+                       struct trusty_ipc_record_hdr* hdr,
+                       const uint8_t** buf) {
+    size_t avail = replay->size - replay->pos;
+
+    if (avail < sizeof(*hdr)) {
+        trusty_error("%s: end of recording\n", __func__);
+        return TRUSTY_ERR_NO_MSG;
+    }
+    /* records are not aligned */
+    trusty_memcpy(hdr, replay->data + replay->pos, sizeof(*hdr));
+    if (hdr->type != type || hdr->size > avail - sizeof(*hdr)) {
+        trusty_error("%s: malformed record at %zu\n", __func__, replay->pos);
+        return TRUSTY_ERR_GENERIC;
+    }
+    *buf = replay->data + replay->pos + sizeof(*hdr);
+    replay->pos += sizeof(*hdr) + hdr->size;
+    return TRUSTY_ERR_NONE;
+}
+
+static bool bytes_equal(const uint8_t* a, const uint8_t* b, size_t len) {
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        if (a[i] != b[i])
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Compares the live command in @buf with the recorded one at @rec. The cookie
+ * of a connect command is not compared, the pair is remembered instead.
+ */
+static bool replay_cmd_matches(struct trusty_ipc_replay* replay,
+                               const struct trusty_ipc_record_hdr* hdr,
+                               const uint8_t* rec,
+                               const uint8_t* buf,
+                               size_t cmd_size,
+                               bool fast) {
+    struct trusty_ipc_cmd_hdr cmd;
+    size_t cookie_off = sizeof(cmd) + offsetof(struct trusty_ipc_connect_req,
+                                               cookie);
+    size_t cookie_end = cookie_off + sizeof(uint64_t);
+
+    if (hdr->size != cmd_size || !hdr->fast != !fast)
+        return false;
+
+    /* both connect commands start with the cookie */
+    trusty_memcpy(&cmd, buf, sizeof(cmd));
+    if ((cmd.opcode != QL_TIPC_DEV_CONNECT &&
+         cmd.opcode != QL_TIPC_DEV_CONNECT_WITH_MSG) ||
+        cmd_size < cookie_end) {
+        return bytes_equal(rec, buf, cmd_size);
+    }
+
+    if (replay->num_cookies < TRUSTY_IPC_REPLAY_MAX_COOKIES) {
+        trusty_memcpy(&replay->cookies[replay->num_cookies], rec + cookie_off,
+                      sizeof(uint64_t));
+        trusty_memcpy(&replay->live[replay->num_cookies], buf + cookie_off,
+                      sizeof(uint64_t));
+        replay->num_cookies++;
+    }
+    return bytes_equal(rec, buf, cookie_off) &&
+           bytes_equal(rec + cookie_end, buf + cookie_end,
+                       cmd_size - cookie_end);
+}
+
+/*
+ * Rewrites the cookie of a replayed QL_TIPC_DEV_GET_EVENT response in @buf
+ * to the one the replaying client used for the same connect.
+ */
+static void replay_translate_event(struct trusty_ipc_replay* replay,
+                                   uint8_t* buf,
+                                   size_t resp_size) {
+    size_t i;
+    struct trusty_ipc_cmd_hdr cmd;
+    struct trusty_ipc_event evt;
+
+    trusty_memcpy(&cmd, buf, sizeof(cmd));
+    if (cmd.opcode != (QL_TIPC_DEV_GET_EVENT | QL_TIPC_DEV_RESP) ||
+        resp_size < sizeof(cmd) + sizeof(evt)) {
+        return;
+    }
+    trusty_memcpy(&evt, buf + sizeof(cmd), sizeof(evt));
+    for (i = replay->num_cookies; i > 0; i--) {
+        if (replay->cookies[i - 1] == evt.cookie) {
+            evt.cookie = replay->live[i - 1];
+            trusty_memcpy(buf + sizeof(cmd), &evt, sizeof(evt));
+            return;
+        }
+    }
+}
+
+static int replay_handle_cmd(struct trusty_ipc_loopback* lb,
+                             void* buf,
+                             size_t buf_size,
+                             size_t cmd_size,
+                             bool fast) {
+    int rc;
+    bool match;
+    const uint8_t* rec_cmd;
+    const uint8_t* rec_resp;
+    struct trusty_ipc_record_hdr cmd_hdr;
+    struct trusty_ipc_record_hdr resp_hdr;
+    struct trusty_ipc_replay* replay = lb->priv;
+
+    rc = replay_next(replay, TRUSTY_IPC_RECORD_CMD, &cmd_hdr, &rec_cmd);
+    if (rc)
+        return rc;
+    replay->cmds++;
+    match = replay_cmd_matches(replay, &cmd_hdr, rec_cmd, buf, cmd_size, fast);
+    if (!match) {
+        trusty_debug("%s: command %zu differs from recording\n", __func__,
+                     replay->cmds);
+        replay->mismatches++;
+    }
+
+    rc = replay_next(replay, TRUSTY_IPC_RECORD_RESP, &resp_hdr, &rec_resp);
+    if (rc)
+        return rc;
+    if (!match && replay->strict)
+        return TRUSTY_ERR_GENERIC;
+    if (resp_hdr.size > buf_size) {
+        trusty_error("%s: recorded response too big (%u)\n", __func__,
+                     resp_hdr.size);
+        return TRUSTY_ERR_MSG_TOO_BIG;
+    }
+
+    trusty_memcpy(buf, rec_resp, resp_hdr.size);
+    replay_translate_event(replay, buf, resp_hdr.size);
+    return resp_hdr.result;
+}
+
+int trusty_ipc_replay_init(struct trusty_ipc_replay* replay,
+                           const void* data,
+                           size_t size) {
+    struct trusty_ipc_record_file_hdr hdr;
+
+    trusty_assert(replay);
+    trusty_assert(data);
+
+    if (size < sizeof(hdr)) {
+        return TRUSTY_ERR_INVALID_ARGS;
+    }
+    trusty_memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.magic != TRUSTY_IPC_RECORD_MAGIC ||
+        hdr.version != TRUSTY_IPC_RECORD_VERSION) {
+        trusty_error("%s: not a recording (0x%x, %u)\n", __func__, hdr.magic,
+                     hdr.version);
+        return TRUSTY_ERR_INVALID_ARGS;
+    }
+
+    trusty_memset(replay, 0, sizeof(*replay));
+    replay->lb.handle_cmd = replay_handle_cmd;
+    replay->lb.priv = replay;
+    replay->data = data;
+    replay->size = size;
+    trusty_ipc_replay_rewind(replay);
+    return TRUSTY_ERR_NONE;
+}
+
+void trusty_ipc_replay_rewind(struct trusty_ipc_replay* replay) {
+    trusty_assert(replay);
+
+    replay->pos = sizeof(struct trusty_ipc_record_file_hdr);
+    replay->cmds = 0;
+    replay->mismatches = 0;
+    replay->num_cookies = 0;
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <trusty/trusty_ipc_schema.h>
+#include <trusty/util.h>
+
+#define LOCAL_LOG 0
+
+/* A contiguous run of bytes a field takes up on the wire */
+struct schema_piece {
+    const void* base;
+    size_t len;
+};
+
+/* Returns the wire size of a U32, U64 or BYTES field */
+static size_t schema_fixed_size(const struct trusty_ipc_schema_field* f) {
+    switch (f->type) {
+    case TRUSTY_IPC_SCHEMA_U32:
+        return sizeof(uint32_t);
+    case TRUSTY_IPC_SCHEMA_U64:
+        return sizeof(uint64_t);
+    default:
+        return f->arg;
+    }
+}
+
+/*
+ * Fills @pieces with the runs of bytes @f of @obj is made of, in wire order.
+ * Members are accessed with trusty_memcpy since the structures may be packed.
+ * Returns the number of pieces, or TRUSTY_ERR_INVALID_ARGS for a non-empty
+ * buffer without data.
+ */
+static int schema_pieces(const struct trusty_ipc_schema_field* f,
+                         const void* obj,
+                         struct schema_piece pieces[2]) {
+    const uint8_t* base = obj;
+    const uint8_t* data;
+    uint32_t len;
+    int n = 0;
+
+    switch (f->type) {
+    case TRUSTY_IPC_SCHEMA_U32:
+    case TRUSTY_IPC_SCHEMA_U64:
+    case TRUSTY_IPC_SCHEMA_BYTES:
+        pieces[0].base = base + f->offset;
+        pieces[0].len = schema_fixed_size(f);
+        return 1;
+    case TRUSTY_IPC_SCHEMA_BLOB:
+        pieces[n].base = base + f->arg;
+        pieces[n].len = sizeof(uint32_t);
+        n++;
+        /* fall through */
+    case TRUSTY_IPC_SCHEMA_TAIL:
+        trusty_memcpy(&len, base + f->arg, sizeof(len));
+        trusty_memcpy(&data, base + f->offset, sizeof(data));
+        if (len && !data) {
+            return TRUSTY_ERR_INVALID_ARGS;
+        }
+        pieces[n].base = data;
+        pieces[n].len = len;
+        return n + 1;
+    default:
+        trusty_fatal("%s: bad field type %u\n", __func__, f->type);
+    }
+}
+
+size_t trusty_ipc_schema_size(const struct trusty_ipc_schema* schema,
+                              const void* obj) {
+    struct schema_piece pieces[2];
+    size_t size = 0;
+    size_t i;
+    int j, n;
+
+    trusty_assert(schema);
+    trusty_assert(obj);
+
+    for (i = 0; i < schema->num_fields; i++) {
+        n = schema_pieces(&schema->fields[i], obj, pieces);
+        for (j = 0; j < n; j++) {
+            size += pieces[j].len;
+        }
+    }
+    return size;
+}
+
+int trusty_ipc_schema_encode(const struct trusty_ipc_schema* schema,
+                             const void* obj,
+                             void* buf,
+                             size_t buf_size) {
+    struct schema_piece pieces[2];
+    uint8_t* out = buf;
+    size_t pos = 0;
+    size_t i;
+    int j, n;
+
+    trusty_assert(schema);
+    trusty_assert(obj);
+    trusty_assert(buf || !buf_size);
+
+    for (i = 0; i < schema->num_fields; i++) {
+        n = schema_pieces(&schema->fields[i], obj, pieces);
+        if (n < 0) {
+            return n;
+        }
+        for (j = 0; j < n; j++) {
+            if (pieces[j].len > buf_size - pos) {
+                return TRUSTY_ERR_MSG_TOO_BIG;
+            }
+            if (pieces[j].len) {
+                trusty_memcpy(out + pos, pieces[j].base, pieces[j].len);
+            }
+            pos += pieces[j].len;
+        }
+    }
+    return (int)pos;
+}
+
+int trusty_ipc_schema_to_iovecs(const struct trusty_ipc_schema* schema,
+                                const void* obj,
+                                struct trusty_ipc_iovec* iovs,
+                                size_t iovs_cnt) {
+    struct schema_piece pieces[2];
+    struct trusty_ipc_iovec* last = NULL;
+    size_t cnt = 0;
+    size_t i;
+    int j, n;
+
+    trusty_assert(schema);
+    trusty_assert(obj);
+    trusty_assert(iovs || !iovs_cnt);
+
+    for (i = 0; i < schema->num_fields; i++) {
+        n = schema_pieces(&schema->fields[i], obj, pieces);
+        if (n < 0) {
+            return n;
+        }
+        for (j = 0; j < n; j++) {
+            if (!pieces[j].len) {
+                continue;
+            }
+            /* merge with the previous iovec if it ends where this starts */
+            if (last && (const uint8_t*)last->base + last->len ==
+                                (const uint8_t*)pieces[j].base) {
+                last->len += pieces[j].len;
+                continue;
+            }
+            if (cnt == iovs_cnt) {
+                return TRUSTY_ERR_INVALID_ARGS;
+            }
+            last = &iovs[cnt++];
+            last->base = (void*)pieces[j].base;
+            last->len = pieces[j].len;
+        }
+    }
+    return (int)cnt;
+}
+
+int trusty_ipc_schema_decode(const struct trusty_ipc_schema* schema,
+                             void* obj,
+                             const void* buf,
+                             size_t len) {
+    const struct trusty_ipc_schema_field* f;
+    const uint8_t* in = buf;
+    uint8_t* base = obj;
+    uint32_t size;
+    size_t i;
+
+    trusty_assert(schema);
+    trusty_assert(obj);
+    trusty_assert(buf || !len);
+
+    for (i = 0; i < schema->num_fields; i++) {
+        f = &schema->fields[i];
+        switch (f->type) {
+        case TRUSTY_IPC_SCHEMA_U32:
+        case TRUSTY_IPC_SCHEMA_U64:
+        case TRUSTY_IPC_SCHEMA_BYTES:
+            size = schema_fixed_size(f);
+            if (len < size) {
+                goto truncated;
+            }
+            trusty_memcpy(base + f->offset, in, size);
+            break;
+        case TRUSTY_IPC_SCHEMA_BLOB:
+            if (len < sizeof(size)) {
+                goto truncated;
+            }
+            trusty_memcpy(&size, in, sizeof(size));
+            in += sizeof(size);
+            len -= sizeof(size);
+            if (len < size) {
+                goto truncated;
+            }
+            trusty_memcpy(base + f->arg, &size, sizeof(size));
+            trusty_memcpy(base + f->offset, &in, sizeof(in));
+            break;
+        case TRUSTY_IPC_SCHEMA_TAIL:
+            size = (uint32_t)len;
+            trusty_memcpy(base + f->arg, &size, sizeof(size));
+            trusty_memcpy(base + f->offset, &in, sizeof(in));
+            break;
+        default:
+            trusty_fatal("%s: bad field type %u\n", __func__, f->type);
+        }
+        in += size;
+        len -= size;
+    }
+    if (len) {
+        trusty_debug("%s: %zu trailing bytes\n", __func__, len);
+        return TRUSTY_ERR_GENERIC;
+    }
+    return TRUSTY_ERR_NONE;
+
+truncated:
+    trusty_debug("%s: message truncated at field %zu\n", __func__, i);
+    return TRUSTY_ERR_GENERIC;
+}
@@ -26,6 +26,7 @@
 #include <trusty/keymaster_serializable.h>
 #include <trusty/rpmb.h>
 #include <trusty/trusty_ipc.h>
+#include <trusty/trusty_ipc_framer.h>
 #include <trusty/util.h>
 
 #define LOCAL_LOG 0
@@ -34,7 +35,6 @@ static struct trusty_ipc_chan km_chan;
 static bool initialized;
 static int trusty_km_version = 2;
 static const size_t kMaxCaRequestSize = 10000;
-static const size_t kMaxSendSize = 4000;
 static const size_t kUuidSize = 32;
 
 #ifndef MIN
@@ -45,16 +45,29 @@ static const size_t kUuidSize = 32;
 #define NELEMS(x) (sizeof(x) / sizeof((x)[0]))
 #endif
 
-static int km_send_request(uint32_t cmd, const void* req, size_t req_len) {
+/*
+ * Sends |cmd| followed by the request described by the |iovs_cnt| iovecs at
+ * |iovs|, at most KM_MAX_REQ_IOVS of them. If |wait| is false and the channel
+ * is full, returns TRUSTY_ERR_SEND_BLOCKED without sending.
+ */
+static int km_send_request_iovs(uint32_t cmd,
+                                const struct trusty_ipc_iovec* iovs,
+                                size_t iovs_cnt,
+                                bool wait) {
     struct keymaster_message header = {.cmd = cmd};
-    int num_iovecs = req ? 2 : 1;
+    struct trusty_ipc_iovec req_iovs[1 + KM_MAX_REQ_IOVS];
+    size_t i;
 
-    struct trusty_ipc_iovec req_iovs[2] = {
-            {.base = &header, .len = sizeof(header)},
-            {.base = (void*)req, .len = req_len},
-    };
+    if (iovs_cnt > KM_MAX_REQ_IOVS) {
+        return TRUSTY_ERR_INVALID_ARGS;
+    }
+    req_iovs[0].base = &header;
+    req_iovs[0].len = sizeof(header);
+    for (i = 0; i < iovs_cnt; i++) {
+        req_iovs[i + 1] = iovs[i];
+    }
 
-    return trusty_ipc_send(&km_chan, req_iovs, num_iovecs, true);
+    return trusty_ipc_send(&km_chan, req_iovs, iovs_cnt + 1, wait);
 }
 
 /* Checks that the command opcode in |header| matches |ex-ected_cmd|. Checks
@@ -79,11 +92,28 @@ static int check_response_error(uint32_t expected_cmd,
     return tipc_result;
 }
 
+/* Validates the header of each response frame, see check_response_error */
+static int km_check_frame(struct trusty_ipc_framer* framer, size_t frame_len) {
+    const uint32_t* expected_cmd = framer->priv;
+    const struct keymaster_message* header = framer->hdr;
+
+    return check_response_error(*expected_cmd, *header, (int32_t)frame_len);
+}
+
+static void km_framer_init(struct trusty_ipc_framer* framer,
+                           struct keymaster_message* header,
+                           uint32_t* expected_cmd) {
+    trusty_ipc_framer_init(framer, &km_chan, header, sizeof(*header),
+                           KEYMASTER_STOP_BIT, 0);
+    framer->check = km_check_frame;
+    framer->priv = expected_cmd;
+}
+
 /* Reads the raw response to |resp| up to a maximum size of |resp_len|. Format
  * of each message frame read from the secure side:
  *
  * command header : 4 bytes
- * opaque bytes   : MAX(KEYMASTER_MAX_BUFFER_LENGTH, x) bytes
+ * opaque bytes   : up to the transport's maximum message size
  *
  * The individual message frames from the secure side are reassembled
  * into |resp|, stripping each frame's command header. Returns the number
@@ -91,34 +121,14 @@ static int check_response_error(uint32_t expected_cmd,
  */
 static int km_read_raw_response(uint32_t cmd, void* resp, size_t resp_len) {
     struct keymaster_message header = {.cmd = cmd};
-    int rc = TRUSTY_ERR_GENERIC;
-    size_t max_resp_len = resp_len;
-    struct trusty_ipc_iovec resp_iovs[2] = {
-            {.base = &header, .len = sizeof(header)},
-            {.base = resp,
-             .len = MIN(KEYMASTER_MAX_BUFFER_LENGTH, max_resp_len)}};
+    struct trusty_ipc_framer framer;
+    struct trusty_ipc_iovec resp_iov = {.base = resp, .len = resp_len};
 
     if (!resp) {
         return TRUSTY_ERR_GENERIC;
     }
-    resp_len = 0;
-    while (true) {
-        resp_iovs[1].base = (uint8_t*)resp + resp_len;
-        resp_iovs[1].len = MIN(KEYMASTER_MAX_BUFFER_LENGTH,
-                               (int)max_resp_len - (int)resp_len);
-
-        rc = trusty_ipc_recv(&km_chan, resp_iovs, NELEMS(resp_iovs), true);
-        rc = check_response_error(cmd, header, rc);
-        if (rc < 0) {
-            return rc;
-        }
-        resp_len += ((size_t)rc - sizeof(struct keymaster_message));
-        if (header.cmd & KEYMASTER_STOP_BIT || resp_len >= max_resp_len) {
-            break;
-        }
-    }
-
-    return resp_len;
+    km_framer_init(&framer, &header, &cmd);
+    return trusty_ipc_framer_recv(&framer, &resp_iov, 1, true);
 }
 
 /* Reads a Keymaster Response message with a sized buffer. The format
@@ -129,7 +139,8 @@ static int km_read_raw_response(uint32_t cmd, void* resp, size_t resp_len) {
  * data length    : 4 bytes
  * data           : |data length| bytes
  *
- * On success, |error|, |resp_data|, and |resp_data_len| are filled
+ * The response may be split into several frames, each with its own command
+ * header. On success, |error|, |resp_data|, and |resp_data_len| are filled
  * successfully. Returns a trusty_err.
  */
 static int km_read_data_response(uint32_t cmd,
@@ -137,66 +148,42 @@ static int km_read_data_response(uint32_t cmd,
                                  uint8_t* resp_data,
                                  uint32_t* resp_data_len) {
     struct keymaster_message header = {.cmd = cmd};
+    struct trusty_ipc_framer framer;
+    uint32_t max_resp_len = *resp_data_len;
     int rc = TRUSTY_ERR_GENERIC;
-    size_t max_resp_len = *resp_data_len;
-    uint32_t resp_data_bytes = 0;
-    /* On the first read, recv the keymaster_message header, error code,
-     * response data length, and response data. On subsequent iterations,
-     * only recv the keymaster_message header and response data.
-     */
-    struct trusty_ipc_iovec resp_iovs[4] = {
-            {.base = &header, .len = sizeof(header)},
+    struct trusty_ipc_iovec resp_iovs[3] = {
             {.base = error, .len = sizeof(int32_t)},
             {.base = resp_data_len, .len = sizeof(uint32_t)},
-            {.base = resp_data,
-             .len = MIN(KEYMASTER_MAX_BUFFER_LENGTH, max_resp_len)}};
+            {.base = resp_data, .len = max_resp_len},
+    };
 
-    rc = trusty_ipc_recv(&km_chan, resp_iovs, NELEMS(resp_iovs), true);
-    rc = check_response_error(cmd, header, rc);
+    km_framer_init(&framer, &header, &cmd);
+    rc = trusty_ipc_framer_recv(&framer, resp_iovs, NELEMS(resp_iovs), true);
     if (rc < 0) {
         return rc;
     }
-    /* resp_data_bytes does not include the error or response data length */
-    resp_data_bytes += ((size_t)rc - sizeof(struct keymaster_message) -
-                        2 * sizeof(uint32_t));
-    if (header.cmd & KEYMASTER_STOP_BIT) {
-        return TRUSTY_ERR_NONE;
+    if ((size_t)rc >= sizeof(int32_t) && *error != KM_ERROR_OK) {
+        return TRUSTY_ERR_NONE; /* reported by the caller */
     }
-
-    /* Read the remaining response data */
-    uint8_t* resp_data_start = resp_data + resp_data_bytes;
-    size_t resp_data_remaining = *resp_data_len - resp_data_bytes;
-    rc = km_read_raw_response(cmd, resp_data_start, resp_data_remaining);
-    if (rc < 0) {
-        return rc;
-    }
-    resp_data_bytes += rc;
-    if (*resp_data_len != resp_data_bytes) {
+    /* the data length must match the data received */
+    if ((size_t)rc < 2 * sizeof(uint32_t) || *resp_data_len > max_resp_len ||
+        (size_t)rc - 2 * sizeof(uint32_t) != *resp_data_len) {
         return TRUSTY_ERR_GENERIC;
     }
     return TRUSTY_ERR_NONE;
 }
 
-/**
- * Convenience method to send a request to the secure side, handle rpmb
- * operations, and receive the response. If |resp_data| is not NULL, the
- * caller expects an additional data buffer to be returned from the secure
- * side.
+/*
+ * Reads the response to |cmd| and checks its keymaster error code. If
+ * |resp_data| is not NULL, the response carries an additional data buffer of
+ * up to |*resp_data_len| bytes, and |*resp_data_len| is set to its size.
  */
-static int km_do_tipc(uint32_t cmd,
-                      void* req,
-                      uint32_t req_len,
-                      void* resp_data,
-                      uint32_t* resp_data_len) {
-    int rc = TRUSTY_ERR_GENERIC;
+static int km_read_status(uint32_t cmd,
+                          void* resp_data,
+                          uint32_t* resp_data_len) {
+    int rc;
     struct km_no_response resp_header;
 
-    rc = km_send_request(cmd, req, req_len);
-    if (rc < 0) {
-        trusty_error("%s: failed (%d) to send km request\n", __func__, rc);
-        return rc;
-    }
-
     if (!resp_data) {
         rc = km_read_raw_response(cmd, &resp_header, sizeof(resp_header));
     } else {
@@ -216,6 +203,42 @@ static int km_do_tipc(uint32_t cmd,
     return TRUSTY_ERR_NONE;
 }
 
+/**
+ * Convenience method to send a request to the secure side, handle rpmb
+ * operations, and receive the response. The request is described by the
+ * |req_iovs_cnt| iovecs at |req_iovs|. If |resp_data| is not NULL, the
+ * caller expects an additional data buffer to be returned from the secure
+ * side.
+ */
+static int km_do_tipc_iovs(uint32_t cmd,
+                           const struct trusty_ipc_iovec* req_iovs,
+                           size_t req_iovs_cnt,
+                           void* resp_data,
+                           uint32_t* resp_data_len) {
+    int rc = km_send_request_iovs(cmd, req_iovs, req_iovs_cnt, true);
+
+    if (rc < 0) {
+        trusty_error("%s: failed (%d) to send km request\n", __func__, rc);
+        return rc;
+    }
+    return km_read_status(cmd, resp_data, resp_data_len);
+}
+
+/*
+ * Like km_do_tipc_iovs, for a request of |req_len| bytes at |req|, which may
+ * be NULL for commands without a request body.
+ */
+static int km_do_tipc(uint32_t cmd,
+                      void* req,
+                      uint32_t req_len,
+                      void* resp_data,
+                      uint32_t* resp_data_len) {
+    struct trusty_ipc_iovec req_iov = {.base = req, .len = req_len};
+
+    return km_do_tipc_iovs(cmd, &req_iov, req ? 1 : 0, resp_data,
+                           resp_data_len);
+}
+
 static int32_t MessageVersion(uint8_t major_ver,
                               uint8_t minor_ver,
                               uint8_t subminor_ver) {
@@ -241,16 +264,11 @@ static int32_t MessageVersion(uint8_t major_ver,
     return message_version;
 }
 
+/* Reads the response to the KM_GET_VERSION request sent on connect */
 static int km_get_version(int32_t* version) {
     int rc = TRUSTY_ERR_GENERIC;
     struct km_get_version_resp resp;
 
-    rc = km_send_request(KM_GET_VERSION, NULL, 0);
-    if (rc < 0) {
-        trusty_error("failed to send km version request", rc);
-        return rc;
-    }
-
     rc = km_read_raw_response(KM_GET_VERSION, &resp, sizeof(resp));
     if (rc < 0) {
         trusty_error("%s: failed (%d) to read km response\n", __func__, rc);
@@ -263,15 +281,43 @@ static int km_get_version(int32_t* version) {
 }
 
 int km_tipc_init(struct trusty_ipc_dev* dev) {
+    return km_tipc_init_handoff(dev, 0, NULL);
+}
+
+int km_tipc_init_handoff(struct trusty_ipc_dev* dev,
+                         uint64_t instance_id,
+                         struct trusty_version_handoff* handoff) {
     int rc = TRUSTY_ERR_GENERIC;
+    struct keymaster_message version_req = {.cmd = KM_GET_VERSION};
+    struct trusty_ipc_iovec version_iov = {
+            .base = &version_req,
+            .len = sizeof(version_req),
+    };
 
     trusty_assert(dev);
 
     trusty_ipc_chan_init(&km_chan, dev);
+
+    /* an earlier stage already checked the version of this instance */
+    if (handoff && instance_id && handoff->instance_id == instance_id &&
+        (int32_t)handoff->version >= trusty_km_version) {
+        trusty_debug("Connecting to Keymaster service, version %u known\n",
+                     handoff->version);
+        rc = trusty_ipc_connect(&km_chan, KEYMASTER_PORT, true);
+        if (rc < 0) {
+            trusty_error("failed (%d) to connect to '%s'\n", rc,
+                         KEYMASTER_PORT);
+            return rc;
+        }
+        initialized = true;
+        return TRUSTY_ERR_NONE;
+    }
+
     trusty_debug("Connecting to Keymaster service\n");
 
-    /* connect to km service and wait for connect to complete */
-    rc = trusty_ipc_connect(&km_chan, KEYMASTER_PORT, true);
+    /* connect to km service, asking for its version */
+    rc = trusty_ipc_connect_with_msg(&km_chan, KEYMASTER_PORT, &version_iov,
+                                     1);
     if (rc < 0) {
         trusty_error("failed (%d) to connect to '%s'\n", rc, KEYMASTER_PORT);
         return rc;
@@ -290,6 +336,10 @@ int km_tipc_init(struct trusty_ipc_dev* dev) {
         return TRUSTY_ERR_GENERIC;
     }
 
+    if (handoff) {
+        handoff->instance_id = instance_id;
+        handoff->version = (uint32_t)version;
+    }
     return TRUSTY_ERR_NONE;
 }
 
@@ -319,47 +369,92 @@ int trusty_set_boot_params(uint32_t os_version,
             .verified_boot_key_hash = verified_boot_key_hash,
             .verified_boot_hash_size = verified_boot_hash_size,
             .verified_boot_hash = verified_boot_hash};
-    uint8_t* req = NULL;
-    uint32_t req_size = 0;
-    int rc = km_boot_params_serialize(&params, &req, &req_size);
+    struct trusty_ipc_iovec req_iovs[KM_MAX_REQ_IOVS];
+    int rc = km_boot_params_to_iovecs(&params, req_iovs, NELEMS(req_iovs));
 
     if (rc < 0) {
         trusty_error("failed (%d) to serialize request\n", rc);
-        goto end;
+        return rc;
     }
-    rc = km_do_tipc(KM_SET_BOOT_PARAMS, req, req_size, NULL, NULL);
+    return km_do_tipc_iovs(KM_SET_BOOT_PARAMS, req_iovs, rc, NULL, NULL);
+}
 
-end:
-    if (req) {
-        trusty_free(req);
+static int km_send_attestation_data(uint32_t cmd,
+                                    const uint8_t* data,
+                                    uint32_t data_size,
+                                    keymaster_algorithm_t algorithm,
+                                    bool wait) {
+    struct km_attestation_data attestation_data = {
+            .algorithm = (uint32_t)algorithm,
+            .data_size = data_size,
+            .data = data,
+    };
+    struct trusty_ipc_iovec req_iovs[KM_MAX_REQ_IOVS];
+    int rc = km_attestation_data_to_iovecs(&attestation_data, req_iovs,
+                                           NELEMS(req_iovs));
+
+    if (rc < 0) {
+        trusty_error("failed (%d) to serialize request\n", rc);
+        return rc;
     }
-    return rc;
+    rc = km_send_request_iovs(cmd, req_iovs, rc, wait);
+    if (rc == TRUSTY_ERR_SEND_BLOCKED && !wait) {
+        return rc;
+    }
+    if (rc < 0) {
+        trusty_error("%s: failed (%d) to send km request\n", __func__, rc);
+        return rc;
+    }
+    return TRUSTY_ERR_NONE;
 }
 
 static int trusty_send_attestation_data(uint32_t cmd,
                                         const uint8_t* data,
                                         uint32_t data_size,
                                         keymaster_algorithm_t algorithm) {
-    struct km_attestation_data attestation_data = {
-            .algorithm = (uint32_t)algorithm,
-            .data_size = data_size,
-            .data = data,
+    int rc = km_send_attestation_data(cmd, data, data_size, algorithm, true);
+
+    if (rc < 0) {
+        return rc;
+    }
+    return km_read_status(cmd, NULL, NULL);
+}
+
+/*
+ * Returns the largest buffer one km_raw_buffer request can carry, given both
+ * the transport and the keymaster service message size limits.
+ */
+static uint32_t km_max_raw_buffer_size(void) {
+    size_t msg_size = MIN(trusty_ipc_dev_max_msg_size(km_chan.dev),
+                          KEYMASTER_MAX_BUFFER_LENGTH);
+
+    return msg_size - sizeof(struct keymaster_message) - sizeof(uint32_t);
+}
+
+static int km_send_raw_buffer(uint32_t cmd,
+                              const uint8_t* req_data,
+                              uint32_t req_data_size,
+                              bool wait) {
+    struct km_raw_buffer buf = {
+            .data_size = req_data_size,
+            .data = req_data,
     };
-    uint8_t* req = NULL;
-    uint32_t req_size = 0;
-    int rc = km_attestation_data_serialize(&attestation_data, &req, &req_size);
+    struct trusty_ipc_iovec req_iovs[KM_MAX_REQ_IOVS];
+    int rc = km_raw_buffer_to_iovecs(&buf, req_iovs, NELEMS(req_iovs));
 
     if (rc < 0) {
         trusty_error("failed (%d) to serialize request\n", rc);
-        goto end;
+        return rc;
     }
-    rc = km_do_tipc(cmd, req, req_size, NULL, NULL);
-
-end:
-    if (req) {
-        trusty_free(req);
+    rc = km_send_request_iovs(cmd, req_iovs, rc, wait);
+    if (rc == TRUSTY_ERR_SEND_BLOCKED && !wait) {
+        return rc;
     }
-    return rc;
+    if (rc < 0) {
+        trusty_error("%s: failed (%d) to send km request\n", __func__, rc);
+        return rc;
+    }
+    return TRUSTY_ERR_NONE;
 }
 
 static int trusty_send_raw_buffer(uint32_t cmd,
@@ -367,24 +462,77 @@ static int trusty_send_raw_buffer(uint32_t cmd,
                                   uint32_t req_data_size,
                                   uint8_t* resp_data,
                                   uint32_t* resp_data_size) {
-    struct km_raw_buffer buf = {
-            .data_size = req_data_size,
-            .data = req_data,
-    };
-    uint8_t* req = NULL;
-    uint32_t req_size = 0;
-    int rc = km_raw_buffer_serialize(&buf, &req, &req_size);
+    int rc = km_send_raw_buffer(cmd, req_data, req_data_size, true);
+
     if (rc < 0) {
-        trusty_error("failed (%d) to serialize request\n", rc);
-        goto end;
+        return rc;
     }
-    rc = km_do_tipc(cmd, req, req_size, resp_data, resp_data_size);
+    return km_read_status(cmd, resp_data, resp_data_size);
+}
 
-end:
-    if (req) {
-        trusty_free(req);
+/*
+ * Requests sent ahead of reading their responses.
+ *
+ * @cmds:      ring of the commands of the requests in flight
+ * @head:      index in @cmds of the oldest request
+ * @in_flight: number of requests whose response has not been read
+ * @status:    first error returned by a response
+ */
+struct km_pipeline {
+    uint32_t cmds[KM_PIPELINE_DEPTH];
+    size_t head;
+    size_t in_flight;
+    int status;
+};
+
+/* Reads the response to the oldest request in flight and records its error */
+static void km_pipeline_reap(struct km_pipeline* pipe) {
+    int rc = km_read_status(pipe->cmds[pipe->head], NULL, NULL);
+
+    pipe->head = (pipe->head + 1) % KM_PIPELINE_DEPTH;
+    pipe->in_flight--;
+    if (rc < 0 && pipe->status == TRUSTY_ERR_NONE) {
+        pipe->status = rc;
     }
-    return rc;
+}
+
+/* Makes room for one more request, reading a response if the ring is full */
+static void km_pipeline_reserve(struct km_pipeline* pipe) {
+    if (pipe->in_flight == KM_PIPELINE_DEPTH) {
+        km_pipeline_reap(pipe);
+    }
+}
+
+/* Records that a request for |cmd| has been sent */
+static void km_pipeline_push(struct km_pipeline* pipe, uint32_t cmd) {
+    pipe->cmds[(pipe->head + pipe->in_flight) % KM_PIPELINE_DEPTH] = cmd;
+    pipe->in_flight++;
+}
+
+/*
+ * Handles |send_rc| of a request sent without waiting while others are in
+ * flight. If the channel was full, reads the oldest response, which lets the
+ * secure side send the next one and so make room, and returns true to have
+ * the request sent again. A request sent with nothing in flight waits for
+ * room instead, as there is no response to read.
+ */
+static bool km_pipeline_blocked(struct km_pipeline* pipe, int send_rc) {
+    if (send_rc != TRUSTY_ERR_SEND_BLOCKED || !pipe->in_flight) {
+        return false;
+    }
+    km_pipeline_reap(pipe);
+    return true;
+}
+
+/*
+ * Reads the responses to all requests in flight. Returns |send_rc| if it is
+ * an error, otherwise the first error returned by a response.
+ */
+static int km_pipeline_drain(struct km_pipeline* pipe, int send_rc) {
+    while (pipe->in_flight) {
+        km_pipeline_reap(pipe);
+    }
+    return send_rc < 0 ? send_rc : pipe->status;
 }
 
 int trusty_set_attestation_key(const uint8_t* key,
@@ -401,29 +549,143 @@ int trusty_append_attestation_cert_chain(const uint8_t* cert,
                                         cert_size, algorithm);
 }
 
+int trusty_provision_attestation(
+        const struct trusty_attestation_keybox* keyboxes,
+        size_t keybox_count) {
+    const struct trusty_attestation_keybox* kb;
+    struct km_pipeline pipe = {0};
+    size_t i, j;
+    uint32_t cmd;
+    const uint8_t* data;
+    uint32_t data_size;
+    int rc = TRUSTY_ERR_NONE;
+
+    if (!keyboxes && keybox_count) {
+        return TRUSTY_ERR_INVALID_ARGS;
+    }
+
+    for (i = 0; i < keybox_count && rc == TRUSTY_ERR_NONE; i++) {
+        kb = &keyboxes[i];
+        if (kb->cert_count && !kb->certs) {
+            rc = TRUSTY_ERR_INVALID_ARGS;
+            break;
+        }
+        /* request 0 sets the key, the following ones append the certs */
+        for (j = 0; j <= kb->cert_count; j++) {
+            if (j == 0) {
+                cmd = KM_SET_ATTESTATION_KEY;
+                data = kb->key;
+                data_size = kb->key_size;
+            } else {
+                cmd = KM_APPEND_ATTESTATION_CERT_CHAIN;
+                data = kb->certs[j - 1].data;
+                data_size = kb->certs[j - 1].size;
+            }
+            km_pipeline_reserve(&pipe);
+            do {
+                rc = km_send_attestation_data(cmd, data, data_size,
+                                              kb->algorithm, !pipe.in_flight);
+            } while (km_pipeline_blocked(&pipe, rc));
+            if (rc < 0) {
+                break;
+            }
+            km_pipeline_push(&pipe, cmd);
+        }
+    }
+
+    return km_pipeline_drain(&pipe, rc);
+}
+
+/*
+ * Waits for the response to a request returning a sized buffer and reads its
+ * data length from the first frame, which stays queued to be read in full
+ * afterwards. |*data_len| is set to 0 for responses carrying an error or no
+ * data. Returns TRUSTY_ERR_NOT_SUPPORTED if the secure OS cannot receive part
+ * of a message, otherwise a trusty_err.
+ */
+static int km_peek_data_response_size(uint32_t* data_len) {
+    struct keymaster_message header;
+    int32_t error;
+    struct trusty_ipc_iovec iovs[3] = {
+            {.base = &header, .len = sizeof(header)},
+            {.base = &error, .len = sizeof(error)},
+            {.base = data_len, .len = sizeof(*data_len)},
+    };
+    size_t head_len = sizeof(header) + sizeof(error) + sizeof(*data_len);
+    int rc = trusty_ipc_peek_msg_size(&km_chan, true);
+
+    if (rc < 0) {
+        return rc;
+    }
+    *data_len = 0;
+    /* reading a frame up to its last byte would dequeue it */
+    if ((size_t)rc <= head_len) {
+        return TRUSTY_ERR_NONE;
+    }
+    rc = trusty_ipc_recv_at(&km_chan, 0, iovs, NELEMS(iovs), NULL);
+    if (rc < 0) {
+        return rc;
+    }
+    if ((size_t)rc != head_len || error != KM_ERROR_OK) {
+        *data_len = 0;
+    }
+    return TRUSTY_ERR_NONE;
+}
+
 int trusty_atap_get_ca_request(const uint8_t* operation_start,
                                uint32_t operation_start_size,
                                uint8_t** ca_request_p,
                                uint32_t* ca_request_size_p) {
-    *ca_request_p = trusty_calloc(1, kMaxCaRequestSize);
+    uint32_t size;
+    int rc = km_send_raw_buffer(KM_ATAP_GET_CA_REQUEST, operation_start,
+                                operation_start_size, true);
+
+    if (rc < 0) {
+        return rc;
+    }
+
+    /* size the buffer from the response, if the secure OS lets us peek */
+    rc = km_peek_data_response_size(&size);
+    if (rc == TRUSTY_ERR_NOT_SUPPORTED) {
+        size = kMaxCaRequestSize;
+    } else if (rc < 0) {
+        return rc;
+    } else if (size > kMaxCaRequestSize) {
+        trusty_error("%s: CA Request too big (%u)\n", __func__, size);
+        size = kMaxCaRequestSize;
+    }
+
+    *ca_request_p = trusty_calloc(1, size ? size : 1);
     if (!*ca_request_p) {
         return TRUSTY_ERR_NO_MEMORY;
     }
-    *ca_request_size_p = kMaxCaRequestSize;
-    int rc = trusty_send_raw_buffer(KM_ATAP_GET_CA_REQUEST, operation_start,
-                                    operation_start_size, *ca_request_p,
-                                    ca_request_size_p);
+    *ca_request_size_p = size;
+    rc = km_read_status(KM_ATAP_GET_CA_REQUEST, *ca_request_p,
+                        ca_request_size_p);
     if (rc != TRUSTY_ERR_NONE) {
         trusty_free(*ca_request_p);
     }
     return rc;
 }
 
+int trusty_atap_get_ca_request_buf(const uint8_t* operation_start,
+                                   uint32_t operation_start_size,
+                                   uint8_t* ca_request,
+                                   uint32_t* ca_request_size_p) {
+    if (!ca_request || !ca_request_size_p) {
+        return TRUSTY_ERR_INVALID_ARGS;
+    }
+    return trusty_send_raw_buffer(KM_ATAP_GET_CA_REQUEST, operation_start,
+                                  operation_start_size, ca_request,
+                                  ca_request_size_p);
+}
+
 int trusty_atap_set_ca_response(const uint8_t* ca_response,
                                 uint32_t ca_response_size) {
     struct km_set_ca_response_begin_req begin_req;
+    struct km_pipeline pipe = {0};
     int rc = TRUSTY_ERR_GENERIC;
-    uint32_t bytes_sent = 0, send_size = 0;
+    uint32_t bytes_sent = 0, send_size = 0, chunk_size;
 
     /* Tell the Trusty Keymaster TA the size of CA Response message */
     begin_req.ca_response_size = ca_response_size;
@@ -433,17 +695,29 @@ int trusty_atap_set_ca_response(const uint8_t* ca_response,
         return rc;
     }
 
-    /* Send the CA Response message in chunks */
+    /*
+     * Send the CA Response message straight from |ca_response| in chunks as
+     * large as a message can carry, several of them in flight at a time
+     */
+    chunk_size = km_max_raw_buffer_size();
     while (bytes_sent < ca_response_size) {
-        send_size = MIN(kMaxSendSize, ca_response_size - bytes_sent);
-        rc = trusty_send_raw_buffer(KM_ATAP_SET_CA_RESPONSE_UPDATE,
-                                    ca_response + bytes_sent, send_size, NULL,
-                                    NULL);
-        if (rc != TRUSTY_ERR_NONE) {
-            return rc;
+        send_size = MIN(chunk_size, ca_response_size - bytes_sent);
+        km_pipeline_reserve(&pipe);
+        do {
+            rc = km_send_raw_buffer(KM_ATAP_SET_CA_RESPONSE_UPDATE,
+                                    ca_response + bytes_sent, send_size,
+                                    !pipe.in_flight);
+        } while (km_pipeline_blocked(&pipe, rc));
+        if (rc < 0) {
+            break;
         }
+        km_pipeline_push(&pipe, KM_ATAP_SET_CA_RESPONSE_UPDATE);
         bytes_sent += send_size;
     }
+    rc = km_pipeline_drain(&pipe, rc);
+    if (rc != TRUSTY_ERR_NONE) {
+        return rc;
+    }
 
     /* Tell Trusty Keymaster to parse the CA Response message */
     return km_do_tipc(KM_ATAP_SET_CA_RESPONSE_FINISH, NULL, 0, NULL, NULL);
@@ -451,7 +725,10 @@ int trusty_atap_set_ca_response(const uint8_t* ca_response,
 
 int trusty_atap_read_uuid_str(char** uuid_p) {
     *uuid_p = (char*)trusty_calloc(1, kUuidSize + 1);
-    *uuid_p[kUuidSize] = '\0';
+    if (!*uuid_p) {
+        return TRUSTY_ERR_NO_MEMORY;
+    }
+    (*uuid_p)[kUuidSize] = '\0';
 
     uint32_t response_size = kUuidSize;
     int rc = km_do_tipc(KM_ATAP_READ_UUID, NULL, 0, *uuid_p, &response_size);
@@ -42,71 +42,106 @@ uint8_t* append_sized_buf_to_buf(uint8_t* buf,
     return append_to_buf(buf, data, data_len);
 }
 
-int km_boot_params_serialize(const struct km_boot_params* params,
-                             uint8_t** out,
-                             uint32_t* out_size) {
-    uint8_t* tmp;
+static const struct trusty_ipc_schema_field km_boot_params_fields[] = {
+        TRUSTY_IPC_SCHEMA_FIELD_U32(struct km_boot_params, os_version),
+        TRUSTY_IPC_SCHEMA_FIELD_U32(struct km_boot_params, os_patchlevel),
+        TRUSTY_IPC_SCHEMA_FIELD_U32(struct km_boot_params, device_locked),
+        TRUSTY_IPC_SCHEMA_FIELD_U32(struct km_boot_params,
+                                    verified_boot_state),
+        TRUSTY_IPC_SCHEMA_FIELD_BLOB(struct km_boot_params,
+                                     verified_boot_key_hash,
+                                     verified_boot_key_hash_size),
+        TRUSTY_IPC_SCHEMA_FIELD_BLOB(struct km_boot_params,
+                                     verified_boot_hash,
+                                     verified_boot_hash_size),
+};
+
+static const struct trusty_ipc_schema_field km_attestation_data_fields[] = {
+        TRUSTY_IPC_SCHEMA_FIELD_U32(struct km_attestation_data, algorithm),
+        TRUSTY_IPC_SCHEMA_FIELD_BLOB(struct km_attestation_data, data,
+                                     data_size),
+};
+
+static const struct trusty_ipc_schema_field km_raw_buffer_fields[] = {
+        TRUSTY_IPC_SCHEMA_FIELD_BLOB(struct km_raw_buffer, data, data_size),
+};
+
+const struct trusty_ipc_schema km_boot_params_schema =
+        TRUSTY_IPC_SCHEMA(km_boot_params_fields);
+const struct trusty_ipc_schema km_attestation_data_schema =
+        TRUSTY_IPC_SCHEMA(km_attestation_data_fields);
+const struct trusty_ipc_schema km_raw_buffer_schema =
+        TRUSTY_IPC_SCHEMA(km_raw_buffer_fields);
 
-    if (!out || !params || !out_size) {
+/*
+ * Allocates |*out_size| bytes to |*out| and encodes |obj| into it according
+ * to |schema|.
+ */
+static int km_serialize(const struct trusty_ipc_schema* schema,
+                        const void* obj,
+                        uint8_t** out,
+                        uint32_t* out_size) {
+    int rc;
+
+    if (!out || !obj || !out_size) {
         return TRUSTY_ERR_INVALID_ARGS;
     }
-    *out_size = (sizeof(params->os_version) + sizeof(params->os_patchlevel) +
-                 sizeof(params->device_locked) +
-                 sizeof(params->verified_boot_state) +
-                 sizeof(params->verified_boot_key_hash_size) +
-                 sizeof(params->verified_boot_hash_size) +
-                 params->verified_boot_key_hash_size +
-                 params->verified_boot_hash_size);
+    *out_size = trusty_ipc_schema_size(schema, obj);
     *out = trusty_calloc(*out_size, 1);
     if (!*out) {
         return TRUSTY_ERR_NO_MEMORY;
     }
-
-    tmp = append_uint32_to_buf(*out, params->os_version);
-    tmp = append_uint32_to_buf(tmp, params->os_patchlevel);
-    tmp = append_uint32_to_buf(tmp, params->device_locked);
-    tmp = append_uint32_to_buf(tmp, params->verified_boot_state);
-    tmp = append_sized_buf_to_buf(tmp, params->verified_boot_key_hash,
-                                  params->verified_boot_key_hash_size);
-    tmp = append_sized_buf_to_buf(tmp, params->verified_boot_hash,
-                                  params->verified_boot_hash_size);
-
+    rc = trusty_ipc_schema_encode(schema, obj, *out, *out_size);
+    if (rc < 0) {
+        trusty_free(*out);
+        *out = NULL;
+        return rc;
+    }
     return TRUSTY_ERR_NONE;
 }
 
-int km_attestation_data_serialize(const struct km_attestation_data* data,
-                                  uint8_t** out,
-                                  uint32_t* out_size) {
-    uint8_t* tmp;
-
-    if (!out || !data || !out_size) {
+static int km_to_iovecs(const struct trusty_ipc_schema* schema,
+                        const void* obj,
+                        struct trusty_ipc_iovec* iovs,
+                        size_t iovs_cnt) {
+    if (!obj || !iovs || iovs_cnt < KM_MAX_REQ_IOVS) {
         return TRUSTY_ERR_INVALID_ARGS;
     }
-    *out_size = (sizeof(data->algorithm) + sizeof(data->data_size) +
-                 data->data_size);
-    *out = trusty_calloc(*out_size, 1);
-    if (!*out) {
-        return TRUSTY_ERR_NO_MEMORY;
-    }
+    return trusty_ipc_schema_to_iovecs(schema, obj, iovs, iovs_cnt);
+}
 
-    tmp = append_uint32_to_buf(*out, data->algorithm);
-    tmp = append_sized_buf_to_buf(tmp, data->data, data->data_size);
+int km_boot_params_serialize(const struct km_boot_params* params,
+                             uint8_t** out,
+                             uint32_t* out_size) {
+    return km_serialize(&km_boot_params_schema, params, out, out_size);
+}
 
-    return TRUSTY_ERR_NONE;
+int km_attestation_data_serialize(const struct km_attestation_data* data,
+                                  uint8_t** out,
+                                  uint32_t* out_size) {
+    return km_serialize(&km_attestation_data_schema, data, out, out_size);
 }
 
 int km_raw_buffer_serialize(const struct km_raw_buffer* buf,
                             uint8_t** out,
                             uint32_t* out_size) {
-    if (!out || !buf || !out_size) {
-        return TRUSTY_ERR_INVALID_ARGS;
-    }
-    *out_size = sizeof(buf->data_size) + buf->data_size;
-    *out = trusty_calloc(*out_size, 1);
-    if (!*out) {
-        return TRUSTY_ERR_NO_MEMORY;
-    }
-    append_sized_buf_to_buf(*out, buf->data, buf->data_size);
+    return km_serialize(&km_raw_buffer_schema, buf, out, out_size);
+}
 
-    return TRUSTY_ERR_NONE;
+int km_boot_params_to_iovecs(const struct km_boot_params* params,
+                             struct trusty_ipc_iovec* iovs,
+                             size_t iovs_cnt) {
+    return km_to_iovecs(&km_boot_params_schema, params, iovs, iovs_cnt);
+}
+
+int km_attestation_data_to_iovecs(const struct km_attestation_data* data,
+                                  struct trusty_ipc_iovec* iovs,
+                                  size_t iovs_cnt) {
+    return km_to_iovecs(&km_attestation_data_schema, data, iovs, iovs_cnt);
+}
+
+int km_raw_buffer_to_iovecs(const struct km_raw_buffer* buf,
+                            struct trusty_ipc_iovec* iovs,
+                            size_t iovs_cnt) {
+    return km_to_iovecs(&km_raw_buffer_schema, buf, iovs, iovs_cnt);
 }
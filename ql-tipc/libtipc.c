@@ -24,6 +24,7 @@
 
 #include <trusty/avb.h>
 #include <trusty/keymaster.h>
+#include <trusty/libtipc.h>
 #include <trusty/rpmb.h>
 #include <trusty/trusty_dev.h>
 #include <trusty/trusty_ipc.h>
@@ -31,6 +32,15 @@
 
 #define LOCAL_LOG 0
 
+/*
+ * Size of the buffer shared with the secure side, a multiple of PAGE_SIZE. It
+ * limits the size of messages, including how many frames the RPMB storage
+ * proxy reads in one request.
+ */
+#ifndef TRUSTY_IPC_SHARED_BUF_SIZE
+#define TRUSTY_IPC_SHARED_BUF_SIZE PAGE_SIZE
+#endif
+
 typedef uintptr_t vaddr_t;
 
 static struct trusty_ipc_dev* _ipc_dev;
@@ -42,7 +52,7 @@ void trusty_ipc_shutdown(void) {
     (void)rpmb_storage_put_ctx(rpmb_ctx);
 
     (void)avb_tipc_shutdown(_ipc_dev);
-    (void)km_tipc_shutdown(_ipc_dev);
+    km_tipc_shutdown();
 
     /* shutdown Trusty IPC device */
     (void)trusty_ipc_dev_shutdown(_ipc_dev);
@@ -52,7 +62,13 @@ void trusty_ipc_shutdown(void) {
 }
 
 int trusty_ipc_init(void) {
+    return trusty_ipc_init_handoff(NULL);
+}
+
+int trusty_ipc_init_handoff(struct trusty_ipc_handoff* handoff) {
     int rc;
+    uint64_t instance_id = 0;
+
     /* init Trusty device */
     trusty_info("Initializing Trusty device\n");
     rc = trusty_dev_init(&_tdev, NULL);
@@ -63,12 +79,23 @@ int trusty_ipc_init(void) {
 
     /* create Trusty IPC device */
     trusty_info("Initializing Trusty IPC device\n");
-    rc = trusty_ipc_dev_create(&_ipc_dev, &_tdev, PAGE_SIZE);
+    rc = trusty_ipc_dev_create(&_ipc_dev, &_tdev, TRUSTY_IPC_SHARED_BUF_SIZE);
     if (rc != 0) {
         trusty_error("Initializing Trusty IPC device failed (%d)\n", rc);
         return rc;
     }
 
+    /*
+     * Results handed over from another instance must not be used. If the
+     * secure OS takes a message with the connect, the handshakes ride on it
+     * and a handoff would not save any calls, so the instance is not probed.
+     */
+    if (handoff && !trusty_ipc_dev_has_connect_with_msg(_ipc_dev) &&
+        trusty_dev_get_instance_id(&_tdev, &instance_id) < 0) {
+        trusty_info("Trusty instance unknown, checking service versions\n");
+        instance_id = 0;
+    }
+
     /* get storage rpmb */
     rpmb_ctx = rpmb_storage_get_ctx();
 
@@ -82,14 +109,16 @@ int trusty_ipc_init(void) {
     }
 
     trusty_info("Initializing Trusty AVB client\n");
-    rc = avb_tipc_init(_ipc_dev);
+    rc = avb_tipc_init_handoff(_ipc_dev, instance_id,
+                               handoff ? &handoff->avb : NULL);
     if (rc != 0) {
         trusty_error("Initlializing Trusty AVB client failed (%d)\n", rc);
         return rc;
     }
 
     trusty_info("Initializing Trusty Keymaster client\n");
-    rc = km_tipc_init(_ipc_dev);
+    rc = km_tipc_init_handoff(_ipc_dev, instance_id,
+                              handoff ? &handoff->km : NULL);
     if (rc != 0) {
         trusty_error("Initlializing Trusty Keymaster client failed (%d)\n", rc);
         return rc;
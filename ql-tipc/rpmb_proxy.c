@@ -29,176 +29,428 @@
 
 #define LOCAL_LOG 0
 
-static bool initialized;
-/* Address of rpmb device */
-static void* proxy_rpmb;
-struct trusty_ipc_chan proxy_chan;
+#ifndef RPMB_PROXY_BATCH_MAX
+#define RPMB_PROXY_BATCH_MAX 16
+#endif
+
+#ifndef RPMB_PROXY_BATCH_SIZE
+#define RPMB_PROXY_BATCH_SIZE 8192
+#endif
+
+/*
+ * RPMB requests sent with STORAGE_MSG_FLAG_BATCH. They are not answered, but
+ * queued and executed together with the request that ends the batch, which
+ * gets the cumulative result.
+ *
+ * With TIPC_ENABLE_RPMB_ASYNC, queued requests are started right away, so
+ * the device works on them while the proxy receives the rest of the batch.
+ * The proxy waits for them when the batch ends, before a request with
+ * STORAGE_MSG_FLAG_PRE_COMMIT and after a request with
+ * STORAGE_MSG_FLAG_POST_COMMIT. Requests outside a batch are always executed
+ * before they are answered.
+ *
+ * @buf:     RPMB_PROXY_BATCH_SIZE bytes holding the frames of the queued
+ *           requests, allocated on first use
+ * @used:    bytes of @buf in use
+ * @count:   number of queued requests
+ * @started: number of queued requests started with rpmb_storage_send_async
+ * @result:  first error of the batch, one of enum storage_err
+ * @cmds:    queued requests
+ */
+struct rpmb_proxy_batch {
+    uint8_t* buf;
+    size_t used;
+    size_t count;
+    size_t started;
+    int32_t result;
+    struct rpmb_storage_cmd cmds[RPMB_PROXY_BATCH_MAX];
+};
+
+/*
+ * RPMB storage proxy, serving the storage service at one port with one RPMB
+ * device.
+ *
+ * @chan:     proxy ipc channel
+ * @rpmb_dev: context of the RPMB device, see rpmb_storage_get_ctx
+ * @batch:    requests received but not completed
+ */
+struct rpmb_storage_proxy {
+    struct trusty_ipc_chan chan;
+    void* rpmb_dev;
+    struct rpmb_proxy_batch batch;
+};
 
-struct storage_msg req_msg;
-static uint8_t req_buf[4096];
-static uint8_t read_buf[4096];
+/* Proxy of rpmb_storage_proxy_init */
+static bool initialized;
+static struct rpmb_storage_proxy default_proxy;
 
 /*
- * Read RPMB request from storage service. Writes message to @msg
- * and @req.
+ * Read RPMB request from storage service. Points @msg at the message, which
+ * stays in the shared buffer of the IPC device and is where the response is
+ * built.
  *
  * @chan:    proxy ipc channel
- * @msg:     address of storage message header
- * @req:     address of storage message request
- * @req_len: length of req in bytes
+ * @msg:     set to the address of storage message header
  */
 static int proxy_read_request(struct trusty_ipc_chan* chan,
-                              struct storage_msg* msg,
-                              void* req,
-                              size_t req_len) {
+                              struct storage_msg** msg) {
     int rc;
+    void* buf;
 
-    struct trusty_ipc_iovec req_iovs[2] = {
-            {.base = msg, .len = sizeof(*msg)},
-            {.base = req, .len = req_len},
-    };
-    rc = trusty_ipc_recv(chan, req_iovs, 2, false);
+    rc = trusty_ipc_recv_borrow(chan, &buf, false);
     if (rc < 0) {
         /* recv message failed */
         trusty_error("%s: failed (%d) to recv request\n", __func__, rc);
         return rc;
     }
 
-    if ((size_t)rc < sizeof(*msg)) {
+    if ((size_t)rc < sizeof(**msg)) {
         /* malformed message */
         trusty_error("%s: malformed request (%zu)\n", __func__, (size_t)rc);
         return TRUSTY_ERR_GENERIC;
     }
 
-    return rc - sizeof(*msg); /* return payload size */
+    *msg = buf;
+    return rc - sizeof(**msg); /* return payload size */
 }
 
 /*
- * Send RPMB response to storage service
+ * Send RPMB response to storage service. The response is built in place of
+ * the request.
  *
  * @chan:     proxy ipc channel
- * @msg:      address of storage message header
- * @resp:     address of storage message response
- * @resp_len: length of resp in bytes
+ * @msg:      address of storage message header, from proxy_read_request
+ * @resp_len: length of the response following @msg in bytes
  */
 static int proxy_send_response(struct trusty_ipc_chan* chan,
                                struct storage_msg* msg,
-                               void* resp,
                                size_t resp_len) {
-    struct trusty_ipc_iovec resp_iovs[2] = {{.base = msg, .len = sizeof(*msg)},
-                                            {.base = resp, .len = resp_len}};
-
     msg->cmd |= STORAGE_RESP_BIT;
-    return trusty_ipc_send(chan, resp_iovs, resp ? 2 : 1, false);
+    return trusty_ipc_send_in_place(chan, sizeof(*msg) + resp_len);
 }
 
 /*
- * Executes the RPMB request at @r, sends response to storage service.
+ * Checks the RPMB request at @r and points @cmd at its frames. The frames read
+ * go to the response payload, on top of the request: rpmb_storage_send only
+ * writes them once it has sent the frames to write. Returns one of enum
+ * storage_err.
  *
- * @chan:    proxy ipc channel
- * @msg:     address of storage message header
- * @r:       address of storage message request
- * @req_len: length of resp in bytes
+ * @msg:      address of storage message header
+ * @r:        address of storage message request
+ * @req_len:  length of req in bytes
+ * @max_read: room for the response payload
+ * @cmd:      RPMB command to fill in
  */
-static int proxy_handle_rpmb(struct trusty_ipc_chan* chan,
-                             struct storage_msg* msg,
-                             const void* r,
-                             size_t req_len) {
-    int rc;
+static int32_t proxy_parse_rpmb(struct storage_msg* msg,
+                                const void* r,
+                                size_t req_len,
+                                size_t max_read,
+                                struct rpmb_storage_cmd* cmd) {
     size_t exp_len;
-    const void* write_data = NULL;
-    const void* rel_write_data = NULL;
-    const struct storage_rpmb_send_req* req = r;
+    struct storage_rpmb_send_req hdr;
+    const struct storage_rpmb_send_req* req = &hdr;
 
-    if (req_len < sizeof(req)) {
-        msg->result = STORAGE_ERR_NOT_VALID;
-        goto err_response;
+    if (req_len < sizeof(*req)) {
+        return STORAGE_ERR_NOT_VALID;
     }
+    /* the sizes are checked once, on a copy */
+    trusty_memcpy(&hdr, r, sizeof(hdr));
 
     exp_len = sizeof(*req) + req->reliable_write_size + req->write_size;
     if (req_len != exp_len) {
         trusty_error(
                 "%s: malformed rpmb request: invalid length (%zu != %zu)\n",
                 __func__, req_len, exp_len);
-        msg->result = STORAGE_ERR_NOT_VALID;
-        goto err_response;
+        return STORAGE_ERR_NOT_VALID;
     }
 
+    trusty_memset(cmd, 0, sizeof(*cmd));
+
     if (req->reliable_write_size) {
         if ((req->reliable_write_size % MMC_BLOCK_SIZE) != 0) {
             trusty_error("%s: invalid reliable write size %u\n", __func__,
                          req->reliable_write_size);
-            msg->result = STORAGE_ERR_NOT_VALID;
-            goto err_response;
+            return STORAGE_ERR_NOT_VALID;
         }
-        rel_write_data = req->payload;
+        cmd->reliable_write_data = (const uint8_t*)r + sizeof(*req);
+        cmd->reliable_write_size = req->reliable_write_size;
     }
 
     if (req->write_size) {
         if ((req->write_size % MMC_BLOCK_SIZE) != 0) {
             trusty_error("%s: invalid write size %u\n", __func__,
                          req->write_size);
-            msg->result = STORAGE_ERR_NOT_VALID;
-            goto err_response;
+            return STORAGE_ERR_NOT_VALID;
         }
-        write_data = req->payload + req->reliable_write_size;
+        cmd->write_data =
+                (const uint8_t*)r + sizeof(*req) + req->reliable_write_size;
+        cmd->write_size = req->write_size;
     }
 
     if (req->read_size) {
         if (req->read_size % MMC_BLOCK_SIZE != 0 ||
-            req->read_size > sizeof(read_buf)) {
+            req->read_size > max_read) {
             trusty_error("%s: invalid read size %u\n", __func__,
                          req->read_size);
-            msg->result = STORAGE_ERR_NOT_VALID;
-            goto err_response;
+            return STORAGE_ERR_NOT_VALID;
         }
+        cmd->read_buf = msg->payload;
+        cmd->read_size = req->read_size;
     }
 
-    /* execute rpmb command */
-    rc = rpmb_storage_send(proxy_rpmb, rel_write_data, req->reliable_write_size,
-                           write_data, req->write_size, read_buf,
-                           req->read_size);
+    return STORAGE_NO_ERROR;
+}
+
+/*
+ * Executes @count RPMB commands in order, after the commands started before.
+ * Returns one of trusty_err.
+ */
+static int proxy_send_rpmb(struct rpmb_storage_proxy* proxy,
+                           const struct rpmb_storage_cmd* cmds,
+                           size_t count) {
+#if defined(TIPC_ENABLE_RPMB_ASYNC)
+    int rc = TRUSTY_ERR_NONE;
+    int wait_rc;
+
+    if (count) {
+        rc = rpmb_storage_send_async(proxy->rpmb_dev, cmds, count);
+    }
+    wait_rc = rpmb_storage_wait(proxy->rpmb_dev);
+    return rc ? rc : wait_rc;
+#elif defined(TIPC_ENABLE_RPMB_MULTI_CMD)
+    return rpmb_storage_send_multi(proxy->rpmb_dev, cmds, count);
+#else
+    int rc;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        rc = rpmb_storage_send(proxy->rpmb_dev, cmds[i].reliable_write_data,
+                               cmds[i].reliable_write_size, cmds[i].write_data,
+                               cmds[i].write_size, cmds[i].read_buf,
+                               cmds[i].read_size);
+        if (rc) {
+            return rc;
+        }
+    }
+    return TRUSTY_ERR_NONE;
+#endif
+}
+
+/*
+ * Records the first error of the current batch
+ */
+static void proxy_batch_fail(struct rpmb_storage_proxy* proxy,
+                             int32_t result) {
+    struct rpmb_proxy_batch* batch = &proxy->batch;
+
+    if (batch->result == STORAGE_NO_ERROR) {
+        batch->result = result;
+    }
+}
+
+/*
+ * Executes the queued requests of the current batch, followed by @cmd if it
+ * is not NULL, and waits for all of them.
+ */
+static void proxy_batch_flush(struct rpmb_storage_proxy* proxy,
+                              const struct rpmb_storage_cmd* cmd) {
+    int rc = TRUSTY_ERR_NONE;
+    struct rpmb_proxy_batch* batch = &proxy->batch;
+
+    if (cmd && batch->count < RPMB_PROXY_BATCH_MAX) {
+        /* one sequence for the whole batch */
+        batch->cmds[batch->count++] = *cmd;
+        cmd = NULL;
+    }
+    if (batch->count) {
+        rc = proxy_send_rpmb(proxy, batch->cmds + batch->started,
+                             batch->count - batch->started);
+    }
+    if (!rc && cmd) {
+        rc = proxy_send_rpmb(proxy, cmd, 1);
+    }
     if (rc) {
         trusty_error("%s: rpmb_storage_send failed: %d\n", __func__, rc);
-        msg->result = STORAGE_ERR_GENERIC;
-        goto err_response;
+        proxy_batch_fail(proxy, STORAGE_ERR_GENERIC);
+    }
+    batch->count = 0;
+    batch->started = 0;
+    batch->used = 0;
+}
+
+#ifdef TIPC_ENABLE_RPMB_ASYNC
+/*
+ * Starts the queued requests that were not started yet. The device works on
+ * them while the proxy goes back to the storage service.
+ */
+static void proxy_batch_start(struct rpmb_storage_proxy* proxy) {
+    int rc;
+    struct rpmb_proxy_batch* batch = &proxy->batch;
+
+    if (batch->started == batch->count) {
+        return;
+    }
+    rc = rpmb_storage_send_async(proxy->rpmb_dev, batch->cmds + batch->started,
+                                 batch->count - batch->started);
+    if (rc) {
+        trusty_error("%s: rpmb_storage_send_async failed: %d\n", __func__,
+                     rc);
+        proxy_batch_fail(proxy, STORAGE_ERR_GENERIC);
     }
+    batch->started = batch->count;
+}
+#endif
+
+/*
+ * Waits for the requests the device is still working on
+ */
+static void proxy_batch_wait(struct rpmb_storage_proxy* proxy) {
+    struct rpmb_proxy_batch* batch = &proxy->batch;
 
-    if (msg->flags & STORAGE_MSG_FLAG_POST_COMMIT) {
-        /*
-         * Nothing todo for post msg commit request as MMC_IOC_MULTI_CMD
-         * is fully synchronous in this implementation.
-         */
+    if (batch->started) {
+        proxy_batch_flush(proxy, NULL);
     }
+}
 
-    msg->result = STORAGE_NO_ERROR;
-    return proxy_send_response(chan, msg, read_buf, req->read_size);
+/*
+ * Queues batched RPMB command @cmd, whose frames are in the shared buffer.
+ * Executes it right away if it does not fit the batch buffer.
+ */
+static void proxy_batch_queue(struct rpmb_storage_proxy* proxy,
+                              const struct rpmb_storage_cmd* cmd) {
+    struct rpmb_storage_cmd* q;
+    size_t size = cmd->reliable_write_size + cmd->write_size + cmd->read_size;
+    struct rpmb_proxy_batch* batch = &proxy->batch;
+
+    if (!batch->buf) {
+        batch->buf = trusty_calloc(1, RPMB_PROXY_BATCH_SIZE);
+    }
+    if (batch->count == RPMB_PROXY_BATCH_MAX ||
+        batch->used + size > RPMB_PROXY_BATCH_SIZE) {
+        proxy_batch_flush(proxy, NULL);
+    }
+    if (!batch->buf || size > RPMB_PROXY_BATCH_SIZE) {
+        /* nobody reads the frames read for a batched request */
+        proxy_batch_flush(proxy, cmd);
+        return;
+    }
 
-err_response:
-    return proxy_send_response(chan, msg, NULL, 0);
+    q = &batch->cmds[batch->count++];
+    *q = *cmd;
+    if (cmd->reliable_write_size) {
+        q->reliable_write_data = batch->buf + batch->used;
+        trusty_memcpy(batch->buf + batch->used, cmd->reliable_write_data,
+                      cmd->reliable_write_size);
+        batch->used += cmd->reliable_write_size;
+    }
+    if (cmd->write_size) {
+        q->write_data = batch->buf + batch->used;
+        trusty_memcpy(batch->buf + batch->used, cmd->write_data,
+                      cmd->write_size);
+        batch->used += cmd->write_size;
+    }
+    if (cmd->read_size) {
+        q->read_buf = batch->buf + batch->used;
+        batch->used += cmd->read_size;
+    }
+#ifdef TIPC_ENABLE_RPMB_ASYNC
+    proxy_batch_start(proxy);
+#endif
+}
+
+/*
+ * Ends the current batch, if any: executes its queued requests and merges its
+ * result into @msg.
+ */
+static void proxy_batch_end(struct rpmb_storage_proxy* proxy,
+                            struct storage_msg* msg) {
+    struct rpmb_proxy_batch* batch = &proxy->batch;
+
+    if (batch->count) {
+        proxy_batch_flush(proxy, NULL);
+    }
+    if (batch->result != STORAGE_NO_ERROR) {
+        msg->result = batch->result;
+        batch->result = STORAGE_NO_ERROR;
+    }
+}
+
+/*
+ * Executes the RPMB request at @r, sends response to storage service. Batched
+ * requests are queued instead and not answered.
+ *
+ * @proxy:   RPMB storage proxy
+ * @msg:     address of storage message header
+ * @r:       address of storage message request
+ * @req_len: length of resp in bytes
+ */
+static int proxy_handle_rpmb(struct rpmb_storage_proxy* proxy,
+                             struct storage_msg* msg,
+                             const void* r,
+                             size_t req_len) {
+    struct trusty_ipc_chan* chan = &proxy->chan;
+    struct rpmb_storage_cmd cmd;
+    struct rpmb_proxy_batch* batch = &proxy->batch;
+    /*
+     * Requests and responses stay in the shared buffer of the IPC device, so
+     * its size is all that limits reads: e.g. 7 frames with one page, 15
+     * with two.
+     */
+    size_t max_read = trusty_ipc_dev_max_msg_size(chan->dev) - sizeof(*msg);
+
+    msg->result = proxy_parse_rpmb(msg, r, req_len, max_read, &cmd);
+
+    if (msg->flags & STORAGE_MSG_FLAG_BATCH) {
+        if (msg->result != STORAGE_NO_ERROR) {
+            proxy_batch_fail(proxy, msg->result);
+        } else if (batch->result == STORAGE_NO_ERROR) {
+            proxy_batch_queue(proxy, &cmd);
+        }
+        if (msg->flags & STORAGE_MSG_FLAG_POST_COMMIT) {
+            proxy_batch_wait(proxy);
+        }
+        return TRUSTY_ERR_NONE;
+    }
+
+    if (msg->result == STORAGE_NO_ERROR &&
+        batch->result == STORAGE_NO_ERROR) {
+        /* execute rpmb command, after the batch it ends */
+        proxy_batch_flush(proxy, &cmd);
+    }
+    /*
+     * This also completes a post msg commit request: nothing executed for it
+     * is left running.
+     */
+    proxy_batch_end(proxy, msg);
+
+    if (msg->result != STORAGE_NO_ERROR) {
+        return proxy_send_response(chan, msg, 0);
+    }
+    return proxy_send_response(chan, msg, cmd.read_size);
 }
 
 /*
  * Handles storage request.
  *
- * @chan:    proxy ipc channel
+ * @proxy:   RPMB storage proxy
  * @msg:     address of storage message header
  * @req:     address of storage message request
  * @req_len: length of resp in bytes
  */
-static int proxy_handle_req(struct trusty_ipc_chan* chan,
+static int proxy_handle_req(struct rpmb_storage_proxy* proxy,
                             struct storage_msg* msg,
                             const void* req,
                             size_t req_len) {
     int rc;
 
     if (msg->flags & STORAGE_MSG_FLAG_PRE_COMMIT) {
-        /* nothing to do */
+        /* complete the requests the device is still working on */
+        proxy_batch_wait(proxy);
     }
 
     switch (msg->cmd) {
     case STORAGE_RPMB_SEND:
-        rc = proxy_handle_rpmb(chan, msg, req, req_len);
+        rc = proxy_handle_rpmb(proxy, msg, req, req_len);
         break;
 
     case STORAGE_FILE_DELETE:
@@ -209,13 +461,15 @@ static int proxy_handle_req(struct trusty_ipc_chan* chan,
     case STORAGE_FILE_GET_SIZE:
     case STORAGE_FILE_SET_SIZE:
         /* Bulk filesystem is not supported */
-        msg->result = STORAGE_ERR_UNIMPLEMENTED;
-        rc = proxy_send_response(chan, msg, NULL, 0);
-        break;
-
     default:
+        if (msg->flags & STORAGE_MSG_FLAG_BATCH) {
+            proxy_batch_fail(proxy, STORAGE_ERR_UNIMPLEMENTED);
+            rc = TRUSTY_ERR_NONE;
+            break;
+        }
         msg->result = STORAGE_ERR_UNIMPLEMENTED;
-        rc = proxy_send_response(chan, msg, NULL, 0);
+        proxy_batch_end(proxy, msg);
+        rc = proxy_send_response(&proxy->chan, msg, 0);
     }
 
     return rc;
@@ -241,11 +495,14 @@ static int proxy_on_disconnect(struct trusty_ipc_chan* chan) {
  */
 static int proxy_on_message(struct trusty_ipc_chan* chan) {
     int rc;
+    struct storage_msg* msg;
+    struct rpmb_storage_proxy* proxy;
 
     trusty_assert(chan);
+    proxy = chan->ops_ctx;
 
     /* read request */
-    rc = proxy_read_request(chan, &req_msg, req_buf, sizeof(req_buf));
+    rc = proxy_read_request(chan, &msg);
     if (rc < 0) {
         trusty_error("%s: failed (%d) to read request\n", __func__, rc);
         trusty_ipc_close(chan);
@@ -253,7 +510,7 @@ static int proxy_on_message(struct trusty_ipc_chan* chan) {
     }
 
     /* handle it and send reply */
-    rc = proxy_handle_req(chan, &req_msg, req_buf, rc);
+    rc = proxy_handle_req(proxy, msg, msg->payload, rc);
     if (rc < 0) {
         trusty_error("%s: failed (%d) to handle request\n", __func__, rc);
         trusty_ipc_close(chan);
@@ -269,45 +526,124 @@ static struct trusty_ipc_ops proxy_ops = {
 };
 
 /*
- * Initialize RPMB storage proxy
+ * Disconnects @proxy from the storage service
  */
-int rpmb_storage_proxy_init(struct trusty_ipc_dev* dev, void* rpmb_dev) {
-    int rc;
+static void proxy_stop(struct rpmb_storage_proxy* proxy) {
+    struct rpmb_proxy_batch* batch = &proxy->batch;
 
-    trusty_assert(dev);
-    trusty_assert(!initialized);
+    /* close channel */
+    if (proxy->chan.handle != INVALID_IPC_HANDLE) {
+        trusty_ipc_close(&proxy->chan);
+    }
+
+    /* an unfinished batch is dropped, once the device is done with it */
+#ifdef TIPC_ENABLE_RPMB_ASYNC
+    if (batch->started) {
+        rpmb_storage_wait(proxy->rpmb_dev);
+    }
+#endif
+    trusty_free(batch->buf);
+    trusty_memset(batch, 0, sizeof(*batch));
+}
+
+/*
+ * Connects @proxy to the storage service at @port and handles the requests
+ * that are already waiting.
+ */
+static int proxy_start(struct rpmb_storage_proxy* proxy,
+                       struct trusty_ipc_dev* dev,
+                       void* rpmb_dev,
+                       const char* port) {
+    int rc;
 
     /* attach rpmb device  */
-    proxy_rpmb = rpmb_dev;
+    proxy->rpmb_dev = rpmb_dev;
 
     /* init ipc channel */
-    trusty_ipc_chan_init(&proxy_chan, dev);
+    trusty_ipc_chan_init(&proxy->chan, dev);
 
     /* connect to proxy service and wait for connect to complete */
-    rc = trusty_ipc_connect(&proxy_chan, STORAGE_DISK_PROXY_PORT, true);
+    rc = trusty_ipc_connect(&proxy->chan, port, true);
     if (rc < 0) {
         trusty_error("%s: failed (%d) to connect to '%s'\n", __func__, rc,
-                     STORAGE_DISK_PROXY_PORT);
+                     port);
         return rc;
     }
 
     /* override default ops */
-    proxy_chan.ops = &proxy_ops;
+    proxy->chan.ops = &proxy_ops;
+    proxy->chan.ops_ctx = proxy;
 
     do {
         /* Check for RPMB events */
-        rc = trusty_ipc_poll_for_event(proxy_chan.dev);
+        rc = trusty_ipc_poll_for_event(proxy->chan.dev);
         if (rc < 0) {
             trusty_error("%s: failed (%d) to get rpmb event\n", __func__, rc);
-            return rc;
+            goto err;
         }
 
-        if (proxy_chan.handle == INVALID_IPC_HANDLE) {
+        if (proxy->chan.handle == INVALID_IPC_HANDLE) {
             trusty_error("%s: unexpected proxy channel close\n", __func__);
-            return TRUSTY_ERR_CHANNEL_CLOSED;
+            rc = TRUSTY_ERR_CHANNEL_CLOSED;
+            goto err;
         }
     } while (rc != TRUSTY_EVENT_NONE);
 
+    return TRUSTY_ERR_NONE;
+
+err:
+    proxy_stop(proxy);
+    return rc;
+}
+
+int rpmb_storage_proxy_create(struct rpmb_storage_proxy** proxy,
+                              struct trusty_ipc_dev* dev,
+                              void* rpmb_dev,
+                              const char* port) {
+    int rc;
+    struct rpmb_storage_proxy* p;
+
+    trusty_assert(proxy);
+    trusty_assert(dev);
+    trusty_assert(port);
+
+    p = trusty_calloc(1, sizeof(*p));
+    if (!p) {
+        trusty_error("%s: failed to allocate RPMB storage proxy\n", __func__);
+        return TRUSTY_ERR_NO_MEMORY;
+    }
+
+    rc = proxy_start(p, dev, rpmb_dev, port);
+    if (rc < 0) {
+        trusty_free(p);
+        return rc;
+    }
+
+    *proxy = p;
+    return TRUSTY_ERR_NONE;
+}
+
+void rpmb_storage_proxy_destroy(struct rpmb_storage_proxy* proxy) {
+    trusty_assert(proxy);
+
+    proxy_stop(proxy);
+    trusty_free(proxy);
+}
+
+/*
+ * Initialize RPMB storage proxy
+ */
+int rpmb_storage_proxy_init(struct trusty_ipc_dev* dev, void* rpmb_dev) {
+    int rc;
+
+    trusty_assert(dev);
+    trusty_assert(!initialized);
+
+    rc = proxy_start(&default_proxy, dev, rpmb_dev, STORAGE_DISK_PROXY_PORT);
+    if (rc < 0) {
+        return rc;
+    }
+
     /* mark as initialized */
     initialized = true;
 
@@ -317,8 +653,7 @@ int rpmb_storage_proxy_init(struct trusty_ipc_dev* dev, void* rpmb_dev) {
 void rpmb_storage_proxy_shutdown(struct trusty_ipc_dev* dev) {
     trusty_assert(initialized);
 
-    /* close channel */
-    trusty_ipc_close(&proxy_chan);
+    proxy_stop(&default_proxy);
 
     initialized = false;
 }
@@ -27,6 +27,7 @@
 #include <trusty/smc.h>
 #include <trusty/smcall.h>
 #include <trusty/trusty_dev.h>
+#include <trusty/trusty_ipc.h>
 #include <trusty/trusty_mem.h>
 #include <trusty/util.h>
 
@@ -203,6 +204,52 @@ static int trusty_init_api_version(struct trusty_dev* dev) {
     return 0;
 }
 
+/* 64-bit FNV-1a */
+#define FNV64_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV64_PRIME 0x100000001b3ULL
+
+static uint64_t fnv64_add(uint64_t hash, uint8_t byte) {
+    return (hash ^ byte) * FNV64_PRIME;
+}
+
+int trusty_dev_get_instance_id(struct trusty_dev* dev, uint64_t* id) {
+    int32_t len;
+    int32_t c;
+    int32_t i;
+    uint64_t hash = FNV64_OFFSET_BASIS;
+
+    trusty_assert(dev);
+    trusty_assert(id);
+
+    if (dev->instance_id) {
+        *id = dev->instance_id;
+        return TRUSTY_ERR_NONE;
+    }
+
+    /* index -1 asks for the length of the version string */
+    len = trusty_fast_call32(dev, SMC_FC_GET_VERSION_STR, (uint32_t)-1, 0, 0);
+    if (len <= 0) {
+        return TRUSTY_ERR_NOT_SUPPORTED;
+    }
+    for (i = 0; i < len; i++) {
+        c = trusty_fast_call32(dev, SMC_FC_GET_VERSION_STR, i, 0, 0);
+        if (c < 0) {
+            trusty_error("%s: failed (%d) to read version string\n", __func__,
+                         c);
+            return TRUSTY_ERR_GENERIC;
+        }
+        hash = fnv64_add(hash, (uint8_t)c);
+    }
+    for (i = 0; i < 4; i++) {
+        hash = fnv64_add(hash, (uint8_t)(dev->api_version >> (8 * i)));
+    }
+
+    /* 0 means unknown */
+    dev->instance_id = hash ? hash : 1;
+    *id = dev->instance_id;
+    return TRUSTY_ERR_NONE;
+}
+
 int trusty_dev_init(struct trusty_dev* dev, void* priv_data) {
     int ret;
     struct smc_ret8 smc_ret;
@@ -213,6 +260,7 @@ int trusty_dev_init(struct trusty_dev* dev, void* priv_data) {
 
     dev->priv_data = priv_data;
     dev->ffa_tx = NULL;
+    dev->instance_id = 0;
     ret = trusty_init_api_version(dev);
     if (ret) {
         return ret;
@@ -41,6 +41,7 @@ QL_TIPC = $(LOCAL_DIR)/../ql-tipc
 
 MODULE_DEFINES += \
 	NS_ARCH_ARM64=1 \
+	TIPC_ENABLE_WORD_COPY=1 \
 
 MODULE_INCLUDES += \
 	$(LOCAL_DIR)/include \
@@ -59,8 +60,11 @@ MODULE_SRCS += \
 	$(LOCAL_DIR)/virtio.c \
 	$(LOCAL_DIR)/virtio-console.c \
 	$(QL_TIPC)/hwbcc.c \
+	$(QL_TIPC)/hwbcc_handover.c \
 	$(QL_TIPC)/ipc.c \
 	$(QL_TIPC)/ipc_dev.c \
+	$(QL_TIPC)/ipc_framer.c \
+	$(QL_TIPC)/ipc_schema.c \
 	$(QL_TIPC)/keymaster.c \
 	$(QL_TIPC)/keymaster_serializable.c \
 	$(QL_TIPC)/rpmb_proxy.c \
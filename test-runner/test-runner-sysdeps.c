@@ -24,9 +24,14 @@
 
 #include <test-runner-arch.h>
 #include <trusty/sysdeps.h>
+#include <trusty/trusty_ipc.h>
 
-/* Size limits for bump allocators (trusty_calloc and trusty_alloc_pages) */
-#define HEAP_SIZE (56 + 6 * 4)
+/*
+ * Size limits for bump allocators (trusty_calloc and trusty_alloc_pages).
+ * The heap only holds the Trusty IPC device, keymaster requests are sent
+ * straight from the caller's buffers.
+ */
+#define HEAP_SIZE (sizeof(struct trusty_ipc_dev))
 #define PAGE_COUNT (3)
 
 static uint8_t heap[HEAP_SIZE];
@@ -29,6 +29,7 @@
 #include <string.h>
 #include <test-runner-arch.h>
 #include <trusty/hwbcc.h>
+#include <trusty/hwbcc_handover.h>
 #include <trusty/keymaster.h>
 #include <trusty/rpmb.h>
 #include <trusty/trusty_dev.h>
@@ -172,7 +173,6 @@ void boot(int cpu) {
 
     /**
      * dice_artifacts expects the following CBOR encoded structure.
-     * We calculate the expected size, including CBOR header sizes.
      * BccHandover = {
      *      1 : bstr .size 32,	// CDI_Attest
      *      2 : bstr .size 32,	// CDI_Seal
@@ -185,15 +185,18 @@ void boot(int cpu) {
      */
     size_t UDS_encoded_size = 45;
     size_t bcc_entry_encoded_size = 463;
-    size_t bcc_encoded_size =
-            UDS_encoded_size + bcc_entry_encoded_size + 1 /*array header*/;
     size_t DICE_CDI_SIZE = 32;
-    size_t bcc_handover_size =
-            2 * DICE_CDI_SIZE + bcc_encoded_size +
-            8 /*map header, map keys and two 32 bytes indicators*/;
+    struct hwbcc_handover handover;
+    struct hwbcc_view bcc_entry;
 
-    if (resp_payload_size != bcc_handover_size) {
-        log_msg("hwbcc_get_dice_artifacts failed with incorrect response size.\n");
+    if (hwbcc_handover_parse(dice_artifacts, resp_payload_size, &handover) ||
+        hwbcc_handover_get_entry(&handover, 0, &bcc_entry) ||
+        handover.cdi_attest.size != DICE_CDI_SIZE ||
+        handover.cdi_seal.size != DICE_CDI_SIZE ||
+        handover.pub_key.size != UDS_encoded_size ||
+        handover.num_entries != 1 ||
+        bcc_entry.size != bcc_entry_encoded_size) {
+        log_msg("hwbcc_get_dice_artifacts returned unexpected artifacts.\n");
     }
 
     /**